@@ -0,0 +1,300 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <new>
+#include <random>
+#include <sstream>
+
+#include <boost/program_options.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <cryptopp/sha.h>
+#include <cryptopp/hex.h>
+#include <cryptopp/filters.h>
+
+#include "../src/Block.h"
+#include "../src/BlockHeader.h"
+#include "../src/Transactions.h"
+
+namespace po = boost::program_options;
+namespace nl = nlohmann;
+
+using namespace ash::literals;
+
+namespace
+{
+
+std::atomic_uint64_t allocationCount = 0;
+
+// every block is stamped with the same time so runs with the same
+// seed hash exactly the same text from build to build
+constexpr ash::BlockTime FrozenTime{ std::chrono::milliseconds{ 1609459200000 } };
+
+const auto BenchAddress = "1LahaosvBaCG4EbDamyvuRmcrqc5P2iv7t"_address;
+
+// the stringstream + StringSource hashing every block hash and
+// transaction id went through before HashWriter, kept here as the
+// baseline and to check the new path still produces the same text
+std::string LegacySHA256(const std::string& data)
+{
+    std::string digest;
+    CryptoPP::SHA256 hash;
+
+    CryptoPP::StringSource src(data, true,
+        new CryptoPP::HashFilter(hash,
+            new CryptoPP::HexEncoder(
+                new CryptoPP::StringSink(digest), false)));
+
+    return digest;
+}
+
+std::string LegacyBlockHash(const ash::Block& block)
+{
+    std::stringstream ss;
+    ss << block.index()
+        << block.nonce()
+        << block.difficulty()
+        << block.data()
+        << block.time().time_since_epoch().count()
+        << block.previousHash()
+        << LegacySHA256(nl::json(block.transactions()).dump());
+
+    return LegacySHA256(ss.str());
+}
+
+std::string LegacyTransactionId(const ash::Transaction& tx, std::uint64_t blockid)
+{
+    std::stringstream ss;
+    for (const auto& txin : tx.txIns())
+    {
+        ss << txin.txOutPt().blockIndex
+            << txin.txOutPt().txIndex
+            << txin.txOutPt().txOutIndex;
+    }
+
+    for (const auto& txout : tx.txOuts())
+    {
+        ss << txout.address() << txout.amount();
+    }
+
+    ss << blockid;
+
+    if (tx.extraNonce() != 0)
+    {
+        ss << tx.extraNonce();
+    }
+
+    return LegacySHA256(ss.str());
+}
+
+ash::Transaction CreateBenchTransaction(std::mt19937_64& rng, std::uint64_t blockIdx)
+{
+    ash::Transaction tx;
+    for (auto idx = 0u; idx < 1 + (rng() % 4); idx++)
+    {
+        tx.txIns().emplace_back(rng() % blockIdx, rng() % 8, rng() % 4);
+    }
+
+    for (auto idx = 0u; idx < 1 + (rng() % 3); idx++)
+    {
+        tx.txOuts().emplace_back(BenchAddress, static_cast<double>(rng() % 100000) / 1000.0);
+    }
+
+    tx.calcuateId(blockIdx);
+    return tx;
+}
+
+std::vector<ash::Block> CreateBenchBlocks(std::uint64_t seed, std::uint32_t count, std::uint32_t txcount)
+{
+    std::mt19937_64 rng{ seed };
+
+    std::vector<ash::Block> retval;
+    retval.reserve(count);
+
+    for (auto idx = 0u; idx < count; idx++)
+    {
+        const auto index = 1 + (rng() % 100000);
+        const auto prevhash = ash::Hash256::FromHex(
+            fmt::format("{:016x}{:016x}{:016x}{:016x}", rng(), rng(), rng(), rng()));
+
+        ash::Transactions txs;
+        txs.push_back(ash::CreateCoinbaseTransaction(index, BenchAddress));
+        for (auto txidx = 0u; txidx < txcount; txidx++)
+        {
+            txs.push_back(CreateBenchTransaction(rng, index));
+        }
+
+        auto& block = retval.emplace_back(index, *prevhash, std::move(txs));
+        block.setData(fmt::format("bench block {:016x}", rng()));
+        block.setMinedData(rng(), 1 + (rng() % 8), FrozenTime, {});
+    }
+
+    return retval;
+}
+
+template<typename HashF>
+nl::json RunBenchCase(std::string_view name, std::uint64_t hashes, HashF&& hashf)
+{
+    const auto startAllocations = allocationCount.load();
+    const auto start = std::chrono::steady_clock::now();
+
+    const auto digest = hashf();
+
+    const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const auto allocations = allocationCount.load() - startAllocations;
+
+    nl::json retval;
+    retval["name"] = name;
+    retval["hashes"] = hashes;
+    retval["seconds"] = seconds;
+    retval["hashes_per_sec"] = seconds > 0 ? static_cast<double>(hashes) / seconds : 0.0;
+    retval["allocations"] = allocations;
+    retval["allocations_per_hash"] = hashes > 0 ? static_cast<double>(allocations) / hashes : 0.0;
+
+    // keeps the work from being optimized away
+    retval["checksum"] = digest;
+    return retval;
+}
+
+} // namespace
+
+void* operator new(std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (auto ptr = std::malloc(size == 0 ? 1 : size))
+    {
+        return ptr;
+    }
+
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+int main(int argc, char* argv[])
+{
+    po::options_description desc("Allowed options");
+    desc.add_options()
+        ("help,?", "print help message")
+        ("seed", po::value<std::uint64_t>()->default_value(42), "seed for the generated blocks")
+        ("blocks", po::value<std::uint32_t>()->default_value(1000), "blocks to generate")
+        ("transactions", po::value<std::uint32_t>()->default_value(20), "transactions per block besides the coinbase")
+        ("runs", po::value<std::uint32_t>()->default_value(20), "times every block and transaction is hashed per case")
+        ("output,o", po::value<std::string>(), "write the results to a file instead of stdout")
+        ;
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help") > 0)
+    {
+        std::cout << desc << '\n';
+        return 0;
+    }
+
+    const auto seed = vm["seed"].as<std::uint64_t>();
+    const auto runs = vm["runs"].as<std::uint32_t>();
+
+    // the JSON is the only thing written to stdout
+    ash::rootLogger();
+    spdlog::set_level(spdlog::level::off);
+
+    // v2 headers never went through a stringstream
+    ash::SetHeaderV2Height(std::numeric_limits<std::uint64_t>::max());
+
+    const auto blocks = CreateBenchBlocks(seed,
+        vm["blocks"].as<std::uint32_t>(), vm["transactions"].as<std::uint32_t>());
+
+    std::uint64_t txcount = 0;
+    bool identical = true;
+    for (const auto& block : blocks)
+    {
+        identical = identical && LegacyBlockHash(block) == ash::CalculateBlockHash(block).hex();
+        for (const auto& tx : block.transactions())
+        {
+            identical = identical
+                && LegacyTransactionId(tx, block.index()) == ash::GetTransactionId(tx, block.index()).hex();
+            txcount++;
+        }
+    }
+
+    const auto blockHashes = blocks.size() * runs;
+    const auto txHashes = txcount * runs;
+
+    // the checksum xors the first byte of every hash, the legacy
+    // hashes are text and the new ones are raw bytes
+    const auto hashBlocks = [&](auto&& hashf)
+    {
+        std::uint64_t retval = 0;
+        for (auto run = 0u; run < runs; run++)
+        {
+            for (const auto& block : blocks)
+            {
+                retval ^= static_cast<std::uint8_t>(hashf(block)[0]);
+            }
+        }
+
+        return retval;
+    };
+
+    const auto hashTransactions = [&](auto&& hashf)
+    {
+        std::uint64_t retval = 0;
+        for (auto run = 0u; run < runs; run++)
+        {
+            for (const auto& block : blocks)
+            {
+                for (const auto& tx : block.transactions())
+                {
+                    retval ^= static_cast<std::uint8_t>(hashf(tx, block.index())[0]);
+                }
+            }
+        }
+
+        return retval;
+    };
+
+    nl::json results = nl::json::array();
+    results.push_back(RunBenchCase("block_hash_legacy", blockHashes,
+        [&] { return hashBlocks([](const auto& block) { return LegacyBlockHash(block); }); }));
+    results.push_back(RunBenchCase("block_hash", blockHashes,
+        [&] { return hashBlocks([](const auto& block) { return ash::CalculateBlockHash(block).bytes(); }); }));
+    results.push_back(RunBenchCase("txid_legacy", txHashes,
+        [&] { return hashTransactions([](const auto& tx, auto idx) { return LegacyTransactionId(tx, idx); }); }));
+    results.push_back(RunBenchCase("txid", txHashes,
+        [&] { return hashTransactions([](const auto& tx, auto idx) { return ash::GetTransactionId(tx, idx).bytes(); }); }));
+
+    nl::json report;
+    report["benchmark"] = "hashing";
+    report["seed"] = seed;
+    report["blocks"] = blocks.size();
+    report["transactions"] = txcount;
+    report["runs"] = runs;
+    report["identical"] = identical;
+    report["results"] = results;
+
+    if (vm.count("output") > 0)
+    {
+        std::ofstream out{ vm["output"].as<std::string>() };
+        out << report.dump(4) << '\n';
+    }
+    else
+    {
+        std::cout << report.dump(4) << '\n';
+    }
+
+    return identical ? 0 : 1;
+}
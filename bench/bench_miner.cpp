@@ -0,0 +1,224 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <new>
+#include <random>
+#include <thread>
+
+#include <boost/program_options.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include "../src/Block.h"
+#include "../src/BlockHeader.h"
+#include "../src/Miner.h"
+#include "../src/Sha256.h"
+#include "../src/Transactions.h"
+
+namespace po = boost::program_options;
+namespace nl = nlohmann;
+
+using namespace ash::literals;
+
+namespace
+{
+
+std::atomic_uint64_t allocationCount = 0;
+
+// every header is stamped with the same time so runs with the same
+// seed hash exactly the same headers from build to build
+constexpr ash::BlockTime FrozenTime{ std::chrono::milliseconds{ 1609459200000 } };
+
+const auto BenchAddress = "1LahaosvBaCG4EbDamyvuRmcrqc5P2iv7t"_address;
+
+ash::Block CreateBenchBlock(std::mt19937_64& rng)
+{
+    const auto index = 1 + (rng() % 100000);
+    const auto prevhash = *ash::Hash256::FromHex(
+        fmt::format("{:016x}{:016x}{:016x}{:016x}", rng(), rng(), rng(), rng()));
+
+    ash::Transactions txs;
+    txs.push_back(ash::CreateCoinbaseTransaction(index, BenchAddress));
+
+    ash::Block block{ index, prevhash, std::move(txs) };
+    block.setData(fmt::format("bench block {:016x}", rng()));
+    return block;
+}
+
+struct BenchCase
+{
+    std::string     header;
+    std::uint32_t   difficulty;
+    std::uint32_t   threads;
+};
+
+nl::json RunBenchCase(const BenchCase& bench, std::uint64_t seed, std::uint32_t runs)
+{
+    ash::SetHeaderV2Height(bench.header == "v2" ? 0 : std::numeric_limits<std::uint64_t>::max());
+
+    ash::Miner miner{ bench.difficulty };
+    miner.setThreadCount(bench.threads);
+    miner.setClock([] { return FrozenTime; });
+
+    // every case mines the same sequence of blocks
+    std::mt19937_64 rng{ seed };
+
+    std::uint64_t hashes = 0;
+    std::uint64_t allocations = 0;
+    double seconds = 0;
+    double fastest = std::numeric_limits<double>::max();
+    double slowest = 0;
+    std::vector<std::uint64_t> nonces;
+    bool valid = true;
+
+    for (auto run = 0u; run < runs; run++)
+    {
+        auto block = CreateBenchBlock(rng);
+
+        const auto startAllocations = allocationCount.load();
+        const auto start = std::chrono::steady_clock::now();
+
+        const auto result = miner.mineBlock(block);
+
+        const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        allocations += allocationCount.load() - startAllocations;
+
+        hashes += miner.hashCount();
+        seconds += elapsed;
+        fastest = std::min(fastest, elapsed);
+        slowest = std::max(slowest, elapsed);
+        nonces.push_back(block.nonce());
+        valid = valid && result == ash::Miner::SUCCESS && ash::ValidHash(block);
+    }
+
+    nl::json retval;
+    retval["header"] = bench.header;
+    retval["difficulty"] = bench.difficulty;
+    retval["threads"] = miner.threadCount();
+    retval["runs"] = runs;
+    retval["valid"] = valid;
+    retval["hashes"] = hashes;
+    retval["seconds"] = seconds;
+    retval["hashes_per_sec"] = seconds > 0 ? static_cast<double>(hashes) / seconds : 0.0;
+    retval["time_to_solution_ms"] =
+    {
+        { "mean", runs > 0 ? (seconds * 1000.0) / runs : 0.0 },
+        { "min", runs > 0 ? fastest * 1000.0 : 0.0 },
+        { "max", slowest * 1000.0 }
+    };
+    retval["allocations"] = allocations;
+    retval["allocations_per_hash"] = hashes > 0 ? static_cast<double>(allocations) / hashes : 0.0;
+
+    // with one thread the winning nonces only change when hashing does
+    retval["nonces"] = nonces;
+    return retval;
+}
+
+} // namespace
+
+void* operator new(std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (auto ptr = std::malloc(size == 0 ? 1 : size))
+    {
+        return ptr;
+    }
+
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+int main(int argc, char* argv[])
+{
+    po::options_description desc("Allowed options");
+    desc.add_options()
+        ("help,?", "print help message")
+        ("seed", po::value<std::uint64_t>()->default_value(42), "seed for the generated blocks")
+        ("runs", po::value<std::uint32_t>()->default_value(5), "blocks mined per case")
+        ("difficulty", po::value<std::vector<std::uint32_t>>()->multitoken(), "difficulties to mine at (default 2 3 4)")
+        ("threads", po::value<std::vector<std::uint32_t>>()->multitoken(), "thread counts to mine with, 0 is all cores (default 1 2 0)")
+        ("header", po::value<std::vector<std::string>>()->multitoken(), "header formats v1 and/or v2 (default both)")
+        ("output,o", po::value<std::string>(), "write the results to a file instead of stdout")
+        ;
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help") > 0)
+    {
+        std::cout << desc << '\n';
+        return 0;
+    }
+
+    const auto seed = vm["seed"].as<std::uint64_t>();
+    const auto runs = vm["runs"].as<std::uint32_t>();
+
+    const auto difficulties = vm.count("difficulty") > 0
+        ? vm["difficulty"].as<std::vector<std::uint32_t>>()
+        : std::vector<std::uint32_t>{ 2, 3, 4 };
+
+    const auto threadCounts = vm.count("threads") > 0
+        ? vm["threads"].as<std::vector<std::uint32_t>>()
+        : std::vector<std::uint32_t>{ 1, 2, 0 };
+
+    const auto headers = vm.count("header") > 0
+        ? vm["header"].as<std::vector<std::string>>()
+        : std::vector<std::string>{ "v1", "v2" };
+
+    for (const auto& header : headers)
+    {
+        if (header != "v1" && header != "v2")
+        {
+            std::cerr << "unknown header format '" << header << "'\n";
+            return 1;
+        }
+    }
+
+    // the JSON is the only thing written to stdout
+    ash::rootLogger();
+    spdlog::set_level(spdlog::level::off);
+
+    nl::json results = nl::json::array();
+    for (const auto& header : headers)
+    {
+        for (const auto difficulty : difficulties)
+        {
+            for (const auto threads : threadCounts)
+            {
+                results.push_back(RunBenchCase({ header, difficulty, threads }, seed, runs));
+            }
+        }
+    }
+
+    nl::json report;
+    report["benchmark"] = "miner";
+    report["seed"] = seed;
+    report["sha256_kernel"] = ash::crypto::GetSha256Kernel().name;
+    report["hardware_threads"] = std::thread::hardware_concurrency();
+    report["results"] = results;
+
+    if (vm.count("output") > 0)
+    {
+        std::ofstream out{ vm["output"].as<std::string>() };
+        out << report.dump(4) << '\n';
+    }
+    else
+    {
+        std::cout << report.dump(4) << '\n';
+    }
+
+    return 0;
+}
@@ -0,0 +1,233 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <thread>
+
+#include <boost/program_options.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include "../src/BinaryCodec.h"
+#include "../src/Block.h"
+#include "../src/Blockchain.h"
+#include "../src/SignatureCache.h"
+#include "../src/TxValidation.h"
+
+namespace po = boost::program_options;
+namespace nl = nlohmann;
+
+using namespace ash::literals;
+
+namespace
+{
+
+// the private key of BenchAddress
+constexpr std::string_view BenchPrivateKey = "1b3f78b45456dcfc3a2421da1d9961abd944b7e8a7c2ccc809a7ea92e200eeb1h";
+const auto BenchAddress = "1LahaosvBaCG4EbDamyvuRmcrqc5P2iv7t"_address;
+const auto ReceiverAddress = "1Cus7TLessdAvkzN2BhK3WD3Ymru48X3z8"_address;
+
+constexpr double OutputAmount = 0.001;
+
+// a genesis block whose coinbase has an output for every input
+// of the benchmark block. It is loaded with the codec so it is
+// not mined or validated itself
+ash::Blockchain CreateBenchChain(std::size_t outputs)
+{
+    auto coinbase = ash::CreateCoinbaseTransaction(0, BenchAddress);
+    auto& txouts = coinbase.txOuts();
+    txouts.clear();
+    for (auto idx = 0u; idx < outputs; idx++)
+    {
+        txouts.emplace_back(BenchAddress, OutputAmount);
+    }
+
+    coinbase.calcuateId(0);
+
+    ash::Transactions txs;
+    txs.push_back(std::move(coinbase));
+    const ash::Block genesis{ 0, ash::Hash256{}, std::move(txs) };
+
+    ash::codec::Buffer buffer;
+    ash::codec::Writer writer{ buffer };
+    ash::write_blocks(writer, &genesis, 1);
+
+    ash::Blockchain retval;
+    ash::codec::Reader reader{ buffer };
+    ash::read_blocks(reader, retval, ash::codec::FORMAT_VERSION);
+    return retval;
+}
+
+// the genesis outputs are handed out in a random order so the
+// lookups don't walk the unspent outputs in insertion order
+ash::Block CreateBenchBlock(const ash::Blockchain& chain, std::uint64_t seed,
+    std::uint32_t txcount, std::uint32_t inputs, bool sign)
+{
+    std::vector<std::uint64_t> outputs(static_cast<std::size_t>(txcount) * inputs);
+    std::iota(outputs.begin(), outputs.end(), 0);
+    std::shuffle(outputs.begin(), outputs.end(), std::mt19937_64{ seed });
+
+    ash::Transactions txs;
+    txs.reserve(txcount + 1);
+    txs.push_back(ash::CreateCoinbaseTransaction(1, BenchAddress));
+
+    for (auto txidx = 0u; txidx < txcount; txidx++)
+    {
+        ash::Transaction tx;
+        for (auto inidx = 0u; inidx < inputs; inidx++)
+        {
+            tx.txIns().emplace_back(0, 0, outputs[txidx * inputs + inidx], "signature");
+        }
+
+        tx.txOuts().emplace_back(ReceiverAddress, OutputAmount * inputs);
+        if (sign)
+        {
+            ash::SignTransaction(tx, BenchPrivateKey);
+        }
+
+        tx.calcuateId(1);
+        txs.push_back(std::move(tx));
+    }
+
+    return { 1, chain.back().hash(), std::move(txs) };
+}
+
+nl::json RunBenchCase(const ash::Blockchain& chain, const ash::Block& block,
+    std::uint32_t threads, std::uint32_t runs, bool cached)
+{
+    const auto txcount = block.transactions().size();
+
+    double seconds = 0;
+    double fastest = std::numeric_limits<double>::max();
+    double slowest = 0;
+    bool valid = true;
+
+    for (auto run = 0u; run < runs; run++)
+    {
+        // without the cache every run verifies every signature
+        if (!cached)
+        {
+            ash::GetSignatureCache().clear();
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+
+        const auto result = ash::ValidateBlockTransactions(chain, block, threads);
+
+        const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        seconds += elapsed;
+        fastest = std::min(fastest, elapsed);
+        slowest = std::max(slowest, elapsed);
+        valid = valid && result.valid();
+    }
+
+    nl::json retval;
+    retval["threads"] = threads == 0 ? std::max(std::thread::hardware_concurrency(), 1u) : threads;
+    retval["runs"] = runs;
+    retval["valid"] = valid;
+    retval["seconds"] = seconds;
+    retval["transactions_per_sec"] = seconds > 0 ? static_cast<double>(txcount * runs) / seconds : 0.0;
+    retval["block_ms"] =
+    {
+        { "mean", runs > 0 ? (seconds * 1000.0) / runs : 0.0 },
+        { "min", runs > 0 ? fastest * 1000.0 : 0.0 },
+        { "max", slowest * 1000.0 }
+    };
+
+    return retval;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    po::options_description desc("Allowed options");
+    desc.add_options()
+        ("help,?", "print help message")
+        ("seed", po::value<std::uint64_t>()->default_value(42), "seed for the order outputs are spent in")
+        ("transactions", po::value<std::uint32_t>()->default_value(20000), "transactions in the block besides the coinbase")
+        ("inputs", po::value<std::uint32_t>()->default_value(2), "inputs per transaction")
+        ("runs", po::value<std::uint32_t>()->default_value(5), "times the block is validated per case")
+        ("signed", "sign the transactions and verify their signatures")
+        ("cached", "keep the verified signatures between runs, like a block whose transactions were queued first")
+        ("threads", po::value<std::vector<std::uint32_t>>()->multitoken(), "thread counts to validate with, 0 is all cores (default 1 2 4 0)")
+        ("output,o", po::value<std::string>(), "write the results to a file instead of stdout")
+        ;
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help") > 0)
+    {
+        std::cout << desc << '\n';
+        return 0;
+    }
+
+    const auto seed = vm["seed"].as<std::uint64_t>();
+    const auto txcount = vm["transactions"].as<std::uint32_t>();
+    const auto inputs = std::max(vm["inputs"].as<std::uint32_t>(), 1u);
+    const auto runs = vm["runs"].as<std::uint32_t>();
+    const auto sign = vm.count("signed") > 0;
+    const auto cached = vm.count("cached") > 0;
+
+    const auto threadCounts = vm.count("threads") > 0
+        ? vm["threads"].as<std::vector<std::uint32_t>>()
+        : std::vector<std::uint32_t>{ 1, 2, 4, 0 };
+
+    // the JSON is the only thing written to stdout
+    ash::rootLogger();
+    spdlog::set_level(spdlog::level::off);
+
+    const auto chain = CreateBenchChain(static_cast<std::size_t>(txcount) * inputs);
+    const auto block = CreateBenchBlock(chain, seed, txcount, inputs, sign);
+
+    // every block of the bench chain spends by the rules
+    ash::SetSpendingHeight(0);
+
+    if (sign)
+    {
+        ash::SetSignatureHeight(0);
+        ash::GetSignatureCache().setCapacity(static_cast<std::size_t>(txcount) * inputs);
+    }
+
+    // the unspent outputs are caught up once, outside of the timings
+    chain.unspentOutputs();
+
+    // the signatures are verified once before the runs that use the cache
+    if (sign && cached)
+    {
+        ash::ValidateBlockTransactions(chain, block);
+    }
+
+    nl::json results = nl::json::array();
+    for (const auto threads : threadCounts)
+    {
+        results.push_back(RunBenchCase(chain, block, threads, runs, cached));
+    }
+
+    nl::json report;
+    report["benchmark"] = "txvalidation";
+    report["seed"] = seed;
+    report["transactions"] = txcount;
+    report["inputs"] = inputs;
+    report["signed"] = sign;
+    report["cached"] = sign && cached;
+    report["hardware_threads"] = std::thread::hardware_concurrency();
+    report["results"] = results;
+
+    if (vm.count("output") > 0)
+    {
+        std::ofstream out{ vm["output"].as<std::string>() };
+        out << report.dump(4) << '\n';
+    }
+    else
+    {
+        std::cout << report.dump(4) << '\n';
+    }
+
+    return 0;
+}
@@ -0,0 +1,292 @@
+#include <mutex>
+#include <unordered_map>
+
+#include <cryptopp/sha.h>
+
+#include <fmt/core.h>
+
+#include "Address.h"
+
+namespace ash
+{
+
+namespace
+{
+
+constexpr std::string_view Base58Alphabet = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+constexpr std::uint32_t Base58 = 58;
+
+// five base58 digits at a time still fit in a 32 bit remainder
+constexpr std::uint32_t Base58Pow5 = Base58 * Base58 * Base58 * Base58 * Base58;
+constexpr std::size_t Base58MaxDigits = Address::MAX_TEXT_SIZE - 1;
+
+constexpr auto Base58Values = []()
+{
+    std::array<std::int8_t, 128> retval{};
+    retval.fill(-1);
+    for (auto idx = 0u; idx < Base58Alphabet.size(); idx++)
+    {
+        retval[static_cast<std::size_t>(Base58Alphabet[idx])] = static_cast<std::int8_t>(idx);
+    }
+
+    return retval;
+}();
+
+// the 25 bytes as a little endian number of 32 bit limbs
+using Limbs = std::array<std::uint32_t, (Address::SIZE + 3) / 4>;
+
+// the first 4 bytes of the double SHA-256 of the version and hash
+std::array<std::uint8_t, Address::CHECKSUM_SIZE> Checksum(const std::uint8_t* data)
+{
+    std::array<std::uint8_t, CryptoPP::SHA256::DIGESTSIZE> digest;
+    CryptoPP::SHA256 hash;
+    hash.CalculateDigest(digest.data(), data, 1 + Address::HASH_SIZE);
+    hash.CalculateDigest(digest.data(), digest.data(), digest.size());
+
+    std::array<std::uint8_t, Address::CHECKSUM_SIZE> retval;
+    std::memcpy(retval.data(), digest.data(), retval.size());
+    return retval;
+}
+
+// the texts of the legacy addresses that have been read, entries are
+// never removed so views of them stay valid
+struct LegacyTexts
+{
+    std::mutex                              mutex;
+    std::unordered_map<Address, std::string> texts;
+};
+
+LegacyTexts& GetLegacyTexts()
+{
+    static LegacyTexts texts;
+    return texts;
+}
+
+} // namespace
+
+Address::Address(const Hash160& hash, std::uint8_t version)
+{
+    _bytes[0] = version;
+    std::memcpy(_bytes.data() + 1, hash.data(), HASH_SIZE);
+
+    const auto checksum = Checksum(_bytes.data());
+    std::memcpy(_bytes.data() + 1 + HASH_SIZE, checksum.data(), CHECKSUM_SIZE);
+}
+
+// addresses have always been written as a "1" followed by the base58
+// number of all 25 bytes, so unlike Bitcoin a leading zero byte of
+// the hash does not get a "1" of its own
+std::optional<Address> Address::FromBase58(std::string_view text)
+{
+    if (text.empty())
+    {
+        return Address{};
+    }
+    else if (text.size() < 2 || text.size() > MAX_TEXT_SIZE || text.front() != '1')
+    {
+        return {};
+    }
+
+    // a "1" after the prefix is a leading zero digit which would
+    // give the same address a second text
+    const auto digits = text.substr(1);
+    if (digits.size() > 1 && digits.front() == Base58Alphabet.front())
+    {
+        return {};
+    }
+
+    Limbs limbs{};
+    for (const auto c : digits)
+    {
+        const auto value = static_cast<unsigned char>(c) < Base58Values.size()
+            ? Base58Values[static_cast<unsigned char>(c)] : -1;
+
+        if (value < 0)
+        {
+            return {};
+        }
+
+        std::uint64_t carry = static_cast<std::uint64_t>(value);
+        for (auto& limb : limbs)
+        {
+            carry += static_cast<std::uint64_t>(limb) * Base58;
+            limb = static_cast<std::uint32_t>(carry);
+            carry >>= 32;
+        }
+
+        if (carry != 0)
+        {
+            return {};
+        }
+    }
+
+    // the top limb only holds the highest byte
+    constexpr auto topBits = (SIZE % 4) * 8;
+    if (topBits != 0 && (limbs.back() >> topBits) != 0)
+    {
+        return {};
+    }
+
+    Address retval;
+    for (auto idx = 0u; idx < SIZE; idx++)
+    {
+        retval._bytes[SIZE - 1 - idx] = static_cast<std::uint8_t>(limbs[idx / 4] >> ((idx % 4) * 8));
+    }
+
+    const auto checksum = Checksum(retval._bytes.data());
+    if (std::memcmp(checksum.data(), retval._bytes.data() + 1 + HASH_SIZE, CHECKSUM_SIZE) != 0)
+    {
+        return {};
+    }
+
+    return retval;
+}
+
+Address Address::FromText(std::string_view text)
+{
+    if (auto retval = FromBase58(text); retval.has_value())
+    {
+        return *retval;
+    }
+
+    std::array<std::uint8_t, CryptoPP::SHA256::DIGESTSIZE> digest;
+    CryptoPP::SHA256{}.CalculateDigest(digest.data(),
+        reinterpret_cast<const std::uint8_t*>(text.data()), text.size());
+
+    Address retval;
+    retval._bytes[0] = LEGACY_VERSION;
+    std::memcpy(retval._bytes.data() + 1, digest.data(), HASH_SIZE);
+
+    const auto checksum = Checksum(retval._bytes.data());
+    for (auto idx = 0u; idx < CHECKSUM_SIZE; idx++)
+    {
+        retval._bytes[1 + HASH_SIZE + idx] = static_cast<std::uint8_t>(~checksum[idx]);
+    }
+
+    auto& legacy = GetLegacyTexts();
+    std::lock_guard<std::mutex> lock{ legacy.mutex };
+    legacy.texts.try_emplace(retval, text);
+    return retval;
+}
+
+bool Address::isLegacy() const noexcept
+{
+    if (_bytes[0] != LEGACY_VERSION)
+    {
+        return false;
+    }
+
+    const auto checksum = Checksum(_bytes.data());
+    return std::memcmp(checksum.data(), _bytes.data() + 1 + HASH_SIZE, CHECKSUM_SIZE) != 0;
+}
+
+std::string_view Address::text(TextBuffer& buffer) const
+{
+    if (isLegacy())
+    {
+        auto& legacy = GetLegacyTexts();
+        std::lock_guard<std::mutex> lock{ legacy.mutex };
+        if (const auto it = legacy.texts.find(*this); it != legacy.texts.end())
+        {
+            return it->second;
+        }
+    }
+
+    return { buffer.data(), toChars(buffer.data()) };
+}
+
+std::size_t Address::toChars(char* out) const noexcept
+{
+    if (isNull())
+    {
+        return 0;
+    }
+
+    Limbs limbs{};
+    for (auto idx = 0u; idx < SIZE; idx++)
+    {
+        limbs[idx / 4] |= static_cast<std::uint32_t>(_bytes[SIZE - 1 - idx]) << ((idx % 4) * 8);
+    }
+
+    // least significant digit first, the limbs that have been
+    // divided down to zero are skipped
+    std::array<std::uint8_t, Base58MaxDigits> digits{};
+    std::size_t count = 0;
+    auto top = limbs.size();
+    while (count < digits.size())
+    {
+        std::uint64_t remainder = 0;
+        for (auto idx = top; idx-- > 0;)
+        {
+            const auto current = (remainder << 32) | limbs[idx];
+            limbs[idx] = static_cast<std::uint32_t>(current / Base58Pow5);
+            remainder = current % Base58Pow5;
+        }
+
+        while (top > 0 && limbs[top - 1] == 0)
+        {
+            top--;
+        }
+
+        auto chunk = static_cast<std::uint32_t>(remainder);
+        for (auto digit = 0u; digit < 5 && count < digits.size(); digit++)
+        {
+            digits[count++] = static_cast<std::uint8_t>(chunk % Base58);
+            chunk /= Base58;
+        }
+
+        if (top == 0)
+        {
+            break;
+        }
+    }
+
+    while (count > 1 && digits[count - 1] == 0)
+    {
+        count--;
+    }
+
+    out[0] = '1';
+    for (auto idx = 0u; idx < count; idx++)
+    {
+        out[1 + idx] = Base58Alphabet[digits[count - 1 - idx]];
+    }
+
+    return count + 1;
+}
+
+inline namespace literals
+{
+
+Address operator""_address(const char* text, std::size_t size)
+{
+    const auto retval = Address::FromBase58({ text, size });
+    if (!retval.has_value())
+    {
+        throw std::invalid_argument(fmt::format("'{}' is not an address", std::string_view{ text, size }));
+    }
+
+    return *retval;
+}
+
+} // namespace literals
+
+void to_json(nl::json& j, const Address& address)
+{
+    j = address.base58();
+}
+
+void from_json(const nl::json& j, Address& address)
+{
+    address = Address::FromText(j.get_ref<const std::string&>());
+}
+
+std::ostream& operator<<(std::ostream& os, const Address& address)
+{
+    Address::TextBuffer buffer;
+    const auto text = address.text(buffer);
+    os.write(text.data(), static_cast<std::streamsize>(text.size()));
+    return os;
+}
+
+} // namespace ash
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <array>
+#include <compare>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include <fmt/format.h>
+
+#include <nlohmann/json.hpp>
+
+namespace nl = nlohmann;
+
+namespace ash
+{
+
+//! A public address kept as its raw bytes, the version byte and the
+//  RIPEMD-160 of the SHA-256 of the public key. The 4 byte checksum of
+//  the base58 text is worked out once when the address is made so
+//  writing the text does not hash anything. Base58 is only used to
+//  show an address and to read one from a user, the JSON or the codec.
+//  A default address is null and its text is empty.
+//
+//  Outputs were paid to any text before addresses were checked, such a
+//  legacy address keeps the hash of its text in place of the public
+//  key's and a checksum that never matches, and its text is kept on
+//  the side so the chain's hashes and txids stay the same
+class Address final
+{
+public:
+    static constexpr std::size_t HASH_SIZE = 20;
+    static constexpr std::size_t CHECKSUM_SIZE = 4;
+    static constexpr std::size_t SIZE = 1 + HASH_SIZE + CHECKSUM_SIZE;
+
+    // "1" followed by at most 35 base58 digits of the 25 bytes
+    static constexpr std::size_t MAX_TEXT_SIZE = 36;
+
+    // the network bytes of every address made by GetAddressFromPublicKey()
+    static constexpr std::uint8_t PUBKEY_VERSION = 0x00;
+    static constexpr std::uint8_t LEGACY_VERSION = 0xff;
+
+    using Hash160 = std::array<std::uint8_t, HASH_SIZE>;
+    using Bytes = std::array<std::uint8_t, SIZE>;
+    using TextBuffer = std::array<char, MAX_TEXT_SIZE>;
+
+private:
+    Bytes   _bytes{};
+
+    std::size_t toChars(char* out) const noexcept;
+
+public:
+    Address() = default;
+    explicit Address(const Hash160& hash, std::uint8_t version = PUBKEY_VERSION);
+
+    // the text written by text(), empty if `text` is not an address
+    // or its checksum does not match. An empty string is the null address
+    static std::optional<Address> FromBase58(std::string_view text);
+
+    // the same for text from a chain, which is a legacy address if
+    // it is not base58
+    static Address FromText(std::string_view text);
+
+    std::uint8_t version() const noexcept { return _bytes[0]; }
+
+    Hash160 hash160() const noexcept
+    {
+        Hash160 retval;
+        std::memcpy(retval.data(), _bytes.data() + 1, HASH_SIZE);
+        return retval;
+    }
+
+    // the version, hash and checksum
+    const Bytes& bytes() const noexcept { return _bytes; }
+    const std::uint8_t* data() const noexcept { return _bytes.data(); }
+
+    bool isNull() const noexcept { return *this == Address{}; }
+    bool isLegacy() const noexcept;
+
+    // the base58 text written to `buffer`, or the text of a legacy
+    // address which is kept for as long as the program runs
+    std::string_view text(TextBuffer& buffer) const;
+
+    std::string base58() const
+    {
+        TextBuffer buffer;
+        return std::string{ text(buffer) };
+    }
+
+    bool operator==(const Address& other) const noexcept = default;
+    auto operator<=>(const Address& other) const noexcept = default;
+};
+
+inline namespace literals
+{
+
+// a base58 address written in the source, an invalid one throws
+Address operator""_address(const char* text, std::size_t size);
+
+} // namespace literals
+
+void to_json(nl::json& j, const Address& address);
+void from_json(const nl::json& j, Address& address);
+
+std::ostream& operator<<(std::ostream& os, const Address& address);
+
+} // namespace ash
+
+namespace std
+{
+    template<> struct hash<ash::Address>
+    {
+        // the start of the RIPEMD-160 hash is already uniformly distributed
+        std::size_t operator()(const ash::Address& value) const noexcept
+        {
+            std::size_t retval;
+            std::memcpy(&retval, value.data() + 1, sizeof(retval));
+            return retval;
+        }
+    };
+}
+
+template<>
+struct fmt::formatter<ash::Address> : fmt::formatter<std::string_view>
+{
+    template<typename FormatContext>
+    auto format(const ash::Address& address, FormatContext& ctx) const
+    {
+        ash::Address::TextBuffer buffer;
+        return fmt::formatter<std::string_view>::format(address.text(buffer), ctx);
+    }
+};
@@ -0,0 +1,153 @@
+#include <algorithm>
+
+#include "AddressHistory.h"
+
+namespace ash
+{
+
+namespace
+{
+
+struct TransactionAmount
+{
+    Address address;
+    double  received = 0;
+    double  spent = 0;
+};
+
+const TxOut* FindOutput(const std::vector<Block>& blocks, const TxOutPoint& point)
+{
+    if (point.blockIndex >= blocks.size())
+    {
+        return nullptr;
+    }
+
+    const auto& txs = blocks[point.blockIndex].transactions();
+    if (point.txIndex >= txs.size()
+        || point.txOutIndex >= txs[point.txIndex].txOuts().size())
+    {
+        return nullptr;
+    }
+
+    return &(txs[point.txIndex].txOuts()[point.txOutIndex]);
+}
+
+// the addresses a transaction touches in the order they are first seen
+std::vector<TransactionAmount> GetTransactionAmounts(const Transaction& tx, const std::vector<Block>& blocks)
+{
+    std::vector<TransactionAmount> retval;
+    const auto amountOf = [&retval](const Address& address) -> TransactionAmount&
+    {
+        const auto it = std::find_if(retval.begin(), retval.end(),
+            [&address](const auto& item) { return item.address == address; });
+
+        return it != retval.end() ? *it : retval.emplace_back(TransactionAmount{ address });
+    };
+
+    if (!tx.isCoinbase())
+    {
+        for (const auto& txin : tx.txIns())
+        {
+            // an input of a block that was never validated may spend an
+            // output that isn't there, it doesn't count for anyone
+            if (const auto txout = FindOutput(blocks, txin.txOutPt()); txout != nullptr)
+            {
+                amountOf(txout->address()).spent += txout->amount();
+            }
+        }
+    }
+
+    for (const auto& txout : tx.txOuts())
+    {
+        amountOf(txout.address()).received += txout.amount();
+    }
+
+    return retval;
+}
+
+} // namespace
+
+const AddressLedger* AddressHistory::find(const Address& address) const
+{
+    if (const auto it = _ledgers.find(address); it != _ledgers.end())
+    {
+        return &(it->second);
+    }
+
+    return nullptr;
+}
+
+double AddressHistory::balance(const Address& address) const
+{
+    if (const auto it = _balances.find(address); it != _balances.end())
+    {
+        return it->second;
+    }
+
+    return 0.0;
+}
+
+AddressLedger AddressHistory::page(const Address& address, std::size_t skip, std::size_t count) const
+{
+    const auto ledger = find(address);
+    if (ledger == nullptr || skip >= ledger->size())
+    {
+        return {};
+    }
+
+    const auto first = ledger->rbegin() + static_cast<std::ptrdiff_t>(skip);
+    const auto last = first + static_cast<std::ptrdiff_t>(std::min(count, ledger->size() - skip));
+    return { first, last };
+}
+
+void AddressHistory::connect(const Block& block, const std::vector<Block>& blocks)
+{
+    for (const auto& tx : block.transactions())
+    {
+        // the change is taken off what was spent in one step
+        for (const auto& item : GetTransactionAmounts(tx, blocks))
+        {
+            const auto amount = item.received - item.spent;
+            _ledgers[item.address].push_back({ block.index(), tx.id(), block.time(), amount });
+            _balances[item.address] += amount;
+        }
+    }
+}
+
+void AddressHistory::disconnect(const Block& block, const std::vector<Block>& blocks)
+{
+    for (const auto& tx : block.transactions())
+    {
+        for (const auto& item : GetTransactionAmounts(tx, blocks))
+        {
+            const auto it = _ledgers.find(item.address);
+            if (it == _ledgers.end())
+            {
+                continue;
+            }
+
+            auto& ledger = it->second;
+            auto& balance = _balances[item.address];
+            while (!ledger.empty() && ledger.back().blockIdx == block.index())
+            {
+                balance -= ledger.back().amount;
+                ledger.pop_back();
+            }
+
+            // so rounding errors in the balance don't outlive the ledger
+            if (ledger.empty())
+            {
+                _ledgers.erase(it);
+                _balances.erase(item.address);
+            }
+        }
+    }
+}
+
+void AddressHistory::clear()
+{
+    _ledgers.clear();
+    _balances.clear();
+}
+
+} // namespace ash
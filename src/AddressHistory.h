@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "Address.h"
+#include "Block.h"
+#include "Hash256.h"
+
+namespace ash
+{
+
+struct LedgerInfo
+{
+    std::uint64_t   blockIdx;
+    Hash256         txid;
+    BlockTime       time;
+    double          amount;
+
+    bool operator==(const LedgerInfo& rhs) const
+    {
+        return blockIdx == rhs.blockIdx
+            && txid == rhs.txid;
+    }
+
+    bool operator!=(const LedgerInfo& rhs) const
+    {
+        return !operator==(rhs);
+    }
+};
+
+using AddressLedger = std::vector<LedgerInfo>;
+
+//! The transactions that paid or spent from each address of a chain,
+//  oldest first. A transaction has one entry per address it touches
+//  with what the address received less what it spent. Lookups can run
+//  on any number of threads as long as no block is connected at the
+//  same time
+class AddressHistory final
+{
+    std::unordered_map<Address, AddressLedger>  _ledgers;
+
+    // the sum of each ledger's amounts
+    std::unordered_map<Address, double>         _balances;
+
+public:
+    // nullptr if the address has no history
+    const AddressLedger* find(const Address& address) const;
+
+    // what the address was paid less what it spent, 0 if it has
+    // no history
+    double balance(const Address& address) const;
+
+    // up to `count` entries of the address newest first, after
+    // skipping the `skip` newest ones
+    AddressLedger page(const Address& address, std::size_t skip, std::size_t count) const;
+
+    // appends the block's entries, the outputs its transactions
+    // spend are looked up in `blocks`. Inputs whose output is not
+    // there are left out
+    void connect(const Block& block, const std::vector<Block>& blocks);
+
+    // undoes connect() for the last block that was connected
+    void disconnect(const Block& block, const std::vector<Block>& blocks);
+
+    void clear();
+};
+
+} // namespace ash
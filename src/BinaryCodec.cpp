@@ -0,0 +1,224 @@
+#include <fmt/core.h>
+
+#include "Blockchain.h"
+#include "BinaryCodec.h"
+
+namespace ash
+{
+
+namespace codec
+{
+
+void WriteFrameHeader(Writer& writer, std::string_view message, std::string_view type)
+{
+    writer.u32(FORMAT_VERSION);
+    writer.string(message);
+    writer.string(type);
+}
+
+FrameHeader ReadFrameHeader(Reader& reader)
+{
+    FrameHeader retval;
+    retval.version = reader.u32();
+    if (retval.version > FORMAT_VERSION)
+    {
+        throw std::runtime_error(fmt::format("unsupported codec version {}", retval.version));
+    }
+
+    reader.string(retval.message);
+    reader.string(retval.type);
+    return retval;
+}
+
+} // namespace codec
+
+namespace
+{
+
+// hashes keep the layout of the hex strings they used to be so the
+// bytes on disk and on the wire, and the transaction hashes that are
+// taken over them, stay the same
+void write_hash(codec::Writer& writer, const Hash256& hash)
+{
+    std::array<char, Hash256::HEX_SIZE> text;
+    writer.string(std::string_view{ text.data(), hash.toChars(text.data()) });
+}
+
+Hash256 read_hash(codec::Reader& reader)
+{
+    const auto raw = reader.bytes(reader.u32());
+    const auto retval = Hash256::FromHex({ reinterpret_cast<const char*>(raw.data()), raw.size() });
+    if (!retval.has_value())
+    {
+        throw std::runtime_error("codec hash is not a hex string");
+    }
+
+    return *retval;
+}
+
+// the same goes for addresses and their base58 text
+void write_address(codec::Writer& writer, const Address& address)
+{
+    Address::TextBuffer buffer;
+    writer.string(address.text(buffer));
+}
+
+Address read_address(codec::Reader& reader)
+{
+    const auto raw = reader.bytes(reader.u32());
+    return Address::FromText({ reinterpret_cast<const char*>(raw.data()), raw.size() });
+}
+
+} // namespace
+
+void write_data(codec::Writer& writer, const TxOutPoint& pt)
+{
+    writer.u64(pt.blockIndex);
+    writer.u64(pt.txIndex);
+    writer.u64(pt.txOutIndex);
+}
+
+void write_data(codec::Writer& writer, const TxIn& txin)
+{
+    write_data(writer, txin.txOutPt());
+    writer.string(txin._signature);
+}
+
+void write_data(codec::Writer& writer, const TxOut& txout)
+{
+    write_address(writer, txout._address);
+    writer.f64(txout._amount);
+}
+
+void write_data(codec::Writer& writer, const Transaction& tx)
+{
+    write_hash(writer, tx._id);
+
+    writer.length(tx.txIns().size());
+    for (const auto& txin : tx.txIns())
+    {
+        write_data(writer, txin);
+    }
+
+    writer.length(tx.txOuts().size());
+    for (const auto& txout : tx.txOuts())
+    {
+        write_data(writer, txout);
+    }
+
+    writer.u64(tx.extraNonce());
+}
+
+void write_block(codec::Writer& writer, const Block& block)
+{
+    writer.u64(block.index());
+    writer.u64(block.nonce());
+    writer.u64(block.difficulty());
+    writer.string(block._hashed._data);
+    writer.u64(static_cast<std::uint64_t>(block.time().time_since_epoch().count()));
+    write_hash(writer, block._hash);
+    write_hash(writer, block._hashed._prev);
+    writer.string(block._miner);
+
+    const auto& txs = block.transactions();
+    writer.length(txs.size());
+    for (const auto& tx : txs)
+    {
+        write_data(writer, tx);
+    }
+}
+
+void write_blocks(codec::Writer& writer, const Block* blocks, std::size_t count)
+{
+    writer.length(count);
+    for (auto idx = 0u; idx < count; idx++)
+    {
+        write_block(writer, blocks[idx]);
+    }
+}
+
+void read_data(codec::Reader& reader, TxOutPoint& pt)
+{
+    pt.blockIndex = reader.u64();
+    pt.txIndex = reader.u64();
+    pt.txOutIndex = reader.u64();
+}
+
+void read_data(codec::Reader& reader, TxIn& txin)
+{
+    read_data(reader, txin.txOutPt());
+    reader.string(txin._signature);
+}
+
+void read_data(codec::Reader& reader, TxOut& txout)
+{
+    txout._address = read_address(reader);
+    txout._amount = reader.f64();
+}
+
+void read_data(codec::Reader& reader, Transaction& tx, std::uint32_t version)
+{
+    tx._id = read_hash(reader);
+
+    // the counts are not trusted for reserving memory, a bad count
+    // runs out of data instead
+    tx._txIns.clear();
+    const auto txincount = reader.u32();
+    for (auto idx = 0u; idx < txincount; idx++)
+    {
+        read_data(reader, tx._txIns.emplace_back());
+    }
+
+    tx._txOuts.clear();
+    const auto txoutcount = reader.u32();
+    for (auto idx = 0u; idx < txoutcount; idx++)
+    {
+        read_data(reader, tx._txOuts.emplace_back());
+    }
+
+    tx._extraNonce = version >= 1 ? reader.u64() : 0;
+}
+
+void read_block(codec::Reader& reader, Block& block, std::uint32_t version)
+{
+    block._hashed._index = reader.u64();
+    block._hashed._nonce = reader.u64();
+    block._hashed._difficulty = reader.u64();
+    reader.string(block._hashed._data);
+    block._hashed._time = BlockTime{ std::chrono::milliseconds{ reader.u64() } };
+    block._hash = read_hash(reader);
+    block._hashed._prev = read_hash(reader);
+    reader.string(block._miner);
+
+    auto& txs = block.transactions();
+    txs.clear();
+
+    const auto txcount = reader.u32();
+    for (auto idx = 0u; idx < txcount; idx++)
+    {
+        read_data(reader, txs.emplace_back(), version);
+    }
+}
+
+void read_blocks(codec::Reader& reader, Blockchain& chain, std::uint32_t version)
+{
+    chain.clear();
+
+    const auto count = reader.u32();
+    for (auto idx = 0u; idx < count; idx++)
+    {
+        Block block;
+        read_block(reader, block, version);
+        chain.appendBlock(std::move(block));
+    }
+}
+
+codec::Buffer EncodeBlock(const Block& block)
+{
+    codec::Buffer retval;
+    codec::Writer writer{ retval };
+    write_block(writer, block);
+    return retval;
+}
+
+} // namespace ash
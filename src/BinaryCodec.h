@@ -0,0 +1,192 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "Block.h"
+
+namespace ash
+{
+
+class Blockchain;
+
+namespace codec
+{
+
+// the binary format of blocks and transactions, shared by the chain
+// database, the websocket messages that carry blocks and hashing.
+// Readers are given the version the bytes were written with
+//
+//  version 0   the original chain.ashdb format
+//  version 1   the coinbase extra nonce follows each transaction
+constexpr std::uint32_t FORMAT_VERSION = 1;
+
+using Buffer = std::vector<std::uint8_t>;
+
+//! Appends to a caller's buffer. Integers are little endian, doubles
+//  are written as their bit pattern and strings and lists are
+//  prefixed with their length as a u32
+class Writer final
+{
+    Buffer&     _buffer;
+
+public:
+    explicit Writer(Buffer& buffer)
+        : _buffer{ buffer }
+    {
+        // nothing to do
+    }
+
+    template<typename T,
+        typename = typename std::enable_if<(std::is_unsigned<T>::value)>::type>
+    void integer(T value)
+    {
+        for (auto idx = 0u; idx < sizeof(T); idx++)
+        {
+            _buffer.push_back(static_cast<std::uint8_t>(value >> (idx * 8)));
+        }
+    }
+
+    void u32(std::uint32_t value) { integer(value); }
+    void u64(std::uint64_t value) { integer(value); }
+    void f64(double value) { integer(std::bit_cast<std::uint64_t>(value)); }
+
+    void length(std::size_t value)
+    {
+        if (value > std::numeric_limits<std::uint32_t>::max())
+        {
+            throw std::length_error("codec length does not fit in 32 bits");
+        }
+
+        u32(static_cast<std::uint32_t>(value));
+    }
+
+    void string(std::string_view value)
+    {
+        length(value.size());
+        _buffer.insert(_buffer.end(), value.begin(), value.end());
+    }
+
+    // raw bytes without a length
+    void bytes(std::span<const std::uint8_t> value)
+    {
+        _buffer.insert(_buffer.end(), value.begin(), value.end());
+    }
+};
+
+//! Reads what a Writer wrote, throws std::runtime_error when the data
+//  ends early. The data must outlive the reader
+class Reader final
+{
+    std::span<const std::uint8_t>   _data;
+    std::size_t                     _offset = 0;
+
+    void require(std::size_t count) const
+    {
+        if (count > _data.size() - _offset)
+        {
+            throw std::runtime_error("unexpected end of codec data");
+        }
+    }
+
+public:
+    explicit Reader(std::span<const std::uint8_t> data)
+        : _data{ data }
+    {
+        // nothing to do
+    }
+
+    bool empty() const noexcept { return _offset == _data.size(); }
+    std::size_t offset() const noexcept { return _offset; }
+
+    template<typename T,
+        typename = typename std::enable_if<(std::is_unsigned<T>::value)>::type>
+    T integer()
+    {
+        require(sizeof(T));
+
+        T retval = 0;
+        for (auto idx = 0u; idx < sizeof(T); idx++)
+        {
+            retval |= static_cast<T>(_data[_offset + idx]) << (idx * 8);
+        }
+
+        _offset += sizeof(T);
+        return retval;
+    }
+
+    std::uint32_t u32() { return integer<std::uint32_t>(); }
+    std::uint64_t u64() { return integer<std::uint64_t>(); }
+    double f64() { return std::bit_cast<double>(integer<std::uint64_t>()); }
+
+    void string(std::string& value)
+    {
+        const auto raw = bytes(u32());
+        value.assign(raw.begin(), raw.end());
+    }
+
+    std::string string()
+    {
+        std::string retval;
+        string(retval);
+        return retval;
+    }
+
+    // raw bytes without a length
+    std::span<const std::uint8_t> bytes(std::size_t count)
+    {
+        require(count);
+        auto retval = _data.subspan(_offset, count);
+        _offset += count;
+        return retval;
+    }
+};
+
+// websocket messages that carry blocks are sent as binary frames
+// that start with this header followed by the message's fields
+//
+//  u32     codec version of the fields
+//  string  message
+//  string  message-type
+struct FrameHeader
+{
+    std::uint32_t   version;
+    std::string     message;
+    std::string     type;
+};
+
+void WriteFrameHeader(Writer& writer, std::string_view message, std::string_view type);
+
+// throws if the frame is from a newer version
+FrameHeader ReadFrameHeader(Reader& reader);
+
+} // namespace codec
+
+void write_data(codec::Writer& writer, const TxOutPoint& pt);
+void write_data(codec::Writer& writer, const TxIn& txin);
+void write_data(codec::Writer& writer, const TxOut& txout);
+void write_data(codec::Writer& writer, const Transaction& tx);
+void write_block(codec::Writer& writer, const Block& block);
+
+// a u32 count followed by the blocks
+void write_blocks(codec::Writer& writer, const Block* blocks, std::size_t count);
+
+void read_data(codec::Reader& reader, TxOutPoint& pt);
+void read_data(codec::Reader& reader, TxIn& txin);
+void read_data(codec::Reader& reader, TxOut& txout);
+void read_data(codec::Reader& reader, Transaction& tx, std::uint32_t version);
+void read_block(codec::Reader& reader, Block& block, std::uint32_t version);
+
+// replaces the chain's blocks without validating them
+void read_blocks(codec::Reader& reader, Blockchain& chain, std::uint32_t version);
+
+codec::Buffer EncodeBlock(const Block& block);
+
+} // namespace ash
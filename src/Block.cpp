@@ -4,6 +4,8 @@
 
 #include "CryptoUtils.h"
 #include "Block.h"
+#include "BlockHeader.h"
+#include "HashWriter.h"
 
 namespace nl = nlohmann;
 
@@ -42,20 +44,13 @@ void from_json(const nl::json& j, Block& b)
 
 bool ValidHash(const Block& block)
 {
-    const auto computedHash = CalculateBlockHash(block);
-    if (computedHash != block.hash())
+    const auto computedDigest = CalculateBlockDigest(block);
+    if (computedDigest != block.hash().bytes())
     {
         return false;
     }
 
-    std::string zeros;
-    zeros.assign(block.difficulty(), '0');
-    if (block.hash().compare(0, block.difficulty(), zeros) != 0)
-    {
-        return false;
-    }
-
-    return true;
+    return ash::crypto::HasLeadingZeroNibbles(computedDigest, block.difficulty());
 }
 
 bool ValidNewBlock(const Block& block, const Block& prevblock)
@@ -69,17 +64,17 @@ bool ValidNewBlock(const Block& block, const Block& prevblock)
         && block.previousHash() == prevblock.hash();
 }
 
-std::string CalculateBlockHash(
+Hash256 CalculateBlockHash(
     std::uint64_t index, 
     std::uint64_t nonce, 
     std::uint64_t difficulty,
     BlockTime time,
     const std::string& data, 
-    const std::string& previous,
+    const Hash256& previous,
     const std::string& extraText)
 {
-    std::stringstream ss;
-    ss << index
+    crypto::HashWriter writer{ crypto::HashWriter::Mode::COMPAT };
+    writer << index
         << nonce
         << difficulty
         << data
@@ -87,25 +82,15 @@ std::string CalculateBlockHash(
         << previous
         << extraText;
 
-    return ash::crypto::SHA256(ss.str());
+    return Hash256{ writer.digest() };
 }
 
-std::string CalculateBlockHash(const Block& block)
+Hash256 CalculateBlockHash(const Block& block)
 {
-    const auto extra = 
-        ash::crypto::SHA256(nl::json(block.transactions()).dump());
-
-    return CalculateBlockHash(
-        block.index(),
-        block.nonce(),
-        block.difficulty(),
-        block.time(),
-        block.data(),
-        block.previousHash(),
-        extra );
+    return Hash256{ CalculateBlockDigest(block) };
 }
 
-Block::Block(std::uint64_t index, std::string_view prevHash, Transactions&& txs)
+Block::Block(std::uint64_t index, const Hash256& prevHash, Transactions&& txs)
     : _logger(ash::initializeLogger("Block"))
 {
     _hashed._index = index;
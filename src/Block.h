@@ -24,26 +24,26 @@ void from_json(const nl::json& j, Block& b);
 bool ValidHash(const Block& block);
 bool ValidNewBlock(const Block& block, const Block& prevblock);
 
-std::string CalculateBlockHash(const Block& block);
-std::string CalculateBlockHash(
+Hash256 CalculateBlockHash(const Block& block);
+Hash256 CalculateBlockHash(
     std::uint64_t index, 
     std::uint64_t nonce, 
     std::uint64_t difficulty,
     BlockTime time,
     const std::string& data, 
-    const std::string& previous,
+    const Hash256& previous,
     const std::string& extra);
 
 class Block 
 {
-    friend void read_block(std::istream& stream, Block& block);
-    friend void write_block(std::ostream& stream, const Block& block);
+    friend void read_block(codec::Reader& reader, Block& block, std::uint32_t version);
+    friend void write_block(codec::Writer& writer, const Block& block);
     friend void from_json(const nl::json& j, Block& b);
     friend class Miner;
 
 public:
     Block() = default;
-    Block(std::uint64_t index, std::string_view prevHash, Transactions&& tx);
+    Block(std::uint64_t index, const Hash256& prevHash, Transactions&& tx);
 
     bool operator==(const Block& other) const;
     bool operator!=(const Block& other) const
@@ -55,11 +55,12 @@ public:
     std::uint64_t nonce() const { return _hashed._nonce; }
     std::uint64_t difficulty() const { return _hashed._difficulty; }
     
-    std::string data() const { return _hashed._data;  }
+    const std::string& data() const noexcept { return _hashed._data;  }
     void setData(std::string_view data) { _hashed._data = data; }
 
     BlockTime time() const { return _hashed._time; }
-    std::string previousHash() const { return _hashed._prev; }
+    const Hash256& previousHash() const noexcept { return _hashed._prev; }
+    void setPreviousHash(const Hash256& prev) { _hashed._prev = prev; }
 
     const Transactions& transactions() const { return _hashed._txs; }
     Transactions& transactions()
@@ -68,12 +69,12 @@ public:
             (static_cast<const Block*>(this))->transactions());
     }
 
-    std::string hash() const { return _hash; }
+    const Hash256& hash() const noexcept { return _hash; }
 
     std::string miner() const { return _miner; }
     void setMiner(std::string_view val) { _miner = val; }
 
-    void setMinedData(std::uint64_t nonce, std::uint64_t diff, BlockTime time, std::string_view hash)
+    void setMinedData(std::uint64_t nonce, std::uint64_t diff, BlockTime time, const Hash256& hash)
     {
         _hashed._nonce = nonce;
         _hashed._difficulty = diff;
@@ -89,13 +90,13 @@ private:
         std::uint64_t       _difficulty;
         std::string         _data;
         BlockTime           _time;
-        std::string         _prev;
+        Hash256             _prev;
         Transactions        _txs;
     };
 
     HashedData      _hashed;
 
-    std::string     _hash;
+    Hash256         _hash;
     std::string     _miner;
     SpdLogPtr       _logger;
 };
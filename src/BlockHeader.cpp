@@ -0,0 +1,311 @@
+#include <cassert>
+#include <limits>
+#include <charconv>
+#include <vector>
+
+#include "BlockHeader.h"
+#include "HashWriter.h"
+#include "MerkleTree.h"
+
+namespace ash
+{
+
+namespace
+{
+
+// the v2 header is disabled until a height is configured
+std::uint64_t headerV2Height = std::numeric_limits<std::uint64_t>::max();
+
+template<typename T>
+void WriteLittleEndian(std::uint8_t* dest, T value)
+{
+    for (auto idx = 0u; idx < sizeof(T); idx++)
+    {
+        dest[idx] = static_cast<std::uint8_t>(value >> (idx * 8));
+    }
+}
+
+// the second SHA-256 block of a v2 header, its last 32 bytes
+// followed by the padding and the 768 bit message length
+std::array<std::uint8_t, crypto::SHA256_BLOCK_SIZE> MakeFinalBlock(const BlockHeader& header)
+{
+    std::array<std::uint8_t, crypto::SHA256_BLOCK_SIZE> retval{};
+    std::copy(header.begin() + BLOCK_HEADER_MIDSTATE_SIZE, header.end(), retval.begin());
+
+    retval[BLOCK_HEADER_V2_SIZE - BLOCK_HEADER_MIDSTATE_SIZE] = 0x80;
+
+    const std::uint64_t bits = BLOCK_HEADER_V2_SIZE * 8;
+    for (auto idx = 0u; idx < 8u; idx++)
+    {
+        retval[retval.size() - 1 - idx] = static_cast<std::uint8_t>(bits >> (idx * 8));
+    }
+
+    return retval;
+}
+
+} // namespace
+
+void SetHeaderV2Height(std::uint64_t height)
+{
+    headerV2Height = height;
+}
+
+std::uint64_t HeaderV2Height()
+{
+    return headerV2Height;
+}
+
+std::uint32_t BlockHeaderVersion(std::uint64_t index)
+{
+    return index >= headerV2Height ? BLOCK_HEADER_V2 : BLOCK_HEADER_V1;
+}
+
+BlockCommitment CalculateBlockCommitment(const Block& block)
+{
+    return CalculateBlockCommitment(block.data(), CalculateMerkleRoot(block.transactions()));
+}
+
+BlockCommitment CalculateBlockCommitment(std::string_view data, const crypto::Digest& merkleRoot)
+{
+    crypto::HashWriter writer{ crypto::HashWriter::Mode::BINARY };
+    writer << data;
+    writer.bytes(merkleRoot.data(), merkleRoot.size());
+    return writer.digest();
+}
+
+BlockHeader MakeBlockHeader(const Block& block)
+{
+    return MakeBlockHeader(
+        block.index(),
+        block.nonce(),
+        block.difficulty(),
+        block.time(),
+        block.previousHash(),
+        CalculateBlockCommitment(block));
+}
+
+BlockHeader MakeBlockHeader(
+    std::uint64_t index,
+    std::uint64_t nonce,
+    std::uint64_t difficulty,
+    BlockTime time,
+    const Hash256& previous,
+    const BlockCommitment& commitment)
+{
+    BlockHeader header;
+    auto data = header.data();
+
+    WriteLittleEndian(data, BLOCK_HEADER_V2);
+    WriteLittleEndian(data + 4, static_cast<std::uint32_t>(difficulty));
+    WriteLittleEndian(data + 8, index);
+    WriteLittleEndian(data + 16,
+        static_cast<std::uint64_t>(time.time_since_epoch().count()));
+    // the genesis block's null previous hash is all zeros
+    std::copy(previous.bytes().begin(), previous.bytes().end(), data + 24);
+    std::copy(commitment.begin(), commitment.end(), data + 56);
+    WriteLittleEndian(data + BLOCK_HEADER_V2_NONCE_OFFSET, nonce);
+
+    return header;
+}
+
+Hash256 CalculateBlockHeaderHash(const BlockHeader& header)
+{
+    return Hash256{ CalculateBlockHeaderDigests({ header }).front() };
+}
+
+std::vector<crypto::Digest> CalculateBlockHeaderDigests(const std::vector<BlockHeader>& headers)
+{
+    const auto& kernel = crypto::GetSha256Kernel();
+    const auto count = headers.size();
+
+    std::vector<crypto::Sha256State> states(count, crypto::SHA256_INITIAL_STATE);
+    std::vector<std::array<std::uint8_t, crypto::SHA256_BLOCK_SIZE>> finals;
+    std::vector<const std::uint8_t*> blocks;
+    finals.reserve(count);
+    blocks.reserve(count);
+
+    for (const auto& header : headers)
+    {
+        finals.push_back(MakeFinalBlock(header));
+        blocks.push_back(header.data());
+    }
+
+    kernel.compress(states.data(), blocks.data(), count);
+
+    for (auto idx = 0u; idx < count; idx++)
+    {
+        blocks[idx] = finals[idx].data();
+    }
+
+    kernel.compress(states.data(), blocks.data(), count);
+
+    std::vector<crypto::Digest> retval;
+    retval.reserve(count);
+    for (const auto& state : states)
+    {
+        retval.push_back(crypto::Sha256StateToDigest(state));
+    }
+
+    return retval;
+}
+
+crypto::Digest CalculateBlockDigest(const Block& block)
+{
+    if (BlockHeaderVersion(block.index()) == BLOCK_HEADER_V2)
+    {
+        BlockHeaderHasher hasher{ block, block.difficulty(), block.time() };
+        return hasher.digest(block.nonce());
+    }
+
+    // a single v1 hash streams the fields rather than building
+    // the text the hasher keeps around for trying many nonces
+    crypto::HashWriter writer{ crypto::HashWriter::Mode::COMPAT };
+    writer << block.index()
+        << block.nonce()
+        << block.difficulty()
+        << block.data()
+        << block.time().time_since_epoch().count()
+        << block.previousHash()
+        << ash::crypto::SHA256(nl::json(block.transactions()).dump());
+
+    return writer.digest();
+}
+
+std::vector<crypto::Digest> CalculateBlockDigests(const Block* blocks, std::size_t count)
+{
+    std::vector<crypto::Digest> retval(count);
+
+    std::vector<BlockHeader> headers;
+    std::vector<std::size_t> positions;
+
+    for (auto idx = 0u; idx < count; idx++)
+    {
+        const auto& block = blocks[idx];
+        if (BlockHeaderVersion(block.index()) == BLOCK_HEADER_V2)
+        {
+            headers.push_back(MakeBlockHeader(block));
+            positions.push_back(idx);
+        }
+        else
+        {
+            retval[idx] = CalculateBlockDigest(block);
+        }
+    }
+
+    const auto digests = CalculateBlockHeaderDigests(headers);
+    for (auto idx = 0u; idx < digests.size(); idx++)
+    {
+        retval[positions[idx]] = digests[idx];
+    }
+
+    return retval;
+}
+
+//*** BlockHeaderHasher
+BlockHeaderHasher::BlockHeaderHasher(const Block& block, std::uint64_t difficulty, BlockTime time)
+    : BlockHeaderHasher(block, difficulty, time,
+        BlockHeaderVersion(block.index()) == BLOCK_HEADER_V2
+            ? CalculateBlockCommitment(block) : BlockCommitment{})
+{
+    // nothing to do
+}
+
+BlockHeaderHasher::BlockHeaderHasher(const Block& block, std::uint64_t difficulty, BlockTime time,
+        const BlockCommitment& commitment)
+    : _version{ BlockHeaderVersion(block.index()) },
+      _kernel{ crypto::GetSha256Kernel() }
+{
+    if (_version == BLOCK_HEADER_V2)
+    {
+        _header = MakeBlockHeader(block.index(), 0, difficulty, time,
+                    block.previousHash(), commitment);
+
+        // the time lives in the first block so this never changes
+        _final = MakeFinalBlock(_header);
+    }
+    else
+    {
+        _prefix = std::to_string(block.index());
+        _suffixHead = std::to_string(difficulty) + block.data();
+        _suffixTail = block.previousHash().hex()
+            + ash::crypto::SHA256(nl::json(block.transactions()).dump());
+    }
+
+    setTime(time);
+}
+
+void BlockHeaderHasher::setTime(BlockTime time)
+{
+    const auto millis =
+        static_cast<std::uint64_t>(time.time_since_epoch().count());
+
+    if (_version == BLOCK_HEADER_V2)
+    {
+        WriteLittleEndian(_header.data() + 16, millis);
+        updateMidstate();
+    }
+    else
+    {
+        _suffix = _suffixHead + std::to_string(time.time_since_epoch().count()) + _suffixTail;
+    }
+}
+
+void BlockHeaderHasher::setCommitment(const BlockCommitment& commitment)
+{
+    assert(_version == BLOCK_HEADER_V2);
+
+    // the commitment straddles both SHA-256 blocks of the header
+    std::copy(commitment.begin(), commitment.end(), _header.data() + 56);
+    _final = MakeFinalBlock(_header);
+    updateMidstate();
+}
+
+void BlockHeaderHasher::updateMidstate()
+{
+    const std::uint8_t* first = _header.data();
+    _midstate = crypto::SHA256_INITIAL_STATE;
+    _kernel.compress(&_midstate, &first, 1);
+}
+
+crypto::Digest BlockHeaderHasher::digest(std::uint64_t nonce)
+{
+    crypto::Digest retval;
+
+    if (_version == BLOCK_HEADER_V2)
+    {
+        // only the tail of the header needs to be hashed
+        _kernel.hashNonces(_midstate, _final.data(),
+            BLOCK_HEADER_V2_TAIL_NONCE_OFFSET, nonce, 1, &retval);
+    }
+    else
+    {
+        char noncetext[24];
+        const auto result = std::to_chars(std::begin(noncetext), std::end(noncetext), nonce);
+
+        _hash.Update(reinterpret_cast<const CryptoPP::byte*>(_prefix.data()), _prefix.size());
+        _hash.Update(reinterpret_cast<const CryptoPP::byte*>(noncetext),
+            static_cast<std::size_t>(result.ptr - noncetext));
+        _hash.Update(reinterpret_cast<const CryptoPP::byte*>(_suffix.data()), _suffix.size());
+        _hash.Final(retval.data());
+    }
+
+    return retval;
+}
+
+void BlockHeaderHasher::digests(std::uint64_t nonce, std::size_t count, crypto::Digest* out)
+{
+    if (_version == BLOCK_HEADER_V2)
+    {
+        _kernel.hashNonces(_midstate, _final.data(),
+            BLOCK_HEADER_V2_TAIL_NONCE_OFFSET, nonce, count, out);
+    }
+    else
+    {
+        for (auto idx = 0u; idx < count; idx++)
+        {
+            out[idx] = digest(nonce + idx);
+        }
+    }
+}
+
+} // namespace ash
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <cryptopp/sha.h>
+
+#include "Block.h"
+#include "CryptoUtils.h"
+#include "Sha256.h"
+
+namespace ash
+{
+
+// v1 headers are the original stringstream text format and
+// v2 headers are the fixed-size binary layout below
+constexpr std::uint32_t BLOCK_HEADER_V1 = 1u;
+constexpr std::uint32_t BLOCK_HEADER_V2 = 2u;
+
+// v2 header layout, all integers are little endian
+//
+//  offset  size  field
+//  0       4     version
+//  4       4     difficulty
+//  8       8     index
+//  16      8     time (milliseconds since epoch)
+//  24      32    previous block hash (raw bytes)
+//  56      32    commitment to the block's data and transactions
+//  88      8     nonce
+//
+// The nonce is the last field and everything up to byte 64 fits
+// in the first SHA-256 block, so the hash state of that first
+// block (the "midstate") can be computed once and reused for
+// every nonce
+constexpr std::size_t BLOCK_HEADER_V2_SIZE = 96u;
+constexpr std::size_t BLOCK_HEADER_V2_NONCE_OFFSET = 88u;
+constexpr std::size_t BLOCK_HEADER_MIDSTATE_SIZE = 64u;
+constexpr std::size_t BLOCK_HEADER_V2_TAIL_NONCE_OFFSET =
+    BLOCK_HEADER_V2_NONCE_OFFSET - BLOCK_HEADER_MIDSTATE_SIZE;
+
+static_assert(crypto::ValidSha256NonceOffset(BLOCK_HEADER_V2_TAIL_NONCE_OFFSET));
+
+using BlockHeader = std::array<std::uint8_t, BLOCK_HEADER_V2_SIZE>;
+using BlockCommitment = std::array<std::uint8_t, 32>;
+
+// Every node on a network must use the same activation height. This
+// is set once at startup before any blocks are loaded or validated.
+void SetHeaderV2Height(std::uint64_t height);
+std::uint64_t HeaderV2Height();
+
+std::uint32_t BlockHeaderVersion(std::uint64_t index);
+
+// SHA-256 of the block's data string followed by the merkle
+// root of its transactions
+BlockCommitment CalculateBlockCommitment(const Block& block);
+BlockCommitment CalculateBlockCommitment(std::string_view data, const crypto::Digest& merkleRoot);
+
+BlockHeader MakeBlockHeader(const Block& block);
+BlockHeader MakeBlockHeader(
+    std::uint64_t index,
+    std::uint64_t nonce,
+    std::uint64_t difficulty,
+    BlockTime time,
+    const Hash256& previous,
+    const BlockCommitment& commitment);
+
+Hash256 CalculateBlockHeaderHash(const BlockHeader& header);
+
+// hashes the headers side by side with the SHA-256 kernel
+std::vector<crypto::Digest> CalculateBlockHeaderDigests(const std::vector<BlockHeader>& headers);
+
+// raw digest of the block's header in the format of its height
+crypto::Digest CalculateBlockDigest(const Block& block);
+
+// raw digests of `count` blocks, the v2 headers among them are
+// hashed together
+std::vector<crypto::Digest> CalculateBlockDigests(const Block* blocks, std::size_t count);
+
+//! Hashes a block template for different nonces without allocating.
+//  v2 headers reuse the SHA-256 state of the first 64 bytes of the
+//  header and v1 headers reuse the text on either side of the nonce
+class BlockHeaderHasher final
+{
+    using FinalBlock = std::array<std::uint8_t, crypto::SHA256_BLOCK_SIZE>;
+
+    std::uint32_t               _version;
+    const crypto::Sha256Kernel& _kernel;
+    BlockHeader                 _header;
+    crypto::Sha256State         _midstate;
+    FinalBlock                  _final;     // padded last 32 bytes of the header
+    CryptoPP::SHA256            _hash;
+
+    // v1 text is "<index><nonce><difficulty><data><time><prev><extra>"
+    std::string         _prefix;
+    std::string         _suffix;
+    std::string         _suffixHead;
+    std::string         _suffixTail;
+
+    void updateMidstate();
+
+public:
+    BlockHeaderHasher(const Block& block, std::uint64_t difficulty, BlockTime time);
+
+    // `commitment` must be CalculateBlockCommitment(block), it is
+    // only used by v2 headers
+    BlockHeaderHasher(const Block& block, std::uint64_t difficulty, BlockTime time,
+        const BlockCommitment& commitment);
+
+    void setTime(BlockTime time);
+
+    // v2 headers only, for when transactions are added to the block
+    // while it is being mined
+    void setCommitment(const BlockCommitment& commitment);
+
+    crypto::Digest digest(std::uint64_t nonce);
+
+    // digests of `count` consecutive nonces starting at `nonce`
+    void digests(std::uint64_t nonce, std::size_t count, crypto::Digest* out);
+};
+
+} // namespace ash
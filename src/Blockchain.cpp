@@ -1,12 +1,14 @@
-#include <set>
-
-#include <boost/range/adaptor/indexed.hpp>
+#include <algorithm>
+#include <iterator>
+#include <tuple>
 
 #include <range/v3/all.hpp>
 #include <range/v3/view/filter.hpp>
 #include <range/v3/view/transform.hpp>
 
 #include "CryptoUtils.h"
+#include "FirstFailure.h"
+#include "BlockHeader.h"
 #include "Blockchain.h"
 
 namespace nl = nlohmann;
@@ -14,6 +16,41 @@ namespace nl = nlohmann;
 namespace ash
 {
 
+namespace
+{
+
+// blocks are hashed in batches so the SHA-256 kernel
+// can work on several headers at once
+constexpr std::size_t ValidationBatchSize = 256;
+
+// the checks that only need the block itself and its digest
+bool IsValidBlock(const Block& block, const crypto::Digest& digest)
+{
+    const auto& txs = block.transactions();
+    return block.hash().bytes() == digest
+        && ash::crypto::HasLeadingZeroNibbles(digest, block.difficulty())
+        && !txs.empty()
+        && !txs.front().txIns().empty()
+        && !txs.front().txOuts().empty()
+        && txs.front().isCoinbase();
+}
+
+// the work every node has always given a block, 2^difficulty, a hash
+// can't have more than 64 leading zero nibbles
+ChainWork BlockWork(const Block& block)
+{
+    const auto nibbles = std::min<std::uint64_t>(block.difficulty(), 64u);
+    return ChainWork{ 1 } << static_cast<unsigned>(nibbles);
+}
+
+bool IsValidLink(const Block& current, const Block& prev)
+{
+    return (current.index() == prev.index() + 1)
+        && (current.previousHash() == prev.hash());
+}
+
+} // namespace
+
 void to_json(nl::json& j, const Blockchain& b)
 {
     for (const auto& block : b._blocks)
@@ -28,7 +65,7 @@ void from_json(const nl::json& j, Blockchain& b)
 
     for (const auto& jblock : j.items())
     {
-        b._blocks.push_back(jblock.value().get<Block>());
+        b.appendBlock(jblock.value().get<Block>());
     }
 }
 
@@ -68,143 +105,69 @@ void from_json(const nlohmann::json& j, AddressLedger& ledger)
     }
 }
 
-UnspentTxOuts GetUnspentTxOuts(const Blockchain& chain, const std::string& address)
+UnspentTxOuts GetUnspentTxOuts(const Blockchain& chain, const std::optional<Address>& address)
 {
-    auto cmp = 
-        [](const UnspentTxOut& a, const UnspentTxOut& b)
-        {
-            return std::hash<UnspentTxOut>{}(a) < std::hash<UnspentTxOut>{}(b);
-        };
-
-    std::set<UnspentTxOut, decltype(cmp)> outs(cmp);
+    const auto& unspent = chain.unspentOutputs();
 
-    for (const auto& block : chain)
+    UnspentTxOuts retval;
+    if (!address.has_value())
     {
-        for (const auto& txitem : block.transactions() | boost::adaptors::indexed())
+        retval.reserve(unspent.size());
+        for (const auto& [point, txout] : unspent)
         {
-            const auto& tx = txitem.value();
-
-            assert(tx.txIns().size() > 0);
-            assert(tx.txOuts().size() > 0);
-
-            for (const auto& txoutitem : tx.txOuts() | boost::adaptors::indexed())
-            {
-                const auto& txout = txoutitem.value();
-                if (address.size() > 0 && txout.address() != address)
-                {
-                    continue;
-                }
-
-                outs.insert({
-                    block.index(),
-                    static_cast<std::uint64_t>(txitem.index()),
-                    static_cast<std::uint64_t>(txoutitem.index()),
-                    txout.address(), 
-                    txout.amount()});
-            }
-
-            // if this is a coinbase transaction then we do not need
-            // to process the TxIns
-            if (tx.isCoinbase())
-            {
-                continue;
-            }
+            retval.push_back({ point.blockIndex, point.txIndex, point.txOutIndex,
+                txout.address(), txout.amount() });
+        }
+    }
+    else if (const auto entry = unspent.findAddress(*address); entry != nullptr)
+    {
+        retval.reserve(entry->outputs.size());
+        for (const auto& point : entry->outputs)
+        {
+            const auto txout = unspent.find(point);
+            assert(txout != nullptr);
 
-            for (const auto& txin : tx.txIns())
-            {
-                auto it = std::find_if(outs.begin(), outs.end(),
-                   [txin = txin](const UnspentTxOut& utxout)
-                   {
-                        return (txin.txOutPt().blockIndex == utxout.blockIndex)
-                            && (txin.txOutPt().txIndex == utxout.txIndex)
-                            && (txin.txOutPt().txOutIndex == utxout.txOutIndex);
-                   });
-
-                if (it != outs.end())
-                {
-                    outs.erase(it);
-                }
-            }
+            retval.push_back({ point.blockIndex, point.txIndex, point.txOutIndex,
+                txout->address(), txout->amount() });
         }
     }
 
-    UnspentTxOuts retval;
-    std::move(outs.begin(), outs.end(), std::back_inserter(retval));
+    // newest first, which is the order CreateTransaction() spends
+    // them in. A queued transaction was made from an older chain so
+    // it cannot have spent the outputs added since
+    std::sort(retval.begin(), retval.end(),
+        [](const UnspentTxOut& lhs, const UnspentTxOut& rhs)
+        {
+            return std::tie(lhs.blockIndex, lhs.txIndex, lhs.txOutIndex)
+                > std::tie(rhs.blockIndex, rhs.txIndex, rhs.txOutIndex);
+        });
 
     return retval;
 }
 
-AddressLedger GetAddressLedger(const Blockchain& chain, const std::string& address)
+AddressLedger GetAddressLedger(const Blockchain& chain, const Address& address)
 {
-    ash::AddressLedger ledger;
-
-    for (const auto& block : chain)
-    {
-        const auto fullblock = ash::GetBlockDetails(chain, block.index());
-        for (const auto& tx : fullblock.transactions())
-        {
-            bool debit = false;
-            assert(tx.txOuts().size() > 0);
-            
-            for (const auto& txout : tx.txOuts())
-            {
-                if (txout.address() == address)
-                {
-                    ledger.push_back(
-                        LedgerInfo{ block.index(), tx.id(), block.time(), txout.amount() });
-
-                    break;
-                }
-            }
-
-            // this is a debit for the address so pop the last ledger entry, accumulate
-            // the total of all the TxIns and put it back to the ledger
-            assert(tx.txIns().size() > 0);
-            assert(tx.txIns().at(0).txOutPt().address.has_value());
-
-            if (!tx.isCoinbase()
-                && *(tx.txIns().at(0).txOutPt().address) == address)
-            {
-                double txInTotal = std::accumulate(
-                    tx.txIns().begin(), tx.txIns().end(), 0.0,
-                    [](auto accum, const ash::TxIn& txin)
-                    {
-                        return accum + *(txin.txOutPt().amount);
-                    });
-
-                auto amount = txInTotal - ledger.back().amount;
-                ledger.pop_back();
-                ledger.push_back(
-                    LedgerInfo{ block.index(), tx.id(), block.time(), amount * -1.0 });
-            }
-        }
-    }
-
-    return ledger;
+    const auto ledger = chain.addressHistory().find(address);
+    return ledger != nullptr ? *ledger : AddressLedger{};
 }
 
-double GetAddressBalance(const Blockchain& chain, const std::string& address)
+double GetAddressBalance(const Blockchain& chain, const Address& address)
 {
-    const auto ledger = ash::GetAddressLedger(chain, address);
-    return std::accumulate(
-        ledger.begin(), ledger.end(), 0.0,
-        [](auto accum, const auto& entry)
-        {
-            return accum + entry.amount;
-        });
+    return chain.addressHistory().balance(address);
 }
 
-std::tuple<TxResult, ash::Transaction> CreateTransaction(Blockchain& chain, std::string_view senderPK, std::string_view receiver, double amount)
+std::tuple<TxResult, ash::Transaction> CreateTransaction(Blockchain& chain, std::string_view senderPK, const Address& receiver, double amount)
 {
     // first get the address of the sender from the privateKey
     const auto senderAddress = ash::crypto::GetAddressFromPrivateKey(senderPK);
 
-    if (boost::iequals(receiver, senderAddress))
+    if (receiver == senderAddress)
     {
         return { TxResult::NOOP_TRANSACTION, {} };
     }
 
-    // now get all of the unspent txouts of the sender
+    // now get all of the unspent txouts of the sender, these come
+    // from the address index so only the sender's outputs are read
     auto senderUnspentList = ash::GetUnspentTxOuts(chain, senderAddress);
     if (senderUnspentList.size() == 0)
     {
@@ -238,9 +201,7 @@ std::tuple<TxResult, ash::Transaction> CreateTransaction(Blockchain& chain, std:
 
     for (const auto& uout : includedUnspentOuts)
     {
-        // TODO: Signature!!!
-        txins.emplace_back(uout.blockIndex,
-            uout.txIndex, uout.txOutIndex, "signature");
+        txins.emplace_back(uout.blockIndex, uout.txIndex, uout.txOutIndex);
     }
 
     auto& outs = tx.txOuts();
@@ -250,26 +211,15 @@ std::tuple<TxResult, ash::Transaction> CreateTransaction(Blockchain& chain, std:
         outs.emplace_back(senderAddress, leftoverAmount);
     }
 
+    // the inputs and outputs are final now
+    ash::SignTransaction(tx, senderPK);
+
     return { TxResult::SUCCESS, tx };
 }
 
-// TODO: The implementation of this should be improved to be faster
-// perhaps with a persisted index or something
-std::optional<TxPoint> FindTransaction(const Blockchain& chain, std::string_view txid)
+std::optional<TxPoint> FindTransaction(const Blockchain& chain, const Hash256& txid)
 {
-    for (const auto& block: chain)
-    {
-        for (const auto& txitem : block.transactions() | boost::adaptors::indexed())
-        {
-            const auto& tx = txitem.value();
-            if (tx.id() == txid)
-            {
-                return TxPoint{ block.index(), txitem.index() };
-            }
-        }
-    }
-
-    return {};
+    return chain.transactionIndex().find(txid);
 }
 
 Block GetBlockDetails(const Blockchain& chain, std::size_t index)
@@ -326,11 +276,53 @@ bool Blockchain::addNewBlock(const Block& block, bool checkPreviousBlock)
         return false;
     }
 
-    _blocks.push_back(block);
+    if (const auto result = ValidateBlockTransactions(*this, block); !result.valid())
+    {
+        _logger->warn("rejected block #{}, transaction #{} is invalid ({}): {}",
+            block.index(), result.txIndex, ToString(result.reason), result.detail);
+
+        return false;
+    }
+
+    appendBlock(block);
+    connectBlocks();
 
     return true;
 }
 
+void Blockchain::resize(std::size_t size)
+{
+    if (size < _connectedHeight)
+    {
+        // undoing a block costs about as much as connecting it so a
+        // reorg that removes most of the chain starts over instead
+        if (_connectedHeight - size > size)
+        {
+            resetIndexes();
+        }
+        else
+        {
+            for (; _connectedHeight > size; _connectedHeight--)
+            {
+                const auto& block = _blocks[_connectedHeight - 1];
+                _unspent.disconnect();
+                _txIndex.disconnect(block);
+                _history.disconnect(block, _blocks);
+            }
+        }
+    }
+
+    const auto previousSize = _cumWork.size();
+    _blocks.resize(size);
+    _cumWork.resize(size);
+
+    // blocks added by growing the chain are default constructed
+    for (auto idx = previousSize; idx < size; idx++)
+    {
+        _cumWork[idx] = BlockWork(_blocks[idx]) + (idx > 0 ? _cumWork[idx - 1] : ChainWork{});
+    }
+}
+
 bool Blockchain::isValidBlockPair(std::size_t idx) const
 {
     if (idx > _blocks.size() || idx < 1)
@@ -339,48 +331,152 @@ bool Blockchain::isValidBlockPair(std::size_t idx) const
     }
 
     const auto& current = _blocks.at(idx);
-    const auto& prev = _blocks.at(idx - 1);
-
-    return (current.index() == prev.index() + 1)
-        && (current.previousHash() == prev.hash())
-        && (CalculateBlockHash(current) == current.hash());
+    return IsValidBlock(current, CalculateBlockDigest(current))
+        && IsValidLink(current, _blocks.at(idx - 1));
 }
 
 bool Blockchain::isValidChain() const
 {
-    if (_blocks.size() == 0)
+    return !firstInvalidBlock().has_value();
+}
+
+std::optional<std::size_t> Blockchain::firstInvalidBlock(std::size_t threads, std::size_t trusted) const
+{
+    if (_blocks.size() <= 1)
+    {
+        return {};
+    }
+
+    // the genesis block is taken as it is
+    const auto first = std::min(trusted + 1, _blocks.size());
+    const auto failure = first + FindFirstFailure(_blocks.size() - first, ValidationBatchSize, threads,
+        [&, this](std::size_t start, std::size_t end) -> std::optional<std::size_t>
+        {
+            const auto digests = CalculateBlockDigests(&_blocks[first + start], end - start);
+            for (auto idx = 0u; idx < digests.size(); idx++)
+            {
+                if (!IsValidBlock(_blocks[first + start + idx], digests[idx]))
+                {
+                    return start + idx;
+                }
+            }
+
+            return {};
+        });
+
+    // the links are cheap compared to hashing so they are checked
+    // in order, only up to the first block that failed on its own
+    for (auto idx = 1u; idx < failure; idx++)
+    {
+        if (!IsValidLink(_blocks[idx], _blocks[idx - 1]))
+        {
+            return idx;
+        }
+    }
+
+    if (failure < _blocks.size())
+    {
+        return failure;
+    }
+
+    return {};
+}
+
+std::optional<std::size_t> Blockchain::firstInvalidTransactions(std::size_t threads) const
+{
+    if (_blocks.empty())
     {
-        return true;
+        return {};
     }
 
+    // the blocks are replayed onto a chain of their own so each one is
+    // checked against the outputs left by the ones before it
+    Blockchain replay;
+    replay._blocks.reserve(_blocks.size());
+    replay.appendBlock(_blocks.front());
+
     for (auto idx = 1u; idx < _blocks.size(); idx++)
     {
-        if (!isValidBlockPair(idx))
+        const auto& block = _blocks[idx];
+        if (const auto result = ValidateBlockTransactions(replay, block, threads); !result.valid())
         {
-            return false;
+            _logger->debug("block #{} transaction #{} is invalid ({}): {}",
+                block.index(), result.txIndex, ToString(result.reason), result.detail);
+
+            return idx;
         }
+
+        replay.appendBlock(block);
     }
 
-    return true;
+    return {};
 }
 
-std::uint64_t Blockchain::cumDifficulty() const
+const UtxoSet& Blockchain::unspentOutputs() const
 {
-    return cumDifficulty(_blocks.size() - 1);
+    connectBlocks();
+    return _unspent;
 }
 
-std::uint64_t Blockchain::cumDifficulty(std::size_t idx) const
+const TxIndex& Blockchain::transactionIndex() const
 {
-    std::uint64_t total = 0;
-    auto lastBlockIt = std::next(_blocks.begin(), idx);
+    connectBlocks();
+    return _txIndex;
+}
+
+const AddressHistory& Blockchain::addressHistory() const
+{
+    connectBlocks();
+    return _history;
+}
 
-    for (auto current = _blocks.begin(); current < lastBlockIt; current++)
+void Blockchain::connectBlocks() const
+{
+    for (; _connectedHeight < _blocks.size(); _connectedHeight++)
     {
-        total += static_cast<std::uint64_t>
-            (std::pow(2u, current->difficulty()));
+        const auto& block = _blocks[_connectedHeight];
+        if (const auto missing = _unspent.connect(block); missing > 0)
+        {
+            // only blocks whose transactions were never validated, such
+            // as legacy blocks loaded from disk, get here
+            _logger->warn("block #{} spends {} output(s) that are not unspent", block.index(), missing);
+        }
+
+        _txIndex.connect(block);
+        _history.connect(block, _blocks);
     }
+}
 
-    return total;
+void Blockchain::resetIndexes()
+{
+    _unspent.clear();
+    _txIndex.clear();
+    _history.clear();
+    _connectedHeight = 0;
+}
+
+void Blockchain::appendBlock(Block block)
+{
+    auto work = BlockWork(block);
+    if (!_cumWork.empty())
+    {
+        work += _cumWork.back();
+    }
+
+    _blocks.push_back(std::move(block));
+    _cumWork.push_back(std::move(work));
+}
+
+ChainWork Blockchain::cumDifficulty() const
+{
+    return cumDifficulty(_blocks.size() - 1);
+}
+
+ChainWork Blockchain::cumDifficulty(std::size_t idx) const
+{
+    assert(idx <= _blocks.size());
+    assert(_cumWork.size() == _blocks.size());
+    return idx == 0 ? ChainWork{} : _cumWork[idx - 1];
 }
 
 std::size_t Blockchain::reQueueTransactions(Block& block)
@@ -435,22 +531,32 @@ void Blockchain::queueTransaction(Transaction&& tx)
     _txQueue.push(std::move(tx));
 }
 
-BlockUniquePtr Blockchain::createUnminedBlock(const std::string& coinbasewallet)
+BlockUniquePtr Blockchain::createUnminedBlock(const Address& coinbasewallet)
 {
     const auto newblockidx = this->size();
 
     ash::Transactions txs;
     txs.push_back(ash::CreateCoinbaseTransaction(newblockidx, coinbasewallet));
 
+    auto queued = dequeueTransactions(newblockidx);
+    std::move(queued.begin(), queued.end(), std::back_inserter(txs));
+
+    return std::make_unique<Block>(newblockidx, this->back().hash(), std::move(txs));
+}
+
+Transactions Blockchain::dequeueTransactions(std::uint64_t blockIdx)
+{
+    ash::Transactions txs;
+
     while (!_txQueue.empty())
     {
         auto& tx = _txQueue.front();
-        tx.calcuateId(newblockidx);
+        tx.calcuateId(blockIdx);
         txs.push_back(std::move(tx));
         _txQueue.pop();
     }
 
-    return std::make_unique<Block>(newblockidx, this->back().hash(), std::move(txs));
+    return txs;
 }
 
 } // namespace
\ No newline at end of file
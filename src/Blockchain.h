@@ -1,13 +1,20 @@
 #pragma once
 
 #include <cstdint>
+#include <optional>
 #include <vector>
 #include <queue>
 
+#include <boost/multiprecision/cpp_int.hpp>
+
+#include "AddressHistory.h"
 #include "Transactions.h"
 #include "Settings.h"
 #include "Block.h"
 #include "AshLogger.h"
+#include "TxIndex.h"
+#include "TxValidation.h"
+#include "UtxoSet.h"
 
 namespace ash
 {
@@ -23,8 +30,13 @@ constexpr auto BLOCK_INTERVAL   = 10u; // in blocks
 class Blockchain;
 using BlockChainPtr = std::unique_ptr<Blockchain>;
 
-struct LedgerInfo;
-using AddressLedger = std::vector<LedgerInfo>;
+// the work of a chain, the sum of 2^difficulty over its blocks. A hash
+// has 64 nibbles so one block is worth at most 2^64, and 192 bits
+// hold 2^64 such blocks
+using ChainWork = boost::multiprecision::number<
+    boost::multiprecision::cpp_int_backend<192, 192,
+        boost::multiprecision::unsigned_magnitude,
+        boost::multiprecision::unchecked, void>>;
 
 void to_json(nl::json& j, const Blockchain& b);
 void from_json(const nl::json& j, Blockchain& b);
@@ -34,54 +46,50 @@ void from_json(const nl::json& j, LedgerInfo& li);
 void to_json(nl::json& j, const AddressLedger& ledger);
 void from_json(const nl::json& j, AddressLedger& ledger);
 
-UnspentTxOuts GetUnspentTxOuts(const Blockchain& chain, const std::string& address = {});
+// the chain's unspent outputs newest first, of every address
+// when `address` is empty. See Blockchain::unspentOutputs()
+UnspentTxOuts GetUnspentTxOuts(const Blockchain& chain, const std::optional<Address>& address = {});
 
-AddressLedger GetAddressLedger(const Blockchain& chain, const std::string& address);
+// every entry of the address oldest first, see Blockchain::addressHistory()
+AddressLedger GetAddressLedger(const Blockchain& chain, const Address& address);
 
-// TODO: should this return an optional?
-double GetAddressBalance(const Blockchain& chain, const std::string& address);
+// the sum of the address's ledger, kept with it so the chain isn't
+// walked. The unspent outputs of a chain that was never validated,
+// like the legacy test chains, may not add up to it
+double GetAddressBalance(const Blockchain& chain, const Address& address);
 
-std::tuple<TxResult, ash::Transaction> CreateTransaction(Blockchain& chain, std::string_view senderPK, std::string_view receiver, double amount);
+std::tuple<TxResult, ash::Transaction> CreateTransaction(Blockchain& chain, std::string_view senderPK, const Address& receiver, double amount);
 
-// 0 - block index, 1 - tx index
-using TxPoint = std::tuple<std::uint64_t, std::uint64_t>;
-std::optional<TxPoint> FindTransaction(const Blockchain& chain, std::string_view txid);
+// looked up in Blockchain::transactionIndex()
+std::optional<TxPoint> FindTransaction(const Blockchain& chain, const Hash256& txid);
 
 // TODO: should this return an optional?
 // fills in the TxIn TxPoint info for all the Transactions in the Block
 Block GetBlockDetails(const Blockchain& chain, std::size_t index);
 
-struct LedgerInfo
-{
-    std::uint64_t   blockIdx;
-    std::string     txid;
-    BlockTime       time;
-    double          amount;
-
-    bool operator==(const LedgerInfo& rhs) const
-    {
-        return blockIdx == rhs.blockIdx
-            && txid == rhs.txid;
-    }
-
-    bool operator!=(const LedgerInfo& rhs) const
-    {
-        return !operator==(rhs);
-    }
-};
-
 //! This class is not thread safe and assumes that the
 //  client handles synchronization
 class Blockchain final
 {
     std::vector<Block>          _blocks;
-    UnspentTxOuts               _unspentTxOuts;
+
+    // caught up with `_blocks` on first use, see connectBlocks()
+    mutable UtxoSet             _unspent;
+    mutable TxIndex             _txIndex;
+    mutable AddressHistory      _history;
+    mutable std::size_t         _connectedHeight = 0;
+
+    // the work of the blocks up to and including each height, always
+    // the same size as `_blocks`, see appendBlock()
+    std::vector<ChainWork>      _cumWork;
+
     std::queue<Transaction>     _txQueue; // transactions waiting to be mined by this miner
     SpdLogPtr                   _logger;
 
     friend class ChainDatabase;
     friend void to_json(nl::json& j, const Blockchain& b);
     friend void from_json(const nl::json& j, Blockchain& b);
+    friend void read_blocks(codec::Reader& reader, Blockchain& chain, std::uint32_t version);
 
 public:
     using iterator = std::vector<Block>::iterator;
@@ -129,12 +137,13 @@ public:
     void clear()
     {
         _blocks.clear();
+        _cumWork.clear();
+        resetIndexes();
     }
 
-    void resize(std::size_t size)
-    {
-        _blocks.resize(size);
-    }
+    // the blocks that are removed are disconnected from the
+    // unspent outputs and the indexes
+    void resize(std::size_t size);
 
     auto at(std::size_t index) const -> decltype(_blocks.at(index))
     {
@@ -154,20 +163,62 @@ public:
                 static_cast<const Blockchain&>(*this).txAt(blockIndex,txIndex));
     }
 
+    // the block's transactions are checked against the unspent
+    // outputs of the chain, see ValidateBlockTransactions()
     bool addNewBlock(const Block& block);
     bool addNewBlock(const Block& block, bool checkPreviousBlock);
-    BlockUniquePtr createUnminedBlock(const std::string& coinbasewallet);
+    BlockUniquePtr createUnminedBlock(const Address& coinbasewallet);
 
     bool isValidBlockPair(std::size_t idx) const;
     bool isValidChain() const;
 
-    std::uint64_t cumDifficulty() const;
-    std::uint64_t cumDifficulty(std::size_t idx) const;
+    // the height of the first block that fails validation. The
+    // per-block checks run on `threads` threads (0 uses every core)
+    // and are followed by a sequential pass over the links. Blocks
+    // up to and including `trusted` are only checked for linkage
+    std::optional<std::size_t> firstInvalidBlock(std::size_t threads = 0, std::size_t trusted = 0) const;
+
+    // the height of the first block whose transactions fail
+    // ValidateBlockTransactions() against the blocks before it, the
+    // genesis block is taken as it is. Used on chains from peers,
+    // which firstInvalidBlock() only checks for their proof of work
+    std::optional<std::size_t> firstInvalidTransactions(std::size_t threads = 0) const;
+
+    // the outputs the next block's transactions can spend. Every
+    // block added with addNewBlock() is connected as it is added,
+    // blocks loaded some other way are connected on first use
+    const UtxoSet& unspentOutputs() const;
+
+    // where each transaction is by its id, connected along with
+    // the unspent outputs
+    const TxIndex& transactionIndex() const;
+
+    // the ledger of each address, connected along with the
+    // unspent outputs
+    const AddressHistory& addressHistory() const;
+
+    // the work of the blocks before `idx`, the sum of 2^difficulty.
+    // The totals are kept as blocks are added and removed so this
+    // only reads them
+    ChainWork cumDifficulty() const;
+    ChainWork cumDifficulty(std::size_t idx) const;
     std::uint64_t getAdjustedDifficulty();
 
     void queueTransaction(Transaction&& tx);
     std::size_t transactionQueueSize() const noexcept;
     std::size_t reQueueTransactions(Block& block);
+
+    // removes every queued transaction with its id calculated
+    // for the block at `blockIdx`
+    Transactions dequeueTransactions(std::uint64_t blockIdx);
+
+private:
+    // adds `block` and its work without checking it
+    void appendBlock(Block block);
+
+    // connects the blocks that have been added since the last call
+    void connectBlocks() const;
+    void resetIndexes();
 };
 
 }
@@ -1,5 +1,7 @@
+#include <algorithm>
 #include <fstream>
-#include <ostream>
+
+#include <nlohmann/json.hpp>
 
 #include "Transactions.h"
 #include "Blockchain.h"
@@ -8,157 +10,46 @@
 namespace ash
 {
 
-void write_data(std::ostream& stream, const TxOutPoint& pt)
-{
-    ash::db::write_data(stream, pt.blockIndex);
-    ash::db::write_data(stream, pt.txIndex);
-    ash::db::write_data(stream, pt.txOutIndex);
-}
-
-void write_data(std::ostream& stream, const TxIn& tx)
-{
-    ash::write_data(stream, tx.txOutPt());
-    ash::db::write_data(stream, tx.signature());
-}
-
-void write_data(std::ostream& stream, const TxOut& tx)
-{
-    ash::db::write_data(stream, tx.address());
-    ash::db::write_data(stream, tx.amount());
-}
-
-void write_data(std::ostream& stream, const Transaction& tx)
-{
-    ash::db::write_data(stream, tx.id());
-    
-    {
-        const auto txins = tx.txIns();
-        auto txinsize = static_cast<ash::db::StrLenType>(txins.size());
-        ash::db::write_data<ash::db::StrLenType>(stream, txinsize);
-        for (const auto& txin : txins)
-        {
-            write_data(stream, txin);
-        }
-    }
-
-    {
-        const auto txouts = tx.txOuts();
-        auto txoutsize = static_cast<ash::db::StrLenType>(txouts.size());
-        ash::db::write_data<ash::db::StrLenType>(stream, txoutsize);
-        for (const auto& txout : txouts)
-        {
-            write_data(stream, txout);
-        }
-    }
-}
-
-void write_block(std::ostream& stream, const Block& block)
-{
-    ash::db::write_data<std::uint64_t>(stream, block.index());
-    ash::db::write_data<std::uint64_t>(stream, block.nonce());
-    ash::db::write_data<std::uint64_t>(stream, block.difficulty());
-    ash::db::write_data(stream, block.data());
-
-    std::uint64_t dtime = 
-        static_cast<std::uint64_t>(block.time().time_since_epoch().count());
-    ash::db::write_data<std::uint64_t>(stream, dtime);
-
-    ash::db::write_data(stream, block.hash());
-    ash::db::write_data(stream, block.previousHash());
-    ash::db::write_data(stream, block.miner());
-
-    const auto& txs = block.transactions();
-    auto txsize = static_cast<ash::db::StrLenType>(txs.size());
-    ash::db::write_data<ash::db::StrLenType>(stream, txsize);
-
-    for (const auto& tx : txs)
-    {
-        write_data(stream, tx);
-    }
-}
-
-void read_data(std::istream& stream, TxOutPoint& pt)
+namespace
 {
-    ash::db::read_data(stream, pt.blockIndex);
-    ash::db::read_data(stream, pt.txIndex);
-    ash::db::read_data(stream, pt.txOutIndex);
-}
 
-void read_data(std::istream& stream, TxIn& txin)
-{
-    ash::read_data(stream, txin.txOutPt());
-    ash::db::read_data(stream, txin._signature);
-}
+// chain.ashdb starts with this magic and the codec version the blocks
+// after it were written with, files from before the header was added
+// are version 0
+constexpr std::string_view DatabaseMagic = "ASHDB";
+constexpr std::uint32_t DatabaseVersion = codec::FORMAT_VERSION;
 
-void read_data(std::istream& stream, TxOut& txout)
+void WriteHeader(codec::Writer& writer)
 {
-    ash::db::read_data(stream, txout._address);
-    ash::db::read_data(stream, txout._amount);
+    writer.bytes({ reinterpret_cast<const std::uint8_t*>(DatabaseMagic.data()), DatabaseMagic.size() });
+    writer.u32(DatabaseVersion);
 }
 
-void read_data(std::istream& stream, Transaction& tx)
+std::uint32_t ReadHeader(codec::Reader& reader, const codec::Buffer& contents)
 {
-    ash::db::read_data(stream, tx._id);
+    const auto hasMagic = contents.size() >= DatabaseMagic.size()
+        && std::equal(DatabaseMagic.begin(), DatabaseMagic.end(), contents.begin());
 
+    if (!hasMagic)
     {
-        ash::db::StrLenType txincount;
-        ash::db::read_data(stream, txincount);
-        auto& txins = tx.txIns();
-        for (ash::db::StrLenType x = 0; x < txincount; x++)
-        {
-            TxIn txin;
-            read_data(stream, txin);
-            txins.push_back(txin);
-        }
+        // a version 0 file starts with the genesis block
+        return 0;
     }
 
-    {
-        ash::db::StrLenType txoutcount;
-        ash::db::read_data(stream, txoutcount);
-        auto& txouts = tx.txOuts();
-        for (ash::db::StrLenType x = 0; x < txoutcount; x++)
-        {
-            TxOut txout;
-            read_data(stream, txout);
-            txouts.push_back(txout);
-        }
-    }
+    reader.bytes(DatabaseMagic.size());
+    return reader.u32();
 }
 
-void read_block(std::istream& stream, Block& block)
-{
-    ash::db::read_data(stream, block._hashed._index);
-    ash::db::read_data(stream, block._hashed._nonce);
-    ash::db::read_data(stream, block._hashed._difficulty);
-    ash::db::read_data(stream, block._hashed._data);
-
-    std::uint64_t dtime;
-    ash::db::read_data(stream, dtime);
-    block._hashed._time = 
-        BlockTime{std::chrono::milliseconds{dtime}};
-
-    ash::db::read_data(stream, block._hash);
-    ash::db::read_data(stream, block._hashed._prev);
-    ash::db::read_data(stream, block._miner);
-
-    auto& txs = block.transactions();
-    auto txcount = static_cast<ash::db::StrLenType>(txs.size());
-    ash::db::read_data(stream, txcount);
-
-    for (ash::db::StrLenType x = 0; x < txcount; x++)
-    {
-        Transaction tx;
-        read_data(stream, tx);
-        txs.push_back(tx);
-    }
-}
+} // namespace
 
 constexpr std::string_view DatabaseFile = "chain.ashdb";
+constexpr std::string_view CheckpointFile = "assumevalid.json";
 
 ChainDatabase::ChainDatabase(std::string_view folder)
     : _folder{ folder },
       _path{ boost::filesystem::path { _folder.data()} },
       _dbfile { _path / DatabaseFile.data()},
+      _checkpointFile { _path / CheckpointFile.data() },
       _logger(ash::initializeLogger("ChainDatabase"))
 {
 }
@@ -188,17 +79,49 @@ void ChainDatabase::initialize(Blockchain& blockchain, GenesisCallback gcb)
 
     _logger->info("loading blockchain from {}", _dbfile.string());
 
-    std::ifstream ifs(_dbfile.c_str(), std::ios_base::binary);
-    while (ifs.peek() != EOF)
+    codec::Buffer contents(boost::filesystem::file_size(_dbfile));
+
+    {
+        std::ifstream ifs(_dbfile.c_str(), std::ios_base::binary);
+        ifs.read(reinterpret_cast<char*>(contents.data()), contents.size());
+    }
+
+    codec::Reader reader{ contents };
+    const auto version = ReadHeader(reader, contents);
+    if (version > DatabaseVersion)
+    {
+        throw std::logic_error(fmt::format("unsupported chain database version {}", version));
+    }
+
+    while (!reader.empty())
     {
         Block block;
-        read_block(ifs, block);
-        blockchain._blocks.push_back(block);
+        read_block(reader, block, version);
+        blockchain.appendBlock(std::move(block));
+    }
+
+    const auto trusted = trustedHeight(blockchain);
+    if (trusted > 0)
+    {
+        _logger->info("assuming blocks up to #{} are valid, verifying {} block(s) after it",
+            trusted, blockchain.size() - trusted - 1);
+    }
+
+    if (const auto invalid = blockchain.firstInvalidBlock(0, trusted); invalid.has_value())
+    {
+        throw std::logic_error(fmt::format("invalid chain at block #{}", *invalid));
+    }
+
+    if (version < DatabaseVersion)
+    {
+        _logger->info("migrating chain database from version {} to {}", version, DatabaseVersion);
+        writeChain(blockchain);
     }
 
-    if (!blockchain.isValidChain())
+    // everything up to the tip has been checked now
+    if (blockchain.size() - 1 > trusted)
     {
-        throw std::logic_error("invalid chain");
+        writeCheckpoint({ blockchain.size() - 1, blockchain.back().hash() });
     }
 
     boost::filesystem::path txidx { _path / "txinindx" };
@@ -210,22 +133,77 @@ void ChainDatabase::initialize(Blockchain& blockchain, GenesisCallback gcb)
         throw std::logic_error(fmt::format("could not open txin index: {}", status.ToString()));
     }
 
-    _logger->debug("loaded {} blocks from saved chain", blockchain.size());
+    // built here instead of by the first request that needs them
+    const auto& txindex = blockchain.transactionIndex();
+    _logger->debug("loaded {} blocks from saved chain, indexed {} transactions",
+        blockchain.size(), txindex.size());
 }
 
-void ChainDatabase::write(const Block& block)
+std::ofstream ChainDatabase::openForAppend()
 {
+    const bool created = !boost::filesystem::exists(_dbfile)
+        || boost::filesystem::file_size(_dbfile) == 0;
+
     std::ofstream ofs(_dbfile.c_str(), std::ios::app | std::ios::out | std::ios::binary);
-    write_block(ofs, block);
+    if (created)
+    {
+        codec::Buffer header;
+        codec::Writer writer{ header };
+        WriteHeader(writer);
+        ofs.write(reinterpret_cast<const char*>(header.data()), header.size());
+    }
+
+    return ofs;
+}
+
+void ChainDatabase::write(const Block& block)
+{
+    write(EncodeBlock(block));
+}
+
+void ChainDatabase::write(const codec::Buffer& block)
+{
+    auto ofs = openForAppend();
+    ofs.write(reinterpret_cast<const char*>(block.data()), block.size());
 }
 
 void ChainDatabase::writeChain(const Blockchain& chain)
 {
     _logger->debug("writing {} blocks to file {}", chain.size(), _dbfile.string());
-    std::ofstream ofs(_dbfile.c_str(), std::ios::app | std::ios::out | std::ios::binary);
+
+    codec::Buffer contents;
+    codec::Writer writer{ contents };
+    WriteHeader(writer);
     for (const auto& block : chain)
     {
-        write_block(ofs, block);
+        write_block(writer, block);
+    }
+
+    // the chain goes to a file next to the old one which is then moved
+    // over it, so a crash leaves either the old chain or the new one
+    auto tempfile = _dbfile;
+    tempfile += ".tmp";
+
+    {
+        std::ofstream ofs(tempfile.c_str(), std::ios::trunc | std::ios::out | std::ios::binary);
+        ofs.write(reinterpret_cast<const char*>(contents.data()), contents.size());
+        ofs.flush();
+
+        if (!ofs)
+        {
+            throw std::runtime_error(fmt::format("could not write chain database file {}", tempfile.string()));
+        }
+    }
+
+    boost::filesystem::rename(tempfile, _dbfile);
+
+    // the checkpoint may not be part of the new chain
+    if (const auto checkpoint = readCheckpoint();
+        checkpoint.has_value()
+            && (checkpoint->height >= chain.size()
+                || chain.at(checkpoint->height).hash() != checkpoint->hash))
+    {
+        boost::filesystem::remove(_checkpointFile);
     }
 }
 
@@ -237,6 +215,74 @@ void ChainDatabase::reset()
     {
         boost::filesystem::remove(_dbfile);
     }
+
+    // the checkpoint may not be part of the next chain
+    if (boost::filesystem::exists(_checkpointFile))
+    {
+        boost::filesystem::remove(_checkpointFile);
+    }
+}
+
+std::optional<Checkpoint> ChainDatabase::readCheckpoint() const
+{
+    std::ifstream ifs(_checkpointFile.c_str());
+    if (!ifs)
+    {
+        return {};
+    }
+
+    const auto json = nl::json::parse(ifs, nullptr, false);
+    const auto hash = !json.is_discarded() && json.contains("hash") && json["hash"].is_string()
+        ? Hash256::FromHex(json["hash"].get<std::string>())
+        : std::nullopt;
+
+    if (!hash.has_value()
+        || !json.contains("height") || !json["height"].is_number_unsigned())
+    {
+        _logger->warn("ignoring malformed checkpoint file {}", _checkpointFile.string());
+        return {};
+    }
+
+    return Checkpoint{ json["height"].get<std::uint64_t>(), *hash };
+}
+
+void ChainDatabase::writeCheckpoint(const Checkpoint& checkpoint) const
+{
+    nl::json json;
+    json["height"] = checkpoint.height;
+    json["hash"] = checkpoint.hash;
+
+    std::ofstream ofs(_checkpointFile.c_str(), std::ios::trunc);
+    ofs << json.dump(4);
+
+    _logger->debug("wrote checkpoint at block #{} to {}", checkpoint.height, _checkpointFile.string());
+}
+
+std::size_t ChainDatabase::trustedHeight(const Blockchain& chain) const
+{
+    if (_verifyAll)
+    {
+        _logger->info("verifying every block in the chain");
+        return 0;
+    }
+
+    const auto checkpoint = _assumeValid.has_value() ? _assumeValid : readCheckpoint();
+    if (!checkpoint.has_value() || checkpoint->height == 0)
+    {
+        return 0;
+    }
+
+    // the chain must contain the checkpoint, a shorter chain or one
+    // that forked below it is verified in full
+    if (checkpoint->height >= chain.size()
+        || chain.at(checkpoint->height).hash() != checkpoint->hash)
+    {
+        _logger->warn("chain does not contain the checkpoint block #{} {}, verifying every block",
+            checkpoint->height, checkpoint->hash);
+        return 0;
+    }
+
+    return static_cast<std::size_t>(checkpoint->height);
 }
 
 } // namespace
@@ -1,4 +1,5 @@
 #pragma once
+#include <fstream>
 #include <string_view>
 #include <optional>
 
@@ -6,6 +7,7 @@
 
 #include <leveldb/db.h>
 
+#include "BinaryCodec.h"
 #include "Block.h"
 #include "AshLogger.h"
 
@@ -17,56 +19,19 @@ namespace db
 
 using LevelDBPtr = std::unique_ptr<leveldb::DB>;
 
-using ValueType = unsigned char;
-using Container = std::vector<ValueType>;
-using PointerType = char*;
-using StrLenType = std::uint32_t;
-
-template <typename T,
-    typename = typename std::enable_if<(std::is_integral<T>::value)>::type>
-inline void write_data(std::ostream& stream, T value)
-{
-    stream.write(reinterpret_cast<PointerType>(&value), sizeof(value));
-}
-
-inline void write_data(std::ostream& stream, double val)
-{
-    stream.write(reinterpret_cast<PointerType>(&val), sizeof(double));
-}
-
-inline void write_data(std::ostream& stream, std::string_view data)
-{
-    auto size = static_cast<StrLenType>(data.size());
-    write_data<StrLenType>(stream, size);
-    stream.write(data.data(), size);
-}
-
-template<typename T,
-    typename = typename std::enable_if<(std::is_integral<T>::value)>::type>
-inline void read_data(std::istream& stream, T& value)
-{
-    stream.read(reinterpret_cast<PointerType>(&value), sizeof(value));
-}
-
-inline void read_data(std::istream& stream, double& val)
-{
-    stream.read(reinterpret_cast<PointerType>(&val), sizeof(double));
-}
-
-inline void read_data(std::istream& stream, std::string& data)
-{
-    StrLenType len;
-    read_data(stream, len);
-
-    data.resize(len);
-    stream.read(reinterpret_cast<PointerType>(data.data()), len);
-}
-
 } // namespace ash::db
 
 class ChainDatabase;
 using ChainDatabasePtr = std::unique_ptr<ChainDatabase>;
 
+// a block known to be valid, the blocks up to it are only checked
+// for linkage when the chain is loaded
+struct Checkpoint
+{
+    std::uint64_t   height;
+    Hash256         hash;
+};
+
 class ChainDatabase final
 {
 
@@ -77,18 +42,46 @@ public:
     ~ChainDatabase();
 
     void write(const Block& block);
+
+    // appends a block that was already encoded with write_block()
+    void write(const codec::Buffer& block);
+
+    // replaces the saved chain with `chain`
     void writeChain(const Blockchain& chain);
 
     void initialize(Blockchain& chain, GenesisCallback gcb);
     void reset();
 
+    // a checkpoint from the settings is used instead of the one
+    // the node writes after it has validated the chain
+    void setAssumeValid(std::optional<Checkpoint> checkpoint)
+    {
+        _assumeValid = std::move(checkpoint);
+    }
+
+    // re-hash every block on the next load
+    void setVerifyAll(bool val) { _verifyAll = val; }
+
 private:
+    std::optional<Checkpoint> readCheckpoint() const;
+    void writeCheckpoint(const Checkpoint& checkpoint) const;
+
+    // the last block below which hashes are not recomputed
+    std::size_t trustedHeight(const Blockchain& chain) const;
+
+    // writes the file header when the file is new
+    std::ofstream openForAppend();
+
     std::string                 _folder;
 
     boost::filesystem::path     _path;
     boost::filesystem::path     _dbfile;
     // ash::db::LevelDBPtr         _txInIndex;
     leveldb::DB*                _txIndex = nullptr;
+
+    boost::filesystem::path     _checkpointFile;
+    std::optional<Checkpoint>   _assumeValid;
+    bool                        _verifyAll = false;
     
     SpdLogPtr                   _logger;
 };
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+
+#include "Hash256.h"
+
+namespace ash
+{
+
+//! Lock-free view of the newest block the node knows about.
+//  The node publishes the local chain's tip whenever that chain
+//  changes, along with the end of its last block's hash so work on
+//  a block whose parent was replaced goes stale, and queues the tip of a longer chain from a peer while
+//  it waits to be adopted. Both happen under the node's chain lock
+//  so they are never seen out of order. The miner polls it between
+//  batches of nonces without locking
+class ChainTip final
+{
+    std::atomic_uint64_t    _epoch = 0;
+    std::atomic_uint64_t    _height = 0;
+    std::atomic_uint64_t    _queued = 0;
+    std::atomic_uint64_t    _tipKey = 0;
+    std::atomic_bool        _keyed = false;
+    std::atomic_int64_t     _changed = 0; // steady clock nanoseconds
+
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // the local chain now ends at `height` with the block `hash`, a
+    // chain that was queued has been adopted or dropped by then. A
+    // null hash only publishes the height
+    void publish(std::uint64_t height, const Hash256& hash = {})
+    {
+        _height.store(height, std::memory_order_relaxed);
+        _tipKey.store(Key(hash), std::memory_order_relaxed);
+        _keyed.store(!hash.isNull(), std::memory_order_relaxed);
+        _queued.store(0, std::memory_order_relaxed);
+        touch();
+    }
+
+    // a chain from a peer that ends at `height` is waiting to be
+    // adopted, the local chain has not changed yet
+    void queue(std::uint64_t height)
+    {
+        _queued.store(height, std::memory_order_relaxed);
+        touch();
+    }
+
+    // incremented on every publish and queue
+    std::uint64_t epoch() const noexcept
+    {
+        return _epoch.load(std::memory_order_acquire);
+    }
+
+    // index of the last block of the local chain
+    std::uint64_t height() const noexcept
+    {
+        return _height.load(std::memory_order_relaxed);
+    }
+
+    // index of the last block of the queued chain, 0 when none is
+    std::uint64_t queued() const noexcept
+    {
+        return _queued.load(std::memory_order_relaxed);
+    }
+
+    // whether a block at `index` on top of `previous` would extend the
+    // local chain, which is always assumed when no hash was published
+    bool extends(std::uint64_t index, const Hash256& previous) const noexcept
+    {
+        if (!_keyed.load(std::memory_order_relaxed))
+        {
+            return true;
+        }
+
+        return index == height() + 1
+            && Key(previous) == _tipKey.load(std::memory_order_relaxed);
+    }
+
+    Clock::time_point changed() const noexcept
+    {
+        return Clock::time_point{ Clock::duration{ _changed.load(std::memory_order_relaxed) } };
+    }
+
+private:
+    // the leading bytes of a mined hash are zeros, the trailing ones are not
+    static std::uint64_t Key(const Hash256& hash) noexcept
+    {
+        std::uint64_t retval;
+        std::memcpy(&retval, hash.data() + Hash256::SIZE - sizeof(retval), sizeof(retval));
+        return retval;
+    }
+
+    void touch()
+    {
+        _changed.store(Clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+
+        // readers that see the new epoch also see the values above
+        _epoch.fetch_add(1, std::memory_order_release);
+    }
+};
+
+} // namespace ash
@@ -5,14 +5,43 @@
 
 #include "CryptoUtils.h"
 
-using namespace std::string_literals;
-
 namespace ash
 {
 
 namespace crypto
 {
 
+namespace
+{
+
+// decodes the lowercase hex string into `hex.size() / 2` bytes
+bool DecodeHex(std::string_view hex, std::uint8_t* out)
+{
+    auto nibble = 
+        [](char c) -> int
+        {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            return -1;
+        };
+
+    for (auto idx = 0u; idx < hex.size() / 2; idx++)
+    {
+        const auto high = nibble(hex[idx * 2]);
+        const auto low = nibble(hex[idx * 2 + 1]);
+        if (high < 0 || low < 0)
+        {
+            return false;
+        }
+
+        out[idx] = static_cast<std::uint8_t>((high << 4) | low);
+    }
+
+    return true;
+}
+
+} // namespace
+
 // sha256 of any string data
 std::string SHA256(std::string_view data)
 {
@@ -28,57 +57,71 @@ std::string SHA256(std::string_view data)
     return digest;
 }
 
-// sha256 of a hex string
-std::string SHA256HexString(std::string_view data)
+Digest SHA256Digest(std::string_view data)
 {
-    std::string digest;
+    Digest digest;
     CryptoPP::SHA256 hash;
-
-    auto ptr = reinterpret_cast<const CryptoPP::byte*>(data.data());
-    CryptoPP::StringSource temp(ptr, data.size(), true,
-        new CryptoPP::HexDecoder(
-            new CryptoPP::HashFilter(hash,
-                new CryptoPP::HexEncoder(
-                    new CryptoPP::StringSink(digest), false))));
+    hash.CalculateDigest(digest.data(),
+        reinterpret_cast<const CryptoPP::byte*>(data.data()), data.size());
 
     return digest;
 }
 
-std::string RIPEMD160HexString(std::string_view data)
+std::string DigestToHex(const Digest& digest)
 {
-    std::string digest;
-    CryptoPP::RIPEMD160 hash;
+    return BytesToHex(digest.data(), digest.size());
+}
 
-    auto ptr = reinterpret_cast<const CryptoPP::byte*>(data.data());
-    CryptoPP::StringSource temp(ptr, data.size(), true,
-        new CryptoPP::HexDecoder(
-            new CryptoPP::HashFilter(hash,
-                new CryptoPP::HexEncoder(
-                    new CryptoPP::StringSink(digest), false))));
+std::optional<Digest> DigestFromHex(std::string_view hex)
+{
+    if (hex.size() != std::tuple_size<Digest>::value * 2)
+    {
+        return {};
+    }
+
+    Digest digest;
+    if (!DecodeHex(hex, digest.data()))
+    {
+        return {};
+    }
 
     return digest;
 }
 
-constexpr auto base_count = 58u;
-constexpr std::string_view base58Alphabet = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
-std::string Base58Encode(CryptoPP::Integer num)
+std::string BytesToHex(const std::uint8_t* data, std::size_t size)
+{
+    // the returned string is the only allocation
+    constexpr std::string_view digits = "0123456789abcdef";
+
+    std::string retval(size * 2, '\0');
+    for (auto idx = 0u; idx < size; idx++)
+    {
+        retval[idx * 2] = digits[data[idx] >> 4];
+        retval[idx * 2 + 1] = digits[data[idx] & 0x0f];
+    }
+
+    return retval;
+}
+
+std::optional<std::vector<std::uint8_t>> BytesFromHex(std::string_view hex)
 {
-    std::string encoded; 
-    CryptoPP::Integer mod;
-    while (num >= base_count)
+    if (hex.size() % 2 != 0)
     {
-        CryptoPP::Integer div = num / base_count;
-        mod = (num - (base_count * div));
-        encoded = base58Alphabet[mod.ConvertToLong()] + encoded;
-        num = div;
+        return {};
     }
-    encoded = base58Alphabet[num.ConvertToLong()] + encoded;
-    return encoded;
+
+    std::vector<std::uint8_t> retval(hex.size() / 2);
+    if (!DecodeHex(hex, retval.data()))
+    {
+        return {};
+    }
+
+    return retval;
 }
 
 using FieldType = CryptoPP::ECDSA<CryptoPP::ECP, CryptoPP::SHA256>;
 
-std::string GetPublicKey(std::string_view privateKeyStr)
+FieldType::PrivateKey DecodePrivateKey(std::string_view privateKeyStr)
 {
     FieldType::PrivateKey privateKey;
 
@@ -90,6 +133,12 @@ std::string GetPublicKey(std::string_view privateKeyStr)
     x.Decode(decoder, decoder.MaxRetrievable());
 
     privateKey.Initialize(CryptoPP::ASN1::secp256k1(), x);
+    return privateKey;
+}
+
+std::string GetPublicKey(std::string_view privateKeyStr)
+{
+    const auto privateKey = DecodePrivateKey(privateKeyStr);
     
     FieldType::PublicKey publicKey;
     privateKey.MakePublicKey(publicKey);
@@ -111,36 +160,76 @@ std::string GetPublicKey(std::string_view privateKeyStr)
     return fmt::format("04{}{}",qx,qy);
 }
 
-std::string GetAddressFromPrivateKey(std::string_view privateKeyStr)
+Address GetAddressFromPrivateKey(std::string_view privateKeyStr)
 {
-    // 1 - Public ECDSA Key
-    const auto publicKey = ash::crypto::GetPublicKey(privateKeyStr);
+    return *GetAddressFromPublicKey(ash::crypto::GetPublicKey(privateKeyStr));
+}
 
-    // 2 - SHA-256 hash of 1
-    const auto publicKeyHash = ash::crypto::SHA256HexString(publicKey);
+std::optional<Address> GetAddressFromPublicKey(std::string_view publicKey)
+{
+    const auto bytes = BytesFromHex(publicKey);
+    if (!bytes.has_value())
+    {
+        return {};
+    }
 
-    // 3 - RIPEMD-160 Hash of 2
-    const auto ripeHash = ash::crypto::RIPEMD160HexString(publicKeyHash);
+    // the RIPEMD-160 of the SHA-256 of the key's raw bytes
+    std::array<std::uint8_t, CryptoPP::SHA256::DIGESTSIZE> digest;
+    CryptoPP::SHA256().CalculateDigest(digest.data(), bytes->data(), bytes->size());
 
-    //4 - Adding network bytes to 3
-    const auto step4 = "00"s + ripeHash;
+    Address::Hash160 hash;
+    CryptoPP::RIPEMD160().CalculateDigest(hash.data(), digest.data(), digest.size());
 
-    // 5 - SHA-256 hash of 4
-    auto networkBytesHash = ash::crypto::SHA256HexString(step4);
+    return Address{ hash };
+}
 
-    // 6 - SHA-256 hash of 5
-    networkBytesHash = ash::crypto::SHA256HexString(networkBytesHash);
+std::string SignDigest(std::string_view privateKeyStr, const Digest& digest)
+{
+    CryptoPP::AutoSeededRandomPool prng;
+    FieldType::Signer signer{ DecodePrivateKey(privateKeyStr) };
 
-    // 7 - First four bytes of 6
-    const auto step7 = networkBytesHash.substr(0, 8);
+    // Crypto++ writes r and s as fixed size big endian values
+    std::vector<std::uint8_t> signature(signer.MaxSignatureLength());
+    const auto length = signer.SignMessage(prng, digest.data(), digest.size(), signature.data());
 
-    // 8 - Adding 7 at the end of 4
-    // const auto step8 = step4 + step7;
+    return BytesToHex(signature.data(), length);
+}
+
+bool VerifyDigest(std::string_view publicKey, const Digest& digest, std::string_view signature)
+{
+    // "04" followed by the 32 byte x and y coordinates
+    constexpr std::size_t coordinateSize = 64;
+    if (publicKey.size() != 2 + coordinateSize * 2 || publicKey.substr(0, 2) != "04")
+    {
+        return false;
+    }
+
+    const auto x = BytesFromHex(publicKey.substr(2, coordinateSize));
+    const auto y = BytesFromHex(publicKey.substr(2 + coordinateSize));
+    const auto raw = BytesFromHex(signature);
+    if (!x || !y || !raw)
+    {
+        return false;
+    }
+
+    const CryptoPP::ECP::Point q{
+        CryptoPP::Integer{ x->data(), x->size() },
+        CryptoPP::Integer{ y->data(), y->size() } };
+
+    FieldType::PublicKey key;
+    key.Initialize(CryptoPP::ASN1::secp256k1(), q);
+    if (!key.GetGroupParameters().GetCurve().VerifyPoint(q))
+    {
+        return false;
+    }
+
+    FieldType::Verifier verifier{ key };
+    if (raw->size() != verifier.SignatureLength())
+    {
+        return false;
+    }
 
-    // 9 - Base58 encoding of 8
-    const std::string step8h = fmt::format("{}{}h", step4, step7);
-    CryptoPP::Integer step9 { step8h.data() };
-    return "1"s + ash::crypto::Base58Encode(step9);
+    return verifier.VerifyMessage(digest.data(), digest.size(), raw->data(), raw->size());
 }
 
 std::string GeneratePrivateKey()
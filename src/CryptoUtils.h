@@ -1,5 +1,8 @@
 #pragma once
+#include <array>
+#include <optional>
 #include <string_view>
+#include <vector>
 
 #if _WINDOWS
 #pragma warning(push)
@@ -15,22 +18,75 @@
 #pragma warning(pop)
 #endif
 
+#include "Address.h"
+
 namespace ash
 {
 
 namespace crypto
 {
 
+// raw 32 byte SHA256 digest
+using Digest = std::array<std::uint8_t, 32>;
+
 // SHA256 of generic data
 std::string SHA256(std::string_view data);
 
+// raw SHA256 of generic data
+Digest SHA256Digest(std::string_view data);
+
+// lowercase hex string of a raw digest
+std::string DigestToHex(const Digest& digest);
+
+// parses a 64 character lowercase hex string
+std::optional<Digest> DigestFromHex(std::string_view hex);
+
+// lowercase hex string of any raw bytes
+std::string BytesToHex(const std::uint8_t* data, std::size_t size);
+
+// parses a lowercase hex string of any even length
+std::optional<std::vector<std::uint8_t>> BytesFromHex(std::string_view hex);
+
+// true if the hex string of `digest` would start with `count` zeros
+// which lets the miner check a hash without hex encoding it
+constexpr bool HasLeadingZeroNibbles(const Digest& digest, std::uint64_t count) noexcept
+{
+    if (count > digest.size() * 2)
+    {
+        return false;
+    }
+
+    const auto fullBytes = count / 2;
+    for (auto idx = 0u; idx < fullBytes; idx++)
+    {
+        if (digest[idx] != 0)
+        {
+            return false;
+        }
+    }
+
+    return (count % 2) == 0 || (digest[fullBytes] & 0xf0) == 0;
+}
+
 // given a hex string private key this returns the 
 // "04" prepended uncompressed public key
 std::string GetPublicKey(std::string_view privateKeyStr);
 
 // give a hex string private key this returns the 
-// base58 public address
-std::string GetAddressFromPrivateKey(std::string_view privateKeyStr);
+// public address
+Address GetAddressFromPrivateKey(std::string_view privateKeyStr);
+
+// the public address of a "04" prepended uncompressed public key
+// as returned by GetPublicKey(), empty if the key is not hex
+std::optional<Address> GetAddressFromPublicKey(std::string_view publicKey);
+
+// ECDSA (secp256k1, SHA-256) signature of `digest` as the lowercase
+// hex of the 64 byte r and s values
+std::string SignDigest(std::string_view privateKeyStr, const Digest& digest);
+
+// false if the signature is malformed, the public key is not a
+// point on the curve or the signature does not match
+bool VerifyDigest(std::string_view publicKey, const Digest& digest, std::string_view signature);
 
 // generate a new private key
 std::string GeneratePrivateKey();
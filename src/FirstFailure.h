@@ -0,0 +1,87 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace ash
+{
+
+// checks the items [0, count) in batches of `batchSize` on up to
+// `threads` threads and returns the lowest index that failed, or
+// `count` when none did. `check(start, end)` returns the first failing
+// index of its batch. A zero `threads` uses every core
+//
+// Workers claim the next batch until they run out, and batches above
+// a failure that was already found are skipped, so the result is the
+// same as checking every item in order
+template<typename CheckFunc>
+std::size_t FindFirstFailure(std::size_t count, std::size_t batchSize,
+    std::size_t threads, CheckFunc check)
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    const auto batchCount = (count - 1) / batchSize + 1;
+    if (threads == 0)
+    {
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    threads = std::max<std::size_t>(std::min(threads, batchCount), 1);
+
+    std::atomic_size_t nextBatch = 0;
+    std::atomic_size_t firstFailure = count;
+
+    auto worker =
+        [&]()
+        {
+            for (auto batch = nextBatch++; batch < batchCount; batch = nextBatch++)
+            {
+                const auto start = batch * batchSize;
+                if (start >= firstFailure.load(std::memory_order_relaxed))
+                {
+                    return;
+                }
+
+                const std::optional<std::size_t> failed =
+                    check(start, std::min(start + batchSize, count));
+
+                if (failed.has_value())
+                {
+                    auto failure = firstFailure.load(std::memory_order_relaxed);
+                    while (*failed < failure
+                        && !firstFailure.compare_exchange_weak(failure, *failed))
+                    {
+                        // try again
+                    }
+
+                    return;
+                }
+            }
+        };
+
+    // the calling thread acts as the first worker
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (auto idx = 1u; idx < threads; idx++)
+    {
+        pool.emplace_back(worker);
+    }
+
+    worker();
+
+    for (auto& thread : pool)
+    {
+        thread.join();
+    }
+
+    return firstFailure.load();
+}
+
+} // namespace ash
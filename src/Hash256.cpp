@@ -0,0 +1,32 @@
+#include <fmt/core.h>
+
+#include "Hash256.h"
+
+namespace ash
+{
+
+void to_json(nl::json& j, const Hash256& hash)
+{
+    j = hash.hex();
+}
+
+void from_json(const nl::json& j, Hash256& hash)
+{
+    const auto& text = j.get_ref<const std::string&>();
+    const auto parsed = Hash256::FromHex(text);
+    if (!parsed.has_value())
+    {
+        throw std::runtime_error(fmt::format("'{}' is not a hash", text));
+    }
+
+    hash = *parsed;
+}
+
+std::ostream& operator<<(std::ostream& os, const Hash256& hash)
+{
+    std::array<char, Hash256::HEX_SIZE> text;
+    os.write(text.data(), static_cast<std::streamsize>(hash.toChars(text.data())));
+    return os;
+}
+
+} // namespace ash
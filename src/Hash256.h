@@ -0,0 +1,178 @@
+#pragma once
+
+#include <array>
+#include <compare>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include <fmt/format.h>
+
+#include <nlohmann/json.hpp>
+
+namespace nl = nlohmann;
+
+namespace ash
+{
+
+//! The SHA-256 hash of a block or a transaction's id, kept as its raw
+//  bytes. Hashes are only turned into their lowercase hex text at the
+//  JSON, REST and codec boundaries. The all zero hash is the genesis
+//  block's previous hash, which has always been written as an empty
+//  string, so its text is empty
+class Hash256 final
+{
+public:
+    static constexpr std::size_t SIZE = 32;
+    static constexpr std::size_t HEX_SIZE = SIZE * 2;
+
+    using Bytes = std::array<std::uint8_t, SIZE>;
+
+private:
+    Bytes   _bytes{};
+
+    static constexpr int Nibble(char c) noexcept
+    {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        return -1;
+    }
+
+public:
+    constexpr Hash256() = default;
+
+    constexpr explicit Hash256(const Bytes& bytes) noexcept
+        : _bytes{ bytes }
+    {
+        // nothing to do
+    }
+
+    // 64 lowercase hex characters, or an empty string for the null hash
+    static constexpr std::optional<Hash256> FromHex(std::string_view hex) noexcept
+    {
+        Hash256 retval;
+        if (hex.empty())
+        {
+            return retval;
+        }
+        else if (hex.size() != HEX_SIZE)
+        {
+            return {};
+        }
+
+        for (auto idx = 0u; idx < SIZE; idx++)
+        {
+            const auto high = Nibble(hex[idx * 2]);
+            const auto low = Nibble(hex[idx * 2 + 1]);
+            if (high < 0 || low < 0)
+            {
+                return {};
+            }
+
+            retval._bytes[idx] = static_cast<std::uint8_t>((high << 4) | low);
+        }
+
+        return retval;
+    }
+
+    constexpr const Bytes& bytes() const noexcept { return _bytes; }
+    constexpr const std::uint8_t* data() const noexcept { return _bytes.data(); }
+
+    constexpr bool isNull() const noexcept
+    {
+        for (const auto byte : _bytes)
+        {
+            if (byte != 0)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // writes the hex text to `out`, which must have room for HEX_SIZE
+    // characters, and returns how many were written
+    constexpr std::size_t toChars(char* out) const noexcept
+    {
+        if (isNull())
+        {
+            return 0;
+        }
+
+        constexpr std::string_view digits = "0123456789abcdef";
+        for (auto idx = 0u; idx < SIZE; idx++)
+        {
+            out[idx * 2] = digits[_bytes[idx] >> 4];
+            out[idx * 2 + 1] = digits[_bytes[idx] & 0x0f];
+        }
+
+        return HEX_SIZE;
+    }
+
+    std::string hex() const
+    {
+        std::string retval(HEX_SIZE, '\0');
+        retval.resize(toChars(retval.data()));
+        return retval;
+    }
+
+    constexpr bool operator==(const Hash256& other) const noexcept = default;
+
+    // the same order as the hex text
+    constexpr auto operator<=>(const Hash256& other) const noexcept = default;
+};
+
+inline namespace literals
+{
+
+// a hash written in the source, an invalid one does not compile
+consteval Hash256 operator""_hash(const char* text, std::size_t size)
+{
+    const auto retval = Hash256::FromHex({ text, size });
+    if (!retval.has_value())
+    {
+        throw std::invalid_argument("not a hash");
+    }
+
+    return *retval;
+}
+
+} // namespace literals
+
+void to_json(nl::json& j, const Hash256& hash);
+void from_json(const nl::json& j, Hash256& hash);
+
+std::ostream& operator<<(std::ostream& os, const Hash256& hash);
+
+} // namespace ash
+
+namespace std
+{
+    template<> struct hash<ash::Hash256>
+    {
+        // the bytes are already uniformly distributed
+        std::size_t operator()(const ash::Hash256& value) const noexcept
+        {
+            std::size_t retval;
+            std::memcpy(&retval, value.data(), sizeof(retval));
+            return retval;
+        }
+    };
+}
+
+template<>
+struct fmt::formatter<ash::Hash256> : fmt::formatter<std::string_view>
+{
+    template<typename FormatContext>
+    auto format(const ash::Hash256& hash, FormatContext& ctx) const
+    {
+        std::array<char, ash::Hash256::HEX_SIZE> text;
+        const auto size = hash.toChars(text.data());
+        return fmt::formatter<std::string_view>::format(std::string_view{ text.data(), size }, ctx);
+    }
+};
@@ -0,0 +1,113 @@
+#include <cmath>
+
+#include <fmt/format.h>
+
+#include "Blockchain.h"
+#include "HashRate.h"
+
+namespace ash
+{
+
+namespace
+{
+
+constexpr double SecondWindow = 1.0;
+constexpr double MinuteWindow = 60.0;
+constexpr double QuarterWindow = 900.0;
+
+void UpdateAverage(double& average, double rate, double elapsed, double window)
+{
+    const auto alpha = 1.0 - std::exp(-elapsed / window);
+    average += alpha * (rate - average);
+}
+
+} // namespace
+
+void HashRateMeter::sample(const std::vector<std::uint64_t>& counts, Clock::time_point now)
+{
+    std::lock_guard<std::mutex> lock{ _mutex };
+
+    if (!_lastTime.has_value() || counts.size() != _lastCounts.size())
+    {
+        _lastTime = now;
+        _lastCounts = counts;
+        _rates.threads.assign(counts.size(), 0.0);
+        return;
+    }
+
+    const auto elapsed = std::chrono::duration<double>(now - *_lastTime).count();
+    if (elapsed <= 0)
+    {
+        return;
+    }
+
+    std::uint64_t hashes = 0;
+    for (auto idx = 0u; idx < counts.size(); idx++)
+    {
+        const auto delta = counts[idx] - _lastCounts[idx];
+        _rates.threads[idx] = static_cast<double>(delta) / elapsed;
+        hashes += delta;
+    }
+
+    const auto rate = static_cast<double>(hashes) / elapsed;
+    if (!_primed)
+    {
+        // the longer windows would take minutes to climb up from zero
+        _rates.second = _rates.minute = _rates.quarter = rate;
+        _primed = true;
+    }
+    else
+    {
+        UpdateAverage(_rates.second, rate, elapsed, SecondWindow);
+        UpdateAverage(_rates.minute, rate, elapsed, MinuteWindow);
+        UpdateAverage(_rates.quarter, rate, elapsed, QuarterWindow);
+    }
+
+    _lastTime = now;
+    _lastCounts = counts;
+}
+
+HashRateMeter::Rates HashRateMeter::rates() const
+{
+    std::lock_guard<std::mutex> lock{ _mutex };
+    return _rates;
+}
+
+std::string FormatHashRate(double rate)
+{
+    constexpr const char* units[] = { "H/s", "kH/s", "MH/s", "GH/s", "TH/s" };
+
+    auto unit = 0u;
+    while (rate >= 1000.0 && unit + 1 < std::size(units))
+    {
+        rate /= 1000.0;
+        unit++;
+    }
+
+    return fmt::format("{:.2f} {}", rate, units[unit]);
+}
+
+double EstimateNetworkHashRate(const Blockchain& chain, std::size_t window)
+{
+    if (chain.size() < 2 || window == 0)
+    {
+        return 0.0;
+    }
+
+    const auto last = chain.size() - 1;
+    const auto first = last - std::min(window, last);
+
+    // the first block in the window only marks the starting time
+    double hashes = 0;
+    for (auto idx = first + 1; idx <= last; idx++)
+    {
+        hashes += std::pow(16.0, static_cast<double>(chain.at(idx).difficulty()));
+    }
+
+    const auto elapsed = std::chrono::duration<double>(
+        chain.at(last).time() - chain.at(first).time()).count();
+
+    return elapsed > 0 ? hashes / elapsed : 0.0;
+}
+
+} // namespace ash
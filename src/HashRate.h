@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace ash
+{
+
+class Blockchain;
+
+//! One mining thread's running total of hashes. Each counter gets
+//  its own cache line so threads never contend when bumping them
+struct alignas(64) HashCounter
+{
+    std::atomic_uint64_t value = 0;
+};
+
+//! Exponentially weighted hash rates over a second, a minute and
+//  fifteen minutes, fed with the miner's running hash totals about
+//  once a second
+class HashRateMeter final
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Rates
+    {
+        double              second = 0;
+        double              minute = 0;
+        double              quarter = 0;    // fifteen minutes
+        std::vector<double> threads;        // per thread, over the last sample
+    };
+
+    void sample(const std::vector<std::uint64_t>& counts, Clock::time_point now);
+    Rates rates() const;
+
+private:
+    mutable std::mutex                  _mutex;
+    std::optional<Clock::time_point>    _lastTime;
+    std::vector<std::uint64_t>          _lastCounts;
+    bool                                _primed = false;
+    Rates                               _rates;
+};
+
+// e.g. "12.34 MH/s"
+std::string FormatHashRate(double rate);
+
+// hashes per second the network needed to produce the last `window`
+// blocks at their difficulty, a block of difficulty `d` takes 16^d
+// hashes on average
+double EstimateNetworkHashRate(const Blockchain& chain, std::size_t window);
+
+} // namespace ash
@@ -0,0 +1,73 @@
+#include <bit>
+#include <limits>
+#include <stdexcept>
+
+#include "HashWriter.h"
+
+namespace ash
+{
+
+namespace crypto
+{
+
+HashWriter& HashWriter::operator<<(double value)
+{
+    if (_mode == Mode::COMPAT)
+    {
+        // an std::ostream's default is "%g" with a precision of 6
+        std::array<char, 32> text;
+        const auto result = std::to_chars(text.data(), text.data() + text.size(),
+            value, std::chars_format::general, 6);
+
+        update(text.data(), static_cast<std::size_t>(result.ptr - text.data()));
+        return *this;
+    }
+
+    return *this << std::bit_cast<std::uint64_t>(value);
+}
+
+HashWriter& HashWriter::operator<<(std::string_view value)
+{
+    if (_mode == Mode::BINARY)
+    {
+        if (value.size() > std::numeric_limits<std::uint32_t>::max())
+        {
+            throw std::length_error("codec length does not fit in 32 bits");
+        }
+
+        *this << static_cast<std::uint32_t>(value.size());
+    }
+
+    update(value.data(), value.size());
+    return *this;
+}
+
+HashWriter& HashWriter::operator<<(const Hash256& value)
+{
+    if (_mode == Mode::COMPAT)
+    {
+        std::array<char, Hash256::HEX_SIZE> text;
+        update(text.data(), value.toChars(text.data()));
+        return *this;
+    }
+
+    update(value.data(), Hash256::SIZE);
+    return *this;
+}
+
+HashWriter& HashWriter::operator<<(const Address& value)
+{
+    Address::TextBuffer buffer;
+    return *this << value.text(buffer);
+}
+
+Digest HashWriter::digest()
+{
+    Digest retval;
+    _hash.Final(retval.data());
+    return retval;
+}
+
+} // namespace crypto
+
+} // namespace ash
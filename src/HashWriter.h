@@ -0,0 +1,111 @@
+#pragma once
+
+#include <array>
+#include <charconv>
+#include <concepts>
+#include <cstdint>
+#include <string_view>
+
+#include <cryptopp/sha.h>
+
+#include "Address.h"
+#include "CryptoUtils.h"
+#include "Hash256.h"
+
+namespace ash
+{
+
+namespace crypto
+{
+
+// the types a stream writes as characters instead of numbers,
+// std::uint8_t among them
+template<typename T>
+constexpr bool IsCharType = std::same_as<T, char>
+    || std::same_as<T, signed char>
+    || std::same_as<T, unsigned char>
+    || std::same_as<T, wchar_t>
+    || std::same_as<T, char8_t>
+    || std::same_as<T, char16_t>
+    || std::same_as<T, char32_t>;
+
+//! Feeds fields straight into a SHA-256 state, nothing is formatted
+//  into a temporary string first
+class HashWriter final
+{
+public:
+    enum class Mode
+    {
+        // numbers are written as the text an std::ostream would write
+        // with its default flags, which is how block hashes and
+        // transaction ids have always been calculated
+        COMPAT,
+
+        // fields are written in the codec layout, see BinaryCodec.h
+        BINARY
+    };
+
+private:
+    CryptoPP::SHA256    _hash;
+    Mode                _mode;
+
+    void update(const void* data, std::size_t size)
+    {
+        _hash.Update(static_cast<const CryptoPP::byte*>(data), size);
+    }
+
+public:
+    explicit HashWriter(Mode mode)
+        : _mode{ mode }
+    {
+        // nothing to do
+    }
+
+    template<std::integral T>
+    HashWriter& operator<<(T value)
+    {
+        static_assert(!std::same_as<T, bool> && !IsCharType<T>,
+            "streams write bool and character types as text, not numbers");
+
+        if (_mode == Mode::COMPAT)
+        {
+            std::array<char, 24> text;
+            const auto result = std::to_chars(text.data(), text.data() + text.size(), value);
+            update(text.data(), static_cast<std::size_t>(result.ptr - text.data()));
+        }
+        else
+        {
+            std::array<std::uint8_t, sizeof(T)> bytes;
+            for (auto idx = 0u; idx < sizeof(T); idx++)
+            {
+                bytes[idx] = static_cast<std::uint8_t>(value >> (idx * 8));
+            }
+
+            update(bytes.data(), bytes.size());
+        }
+
+        return *this;
+    }
+
+    HashWriter& operator<<(double value);
+    HashWriter& operator<<(std::string_view value);
+
+    // the hex text in COMPAT mode and the raw bytes in BINARY mode
+    HashWriter& operator<<(const Hash256& value);
+
+    // the base58 text in either mode, which is how the codec writes it
+    HashWriter& operator<<(const Address& value);
+
+    // raw bytes in either mode
+    void bytes(const std::uint8_t* data, std::size_t size)
+    {
+        update(data, size);
+    }
+
+    // the writer starts over after this
+    Digest digest();
+};
+
+} // namespace crypto
+
+} // namespace ash
@@ -0,0 +1,121 @@
+#include <cassert>
+
+#include <cryptopp/sha.h>
+
+#include "MerkleTree.h"
+
+namespace ash
+{
+
+namespace
+{
+
+crypto::Digest HashNodes(const crypto::Digest& left, const crypto::Digest& right)
+{
+    CryptoPP::SHA256 hash;
+    hash.Update(left.data(), left.size());
+    hash.Update(right.data(), right.size());
+
+    crypto::Digest retval;
+    hash.Final(retval.data());
+    return retval;
+}
+
+} // namespace
+
+MerkleTree::MerkleTree(const Transactions& txs)
+{
+    if (txs.empty())
+    {
+        return;
+    }
+
+    auto& leaves = _levels.emplace_back();
+    leaves.reserve(txs.size());
+    for (const auto& tx : txs)
+    {
+        leaves.push_back(tx.hash());
+    }
+
+    while (_levels.back().size() > 1)
+    {
+        const auto& level = _levels.back();
+
+        std::vector<crypto::Digest> parents;
+        parents.reserve((level.size() + 1) / 2);
+        for (auto idx = 0u; idx < level.size(); idx += 2)
+        {
+            parents.push_back(idx + 1 < level.size()
+                ? HashNodes(level[idx], level[idx + 1]) : level[idx]);
+        }
+
+        _levels.push_back(std::move(parents));
+    }
+}
+
+void MerkleTree::append(const crypto::Digest& leaf)
+{
+    if (_levels.empty())
+    {
+        _levels.emplace_back();
+    }
+
+    _levels.front().push_back(leaf);
+    rehash(_levels.front().size() - 1);
+}
+
+void MerkleTree::update(std::size_t index, const crypto::Digest& leaf)
+{
+    assert(index < size());
+    _levels.front()[index] = leaf;
+    rehash(index);
+}
+
+void MerkleTree::rehash(std::size_t index)
+{
+    for (auto level = 0u; _levels[level].size() > 1; level++)
+    {
+        const auto& nodes = _levels[level];
+        const auto parent = index / 2;
+        const auto left = parent * 2;
+
+        const auto node = left + 1 < nodes.size()
+            ? HashNodes(nodes[left], nodes[left + 1]) : nodes[left];
+
+        if (level + 1 == _levels.size())
+        {
+            _levels.emplace_back();
+        }
+
+        // `nodes` may have moved with the new level
+        auto& parents = _levels[level + 1];
+        if (parent < parents.size())
+        {
+            parents[parent] = node;
+        }
+        else
+        {
+            assert(parent == parents.size());
+            parents.push_back(node);
+        }
+
+        index = parent;
+    }
+}
+
+std::size_t MerkleTree::size() const noexcept
+{
+    return _levels.empty() ? 0 : _levels.front().size();
+}
+
+crypto::Digest MerkleTree::root() const
+{
+    return _levels.empty() ? crypto::Digest{} : _levels.back().front();
+}
+
+crypto::Digest CalculateMerkleRoot(const Transactions& txs)
+{
+    return MerkleTree{ txs }.root();
+}
+
+} // namespace ash
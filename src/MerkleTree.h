@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "CryptoUtils.h"
+#include "Transactions.h"
+
+namespace ash
+{
+
+//! Binary hash tree over the transaction hashes of a block. A node is
+//  the SHA-256 of its two children and a node without a sibling moves
+//  up a level unchanged. Appending or replacing a leaf only rehashes
+//  the path from that leaf to the root
+class MerkleTree final
+{
+    // the leaves first and the root last
+    std::vector<std::vector<crypto::Digest>>    _levels;
+
+    void rehash(std::size_t index);
+
+public:
+    MerkleTree() = default;
+    explicit MerkleTree(const Transactions& txs);
+
+    void append(const crypto::Digest& leaf);
+    void update(std::size_t index, const crypto::Digest& leaf);
+
+    std::size_t size() const noexcept;
+
+    // all zeros for an empty tree
+    crypto::Digest root() const;
+};
+
+crypto::Digest CalculateMerkleRoot(const Transactions& txs);
+
+} // namespace ash
@@ -0,0 +1,282 @@
+#include <array>
+#include <limits>
+#include <thread>
+#include <mutex>
+#include <optional>
+
+#include "BlockHeader.h"
+#include "Miner.h"
+
+namespace ash
+{
+
+namespace
+{
+
+// a multiple of the widest kernel's lane count and a divisor
+// of the callback interval below
+constexpr std::size_t NONCE_BATCH_SIZE = 64u;
+
+} // namespace
+
+BlockTime Miner::now() const
+{
+    if (_clock)
+    {
+        return _clock();
+    }
+
+    return std::chrono::time_point_cast<std::chrono::milliseconds>
+        (std::chrono::system_clock::now());
+}
+
+void Miner::recordStale(std::chrono::nanoseconds latency)
+{
+    std::lock_guard<std::mutex> lock{ _statsMutex };
+    _staleStats.count++;
+    _staleStats.last = latency;
+    _staleStats.total += latency;
+    _staleStats.max = std::max(_staleStats.max, latency);
+}
+
+void Miner::setThreadCount(std::uint32_t val)
+{
+    if (val == 0)
+    {
+        val = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    _threadCount = val;
+    _counters = std::make_unique<HashCounter[]>(_threadCount);
+}
+
+std::vector<std::uint64_t> Miner::threadHashCounts() const
+{
+    std::vector<std::uint64_t> retval;
+    retval.reserve(_threadCount);
+
+    for (auto idx = 0u; idx < _threadCount; idx++)
+    {
+        retval.push_back(_counters[idx].value.load(std::memory_order_relaxed));
+    }
+
+    return retval;
+}
+
+Miner::ResultType Miner::mineBlock(Block& block, KeepGoingFunc keepGoingFunc)
+{
+    return mineBlock(block, CalculateBlockCommitment(block), std::move(keepGoingFunc));
+}
+
+Miner::ResultType Miner::mineBlock(Block& block, const BlockCommitment& commitment,
+    KeepGoingFunc keepGoingFunc)
+{
+    assert(block.index() > 0);
+    assert(!block.previousHash().isNull() || (block.index() - 1 == 0));
+
+    struct Solution
+    {
+        std::uint64_t   nonce;
+        BlockTime       time;
+        crypto::Digest  digest;
+    };
+
+    const auto workerCount = std::max(_threadCount, 1u);
+
+    std::mutex solutionMutex;
+    std::optional<Solution> solution;
+    std::atomic_bool stale = false;
+
+    // every refresh of the block's transactions starts a new generation
+    // of its commitment, a solution only counts if it was found with
+    // the latest one. Both are guarded by `solutionMutex`. Only a v2
+    // header can swap in a new commitment, so nothing is refreshed
+    // below `chain.headerv2.height`, which is never by default
+    const bool refreshable = _refresh && BlockHeaderVersion(block.index()) == BLOCK_HEADER_V2;
+    BlockCommitment latest = commitment;
+    std::atomic_uint64_t generation = 0;
+
+    // pick up what arrived since the template was built before any
+    // worker can find a solution with the old commitment
+    if (refreshable)
+    {
+        if (auto updated = _refresh(block); updated.has_value())
+        {
+            latest = *updated;
+            generation = 1;
+        }
+    }
+
+    _keepTrying = true;
+    _hashCount = 0;
+
+    auto worker =
+        [&, this](std::uint32_t workerIdx)
+        {
+            // workers take turns on batches of consecutive nonces so
+            // the SHA-256 kernel can hash a whole batch side by side
+            std::uint64_t batch = workerIdx;
+            std::uint64_t tries = 0;
+            auto time = now();
+
+            // each nonce is hashed into a raw digest which is checked
+            // in place, nothing is allocated or hex encoded per attempt
+            BlockHeaderHasher hasher{ block, _difficulty, time, commitment };
+            std::array<crypto::Digest, NONCE_BATCH_SIZE> digests;
+
+            // the tip's height is only read when its epoch changes, the
+            // first pass always reads it in case the block is already stale
+            auto seenEpoch = std::numeric_limits<std::uint64_t>::max();
+            std::uint64_t seenGeneration = 0;
+
+            // only this thread writes to its counter
+            auto& counter = _counters[workerIdx].value;
+
+            std::optional<MiningScheduler::WorkerScope> scope;
+            if (_scheduler != nullptr)
+            {
+                scope.emplace(*_scheduler, workerIdx);
+            }
+
+            while (_keepTrying.load(std::memory_order_acquire))
+            {
+                if (_tip != nullptr)
+                {
+                    if (const auto epoch = _tip->epoch(); epoch != seenEpoch)
+                    {
+                        seenEpoch = epoch;
+                        // a queued chain from a peer makes the block just as
+                        // stale, and so does a new chain under the block
+                        if (std::max(_tip->height(), _tip->queued()) >= block.index()
+                            || !_tip->extends(block.index(), block.previousHash()))
+                        {
+                            // only the worker that stops the others records the latency
+                            bool expected = true;
+                            if (_keepTrying.compare_exchange_strong(expected, false))
+                            {
+                                stale = true;
+                                recordStale(ChainTip::Clock::now() - _tip->changed());
+                            }
+
+                            _hashCount += tries;
+                            return;
+                        }
+                    }
+                }
+
+                if (_scheduler != nullptr && _scheduler->throttled())
+                {
+                    // the node needs the cpu more than we do
+                    std::this_thread::sleep_for(MiningScheduler::THROTTLE_PAUSE);
+                    continue;
+                }
+
+                // do some extra stuff every few seconds
+                if ((tries & 0x3ffff) == 0)
+                {
+                    // only the first worker talks to the callback so
+                    // it gets called as often as it did with one thread
+                    if (workerIdx == 0
+                        && keepGoingFunc && !keepGoingFunc(block.index()))
+                    {
+                        // our callback has told us to bail
+                        _hashCount += tries;
+                        abort();
+                        return;
+                    }
+
+                    if (workerIdx == 0 && refreshable)
+                    {
+                        std::lock_guard<std::mutex> lock{ solutionMutex };
+                        if (auto updated = solution.has_value() ? std::nullopt : _refresh(block);
+                                updated.has_value())
+                        {
+                            latest = *updated;
+                            generation.fetch_add(1, std::memory_order_release);
+                        }
+                    }
+
+                    // update the block time
+                    time = now();
+
+                    hasher.setTime(time);
+                }
+
+                if (refreshable
+                    && generation.load(std::memory_order_acquire) != seenGeneration)
+                {
+                    // the nonces carry on where they were, the header is new
+                    std::lock_guard<std::mutex> lock{ solutionMutex };
+                    seenGeneration = generation.load(std::memory_order_relaxed);
+                    hasher.setCommitment(latest);
+                }
+
+                const auto first = batch * NONCE_BATCH_SIZE;
+                hasher.digests(first, digests.size(), digests.data());
+                counter.store(counter.load(std::memory_order_relaxed) + digests.size(),
+                    std::memory_order_relaxed);
+
+                for (auto idx = 0u; idx < digests.size(); idx++)
+                {
+                    if (crypto::HasLeadingZeroNibbles(digests[idx], _difficulty))
+                    {
+                        std::lock_guard<std::mutex> lock{ solutionMutex };
+                        if (seenGeneration != generation.load(std::memory_order_relaxed))
+                        {
+                            // the block's transactions changed under this batch
+                            break;
+                        }
+
+                        if (!solution.has_value())
+                        {
+                            solution = Solution{ first + idx, time, digests[idx] };
+                        }
+
+                        // stop the other workers
+                        _hashCount += tries + digests.size();
+                        abort();
+                        return;
+                    }
+                }
+
+                tries += digests.size();
+                batch += workerCount;
+            }
+
+            _hashCount += tries;
+        };
+
+    // every worker gets a thread of its own. The calling thread goes
+    // on to add the block to the chain under the chain lock so its
+    // priority is never lowered, which an unprivileged process might
+    // not be allowed to undo
+    std::vector<std::thread> threads;
+    threads.reserve(workerCount);
+    for (auto idx = 0u; idx < workerCount; idx++)
+    {
+        threads.emplace_back(worker, idx);
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    if (stale)
+    {
+        return ResultType::STALE;
+    }
+
+    if (!solution.has_value())
+    {
+        return ResultType::ABORT;
+    }
+
+    block.setMinedData(solution->nonce, _difficulty, solution->time,
+        Hash256{ solution->digest });
+
+    _logger->info("successfully mined bock {}", block.index());
+    return ResultType::SUCCESS;
+}
+
+} // namespace ash
@@ -1,7 +1,14 @@
 #pragma once
+#include <mutex>
+#include <optional>
+
 #include "Block.h"
+#include "BlockHeader.h"
 #include "AshLogger.h"
+#include "ChainTip.h"
 #include "CryptoUtils.h"
+#include "HashRate.h"
+#include "MiningScheduler.h"
 
 using namespace std::chrono_literals;
 
@@ -14,11 +21,41 @@ class Miner
     std::uint64_t       _maxTries = 0;
     std::atomic_bool    _keepTrying = true;
     std::uint32_t       _timeout; // seconds
+    std::uint32_t       _threadCount = 1;
     SpdLogPtr           _logger;
 
+    // running totals that are never reset, one per thread
+    std::unique_ptr<HashCounter[]>  _counters;
+
+    std::function<BlockTime()>  _clock;
+    std::function<std::optional<BlockCommitment>(Block&)>  _refresh;
+    std::atomic_uint64_t        _hashCount = 0;
+
+    const ChainTip*             _tip = nullptr;
+    MiningScheduler*            _scheduler = nullptr;
+
+public:
+    struct StaleStats
+    {
+        std::uint64_t               count = 0;
+        std::chrono::nanoseconds    last{ 0 };
+        std::chrono::nanoseconds    total{ 0 };
+        std::chrono::nanoseconds    max{ 0 };
+    };
+
+private:
+    mutable std::mutex          _statsMutex;
+    StaleStats                  _staleStats;
+
+    BlockTime now() const;
+    void recordStale(std::chrono::nanoseconds latency);
+
 public:
-    enum ResultType { SUCCESS, TIMEOUT, ABORT };
+    enum ResultType { SUCCESS, TIMEOUT, ABORT, STALE };
     using Result = std::tuple<ResultType, Block>;
+    using KeepGoingFunc = std::function<bool(std::uint64_t)>;
+    using ClockFunc = std::function<BlockTime()>;
+    using RefreshFunc = std::function<std::optional<BlockCommitment>(Block&)>;
 
     Miner()
         : Miner(0)
@@ -28,7 +65,8 @@ public:
 
     Miner(std::uint32_t difficulty)
         : _difficulty{difficulty},
-          _logger(ash::initializeLogger("Miner"))
+          _logger(ash::initializeLogger("Miner")),
+          _counters{ std::make_unique<HashCounter[]>(_threadCount) }
     {
         // nothing to do
     }
@@ -36,68 +74,63 @@ public:
     std::uint64_t difficulty() const noexcept { return _difficulty; }
     void setDifficulty(std::uint64_t val) { _difficulty = val; }
 
-    void abort() 
-    { 
-        _keepTrying.store(false, std::memory_order_release);
+    std::uint32_t threadCount() const noexcept { return _threadCount; }
+
+    // a value of 0 will use all available cores, this
+    // must not be called while a block is being mined
+    void setThreadCount(std::uint32_t val);
+
+    // hashes computed by each thread since the thread count was set
+    std::vector<std::uint64_t> threadHashCounts() const;
+
+    // replaces the system clock used to stamp blocks, it is called
+    // from every worker thread. Benchmarks use a frozen clock so every
+    // run hashes the same headers
+    void setClock(ClockFunc clock) { _clock = std::move(clock); }
+
+    // the miner gives up on a block with a STALE result as soon as
+    // the tip or a queued chain reaches the block's height, or the
+    // tip is no longer the block's parent. The tip must outlive the miner
+    void setChainTip(const ChainTip* tip) { _tip = tip; }
+
+    // pins the workers, lowers their priority and pauses them while
+    // the node is busy, the scheduler must outlive the miner
+    void setScheduler(MiningScheduler* scheduler) { _scheduler = scheduler; }
+
+    // called by the first worker every few hundred thousand nonces
+    // while a v2 header is mined. It may add transactions to the block
+    // and returns the block's new commitment if it did, the workers
+    // switch to it without starting their nonces over
+    void setRefreshFunc(RefreshFunc refresh) { _refresh = std::move(refresh); }
+
+    // how long it took to notice that the tip had moved past
+    // the block being mined
+    StaleStats staleStats() const
+    {
+        std::lock_guard<std::mutex> lock{ _statsMutex };
+        return _staleStats;
     }
 
-    // TODO: move this to a CPP file
-    ResultType mineBlock(Block& block,
-        std::function<bool(std::uint64_t)> keepGoingFunc = nullptr)
+    // hashes computed by the last call to mineBlock(), including
+    // the rest of the batch in which the solution was found
+    std::uint64_t hashCount() const noexcept { return _hashCount.load(); }
+
+    void abort()
     {
-        assert(block.index() > 0);
-        assert(block.previousHash().size() > 0 || (block.index() - 1 == 0));
-
-        std::string zeros;
-        zeros.assign(_difficulty, '0');
-
-        std::uint64_t nonce = 0;
-        auto time = 
-            std::chrono::time_point_cast<std::chrono::milliseconds>
-                (std::chrono::system_clock::now());
-
-        const auto extra = 
-            ash::crypto::SHA256(nl::json(block.transactions()).dump());
-
-        std::string hash = 
-            CalculateBlockHash(
-                block.index(), nonce, _difficulty, time, block.data(), block.previousHash(), extra);
-
-        _keepTrying = true;
-
-        while (_keepTrying.load(std::memory_order_acquire) 
-            && hash.compare(0, _difficulty, zeros) != 0)
-        {
-            // do some extra stuff every few seconds
-            if ((nonce & 0x3ffff) == 0)
-            {
-                if (keepGoingFunc && !keepGoingFunc(block.index()))
-                {
-                    // our callback has told us to bail
-                    return ResultType::ABORT;
-                }
-
-                // update the block time
-                time = std::chrono::time_point_cast<std::chrono::milliseconds>
-                        (std::chrono::system_clock::now());
-            }
-
-            nonce++;
-            hash = CalculateBlockHash(
-                block.index(), nonce, _difficulty, time, block.data(), block.previousHash(), extra);
-        }
-
-        if (!_keepTrying)
-        {
-            return ResultType::ABORT;
-        }
-
-        block.setMinedData(nonce, _difficulty, time, hash);
-
-        _logger->info("successfully mined bock {}", block.index());
-        return ResultType::SUCCESS;
+        _keepTrying.store(false, std::memory_order_release);
     }
 
+    // the nonce space is split across `threadCount()` workers where
+    // each worker steps through the nonces by the number of workers,
+    // the first worker to find a valid hash stops all the others.
+    // `keepGoingFunc` is only called every few hundred thousand nonces
+    // so anything latency sensitive should go through the chain tip
+    ResultType mineBlock(Block& block, KeepGoingFunc keepGoingFunc = nullptr);
+
+    // the same with the block's commitment calculated up front, so
+    // a block template built ahead of time starts hashing right away
+    ResultType mineBlock(Block& block, const BlockCommitment& commitment,
+        KeepGoingFunc keepGoingFunc = nullptr);
 };
 
 } // namespace ash
@@ -1,10 +1,13 @@
 #include <charconv>
+#include <future>
+#include <optional>
 #include <cassert>
 
 #include <boost/filesystem.hpp>
 
 #include <nlohmann/json.hpp>
 #include <fmt/chrono.h>
+#include <fmt/ranges.h>
 #include <range/v3/all.hpp>
 
 #include "index_html.h"
@@ -23,6 +26,10 @@
 #include "ComputerID.h"
 #include "Transactions.h"
 #include "ProblemDetails.h"
+#include "BlockHeader.h"
+#include "MerkleTree.h"
+#include "SignatureCache.h"
+#include "TemplateBuilder.h"
 
 #include "MinerApp.h"
 
@@ -49,8 +56,67 @@ MinerApp::MinerApp(SettingsPtr settings)
     _logger->debug("target block generation interval is {} seconds", TARGET_TIMESPAN);
     _logger->debug("difficulty adjustment interval is every {} blocks", BLOCK_INTERVAL);
 
+    if (const auto v2height = _settings->value("chain.headerv2.height", -1);
+            v2height >= 0)
+    {
+        ash::SetHeaderV2Height(static_cast<std::uint64_t>(v2height));
+        _logger->debug("v2 block headers activate at block #{}", v2height);
+    }
+
+    if (const auto sigheight = _settings->value("chain.signatures.height", -1);
+            sigheight >= 0)
+    {
+        ash::SetSignatureHeight(static_cast<std::uint64_t>(sigheight));
+        _logger->debug("transaction signatures are required from block #{}", sigheight);
+    }
+
+    if (const auto spendheight = _settings->value("chain.spending.height", -1);
+            spendheight >= 0)
+    {
+        ash::SetSpendingHeight(static_cast<std::uint64_t>(spendheight));
+        _logger->debug("transaction inputs must spend unspent outputs from block #{}", spendheight);
+    }
+
+    ash::GetSignatureCache().setCapacity(
+        _settings->value("chain.sigcache.size", static_cast<std::uint32_t>(ash::DefaultSignatureCacheSize)));
+
+    _miner.setThreadCount(_settings->value("mining.threads", 1u));
+    _logger->debug("mining with {} thread(s)", _miner.threadCount());
+    _miner.setChainTip(&_chainTip);
+
+    try
+    {
+        _scheduler.setCpus(ash::ParseCpuSet(_settings->value("mining.cpus", "")));
+    }
+    catch (const std::invalid_argument& ex)
+    {
+        _logger->error("ignoring 'mining.cpus': {}", ex.what());
+    }
+
+    _scheduler.setLatencyBudget(
+        std::chrono::milliseconds{ _settings->value("mining.latency_budget_ms", 0u) });
+    _miner.setScheduler(&_scheduler);
+    _logger->debug("mining on cpus '{}' with a latency budget of {}ms",
+        fmt::join(_scheduler.cpus(), ","), _scheduler.latencyBudget().count());
+
     _blockchain = std::make_unique<Blockchain>();
     _database = std::make_unique<ChainDatabase>(dbfolder);
+    _database->setVerifyAll(!_settings->value("chain.assumevalid.enable", true));
+
+    if (const auto height = _settings->value("chain.assumevalid.height", -1);
+            height >= 0)
+    {
+        const auto hashText = _settings->value("chain.assumevalid.hash", "");
+        if (const auto hash = Hash256::FromHex(hashText); hash.has_value())
+        {
+            _database->setAssumeValid(Checkpoint{ static_cast<std::uint64_t>(height), *hash });
+            _logger->debug("assuming blocks up to #{} {} are valid", height, *hash);
+        }
+        else
+        {
+            _logger->error("ignoring 'chain.assumevalid.hash', '{}' is not a block hash", hashText);
+        }
+    }
 }
 
 MinerApp::~MinerApp()
@@ -61,6 +127,12 @@ MinerApp::~MinerApp()
         _mineThread.join();
     }
 
+    if (_statsThread.joinable())
+    {
+        _logger->trace("shutting down stats thread");
+        _statsThread.join();
+    }
+
     if (_httpThread.joinable())
     {
         _logger->trace("shutting down http server thread");
@@ -166,9 +238,13 @@ void MinerApp::initWebService()
             utils::Dictionary dict;
             getStandardDictionary(dict);
 
-            dict["%chain-size%"] = std::to_string(_blockchain->size() - 1);
+            {
+                std::lock_guard<std::mutex> lock{_chainMutex};
+                dict["%chain-size%"] = std::to_string(_blockchain->size() - 1);
+                dict["%chain-cumdiff%"] = _blockchain->cumDifficulty().str();
+            }
+
             dict["%chain-diff%"] = std::to_string(_miner.difficulty());
-            dict["%chain-cumdiff%"] = std::to_string(_blockchain->cumDifficulty());
             dict["%mining-status%"] = (_miningDone ? "stopped" : "started");
             dict["%mining-uuid%"] = _uuid;
 
@@ -196,6 +272,62 @@ int GetIndent(const T& map)
     return -1;
 }
 
+template<typename T>
+std::size_t GetQueryNumber(const T& map, std::string_view name, std::size_t defaultValue)
+{
+    if (auto it = map.find(std::string{ name }); it != map.end())
+    {
+        std::size_t value = 0;
+        const auto& valuestr = it->second;
+
+        auto result =
+                std::from_chars(valuestr.data(), valuestr.data() + valuestr.size(), value);
+
+        if (result.ec == std::errc{})
+        {
+            return value;
+        }
+    }
+
+    return defaultValue;
+}
+
+// chain work is the u64 JSON number every node reads, a chain would
+// need 2^64 hashes of work before it saturates
+nl::json ChainWorkToJson(const ChainWork& work)
+{
+    constexpr auto max = std::numeric_limits<std::uint64_t>::max();
+    return work < max ? work.convert_to<std::uint64_t>() : max;
+}
+
+ChainWork ChainWorkFromJson(const nl::json& json)
+{
+    return json.get<std::uint64_t>();
+}
+
+// binary frames carry chain work as three little endian u64 words
+constexpr auto ChainWorkWords = 3u;
+
+void WriteChainWork(codec::Writer& writer, ChainWork work)
+{
+    for (auto idx = 0u; idx < ChainWorkWords; idx++)
+    {
+        writer.u64((work & std::numeric_limits<std::uint64_t>::max()).convert_to<std::uint64_t>());
+        work >>= 64;
+    }
+}
+
+ChainWork ReadChainWork(codec::Reader& reader)
+{
+    ChainWork retval;
+    for (auto idx = 0u; idx < ChainWorkWords; idx++)
+    {
+        retval |= ChainWork{ reader.u64() } << (64 * idx);
+    }
+
+    return retval;
+}
+
 void MinerApp::initRestService()
 {
     // TODO: needs to be moved to /rest/block-idx
@@ -341,14 +473,37 @@ void MinerApp::initRestService()
                 return;
             }
             
-            const auto toaddress = json["toaddress"].get<std::string>();
+            const auto toaddress = ash::Address::FromBase58(json["toaddress"].get<std::string>());
+            if (!toaddress.has_value() || toaddress->isNull())
+            {
+                response->write(SimpleWeb::StatusCode::client_error_bad_request);
+                return;
+            }
+
             const auto privateKey = json["privatekey"].get<std::string>();
             const auto amount = json["amount"].get<double>();
 
             std::lock_guard<std::mutex> lock{_chainMutex};
-            if (auto [result, newtx] = ash::CreateTransaction(*_blockchain, privateKey, toaddress, amount);
+            if (auto [result, newtx] = ash::CreateTransaction(*_blockchain, privateKey, *toaddress, amount);
                     result == ash::TxResult::SUCCESS)
             {
+                // this also caches the signatures for when the block
+                // with the transaction is validated
+                if (const auto check = ash::ValidateTransaction(*_blockchain, newtx); !check.valid())
+                {
+                    ProblemDetail details;
+                    details.type = fmt::format("/createtx/{}", ash::ToString(check.reason));
+                    details.title = std::string{ ash::ToString(check.reason) };
+                    details.detail = check.detail;
+                    details.status = static_cast<std::uint32_t>(SimpleWeb::StatusCode::client_error_bad_request);
+                    details.instance = request->path;
+
+                    nl::json error = details;
+                    _logger->error("rejected new transaction: {}", check.detail);
+                    response->write(SimpleWeb::StatusCode::client_error_bad_request, error.dump());
+                    return;
+                }
+
                 _blockchain->queueTransaction(std::move(newtx));
                 response->write(SimpleWeb::StatusCode::success_created);
                 return;
@@ -372,13 +527,93 @@ void MinerApp::initRestService()
         [this](std::shared_ptr<HttpResponse> response, std::shared_ptr<HttpRequest> request)
         {
             nl::json jresponse;
-            jresponse["blocks"].push_back(_blockchain->back());
-            jresponse["cumdiff"] = _blockchain->cumDifficulty();
+
+            {
+                std::lock_guard<std::mutex> lock{_chainMutex};
+                jresponse["blocks"].push_back(_blockchain->back());
+                jresponse["cumdiff"] = ChainWorkToJson(_blockchain->cumDifficulty());
+            }
+
             jresponse["difficulty"] = _miner.difficulty();
             jresponse["mining"] = !this->_miningDone;
+            const auto rates = _hashRate.rates();
+            jresponse["hashrate"]["1s"] = rates.second;
+            jresponse["hashrate"]["1m"] = rates.minute;
+            jresponse["hashrate"]["15m"] = rates.quarter;
+            jresponse["hashrate"]["threads"] = rates.threads;
+            jresponse["hashrate"]["hashes"] = _miner.threadHashCounts();
+
+            {
+                std::lock_guard<std::mutex> lock{_chainMutex};
+                jresponse["networkhashrate"] =
+                    EstimateNetworkHashRate(*_blockchain, NetworkHashRateWindow);
+            }
+
+            jresponse["overbudget"] = _scheduler.overBudgetCount();
+            jresponse["tip"]["epoch"] = _chainTip.epoch();
+            jresponse["tip"]["height"] = _chainTip.height();
+            jresponse["tip"]["queued"] = _chainTip.queued();
+
+            // time from a tip change to the miner dropping its stale block
+            const auto stale = _miner.staleStats();
+            auto micros =
+                [](std::chrono::nanoseconds ns) { return std::chrono::duration<double, std::micro>(ns).count(); };
+
+            jresponse["staleabort"]["count"] = stale.count;
+            jresponse["staleabort"]["last_us"] = micros(stale.last);
+            jresponse["staleabort"]["max_us"] = micros(stale.max);
+            jresponse["staleabort"]["mean_us"] =
+                stale.count > 0 ? micros(stale.total) / static_cast<double>(stale.count) : 0.0;
+
             response->write(jresponse.dump());
         };
 
+    // a POST because a new template takes the queued transactions
+    _httpServer.resource["^/rest/getwork$"]["POST"] =
+        [this](std::shared_ptr<HttpResponse> response, std::shared_ptr<HttpRequest> request)
+        {
+            response->write(getWork().dump());
+        };
+
+    _httpServer.resource["^/rest/submitwork$"]["POST"] =
+        [this](std::shared_ptr<HttpResponse> response, std::shared_ptr<HttpRequest> request)
+        {
+            const nl::json json =
+                nl::json::parse(request->content.string(), nullptr, false);
+
+            if (json.is_discarded()
+                || !json.contains("jobid")
+                || !json["jobid"].is_number_unsigned()
+                || !json.contains("nonce")
+                || !json["nonce"].is_number_unsigned())
+            {
+                response->write(SimpleWeb::StatusCode::client_error_bad_request);
+                return;
+            }
+
+            auto [result, jresult] = submitWork(
+                json["jobid"].get<std::uint64_t>(), json["nonce"].get<std::uint64_t>());
+
+            if (result == WorkResult::ACCEPTED)
+            {
+                response->write(jresult.dump());
+                return;
+            }
+
+            const auto status = result == WorkResult::STALE_JOB
+                ? SimpleWeb::StatusCode::client_error_conflict
+                : SimpleWeb::StatusCode::client_error_bad_request;
+
+            ProblemDetail details;
+            details.type = fmt::format("/submitwork/{}", WorkResultValue::ToString(result));
+            details.title = WorkResultValue::ToString(result);
+            details.status = static_cast<std::uint32_t>(status);
+            details.instance = request->path;
+
+            nl::json error = details;
+            response->write(status, error.dump());
+        };
+
     _httpServer.resource[R"x(^/rest/block/([0-9,]+))x"]["GET"] =
         [this](std::shared_ptr<HttpResponse> response, std::shared_ptr<HttpRequest> request) 
         {
@@ -417,20 +652,21 @@ void MinerApp::initRestService()
     _httpServer.resource[R"x(^/rest/unspent(?:/+|(?:/([0-9a-zA-Z]+)))?$)x"]["GET"] = 
         [this](std::shared_ptr<HttpResponse> response, std::shared_ptr<HttpRequest> request) 
         {
-            std::lock_guard<std::mutex> lock{ _chainMutex };
-            nl::json json;
-
+            std::optional<ash::Address> address;
             if (request->path_match.size() > 1
                 && request->path_match[1].str().size() > 0)
             {
-                
-                json = ash::GetUnspentTxOuts(*_blockchain, request->path_match[1].str());
-            }
-            else
-            {
-                json = ash::GetUnspentTxOuts(*_blockchain);
+                address = ash::Address::FromBase58(request->path_match[1].str());
+                if (!address.has_value() || address->isNull())
+                {
+                    response->write(SimpleWeb::StatusCode::client_error_not_found);
+                    return;
+                }
             }
 
+            std::lock_guard<std::mutex> lock{ _chainMutex };
+            nl::json json = ash::GetUnspentTxOuts(*_blockchain, address);
+
             auto ident = ash::GetIndent(request->parse_query_string());
             response->write(json.dump(ident));
         };
@@ -439,10 +675,69 @@ void MinerApp::initRestService()
     _httpServer.resource[R"x(^/rest/address/([0-9a-zA-Z]+))x"]["GET"] =
         [this](std::shared_ptr<HttpResponse> response, std::shared_ptr<HttpRequest> request)
         {
-            const auto address = request->path_match[1].str();
+            const auto address = ash::Address::FromBase58(request->path_match[1].str());
+            if (!address.has_value() || address->isNull())
+            {
+                response->write(SimpleWeb::StatusCode::client_error_not_found);
+                return;
+            }
 
             std::lock_guard<std::mutex> lock{ _chainMutex };
-            nl::json json = ash::GetAddressLedger(*_blockchain, address);
+            nl::json json = ash::GetAddressLedger(*_blockchain, *address);
+
+            auto indent = ash::GetIndent(request->parse_query_string());
+            response->write(json.dump(indent));
+        };
+
+    // returns a page of an address's ledger newest first, `start` is
+    // how many of the newest entries to skip
+    _httpServer.resource[R"x(^/rest/history/([0-9a-zA-Z]+))x"]["GET"] =
+        [this](std::shared_ptr<HttpResponse> response, std::shared_ptr<HttpRequest> request)
+        {
+            const auto address = ash::Address::FromBase58(request->path_match[1].str());
+            if (!address.has_value() || address->isNull())
+            {
+                response->write(SimpleWeb::StatusCode::client_error_not_found);
+                return;
+            }
+
+            const auto query = request->parse_query_string();
+            const auto start = GetQueryNumber(query, "start", 0);
+            const auto count = std::min(GetQueryNumber(query, "count", HistoryPageDefault), HistoryPageMax);
+
+            std::lock_guard<std::mutex> lock{ _chainMutex };
+            const auto& history = _blockchain->addressHistory();
+            const auto ledger = history.find(*address);
+
+            nl::json json;
+            json["address"] = *address;
+            json["total"] = ledger != nullptr ? ledger->size() : 0u;
+            json["start"] = start;
+            json["ledger"] = history.page(*address, start, count);
+
+            auto indent = ash::GetIndent(query);
+            response->write(json.dump(indent));
+        };
+
+    // returns the balance of an address and how many unspent outputs
+    // it has from the indexes, without walking the chain
+    _httpServer.resource[R"x(^/rest/balance/([0-9a-zA-Z]+))x"]["GET"] =
+        [this](std::shared_ptr<HttpResponse> response, std::shared_ptr<HttpRequest> request)
+        {
+            const auto address = ash::Address::FromBase58(request->path_match[1].str());
+            if (!address.has_value() || address->isNull())
+            {
+                response->write(SimpleWeb::StatusCode::client_error_not_found);
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock{ _chainMutex };
+            const auto entry = _blockchain->unspentOutputs().findAddress(*address);
+
+            nl::json json;
+            json["address"] = *address;
+            json["balance"] = ash::GetAddressBalance(*_blockchain, *address);
+            json["unspent"] = entry != nullptr ? entry->outputs.size() : 0u;
 
             auto indent = ash::GetIndent(request->parse_query_string());
             response->write(json.dump(indent));
@@ -452,10 +747,15 @@ void MinerApp::initRestService()
     _httpServer.resource[R"x(^/rest/tx/([0-9a-zA-Z]+))x"]["GET"] =
         [this](std::shared_ptr<HttpResponse> response, std::shared_ptr<HttpRequest> request)
         {
-            const auto transaction = request->path_match[1].str();
+            const auto transaction = ash::Hash256::FromHex(request->path_match[1].str());
+            if (!transaction.has_value() || transaction->isNull())
+            {
+                response->write(SimpleWeb::StatusCode::client_error_not_found);
+                return;
+            }
 
             std::lock_guard<std::mutex> lock{ _chainMutex };
-            auto txpt = ash::FindTransaction(*_blockchain, transaction);
+            auto txpt = ash::FindTransaction(*_blockchain, *transaction);
             if (txpt.has_value())
             {
                 auto [blockindex, txindex] = *txpt;
@@ -484,9 +784,21 @@ void MinerApp::initHttp()
     _httpServer.resource[R"x(^/address/([0-9a-zA-Z]+)$)x"]["GET"] =
             [this](std::shared_ptr<HttpResponse> response, std::shared_ptr<HttpRequest> request)
         {
-            const auto address = request->path_match[1].str();
+            const auto address = ash::Address::FromBase58(request->path_match[1].str());
+            if (!address.has_value() || address->isNull())
+            {
+                response->write(SimpleWeb::StatusCode::client_error_not_found);
+                return;
+            }
+
             utils::Dictionary dict;
-            dict["%address%"] = address;
+            dict["%address%"] = address->base58();
+
+            {
+                std::lock_guard<std::mutex> lock{ _chainMutex };
+                dict["%balance%"] = fmt::format("{:.4f}", ash::GetAddressBalance(*_blockchain, *address));
+            }
+
             this->servePage(response, "address.html", address_html, dict);
         };
 
@@ -523,9 +835,9 @@ void MinerApp::initHttp()
             utils::Dictionary dict;
             getStandardDictionary(dict);
             dict["%block-id%"] = std::to_string(blockIndex);
-            dict["%block-hash%"] = block.hash();
-            dict["%block-previoushash%"] = block.previousHash();
-            dict["%block-root%"] = "TODO: MERKLE ROOT";
+            dict["%block-hash%"] = block.hash().hex();
+            dict["%block-previoushash%"] = block.previousHash().hex();
+            dict["%block-root%"] = ash::crypto::DigestToHex(CalculateMerkleRoot(block.transactions()));
             dict["%block-time%"] = "TODO: BLOCK TIME";
             dict["%block-difficulty%"] = std::to_string(block.difficulty());
             dict["%block-nonce%"] = std::to_string(block.nonce());
@@ -558,6 +870,21 @@ void MinerApp::initHttp()
         {
             this->servePage(response, "createtx.html", createtx_html, {});
         };
+
+    // time every handler so the miner can back off when requests slow down
+    for (auto& [path, methods] : _httpServer.resource)
+    {
+        for (auto& [method, handler] : methods)
+        {
+            handler =
+                [this, inner = std::move(handler)](std::shared_ptr<HttpResponse> response, std::shared_ptr<HttpRequest> request)
+                {
+                    const auto start = MiningScheduler::Clock::now();
+                    inner(response, request);
+                    _scheduler.recordLatency(MiningScheduler::Clock::now() - start);
+                };
+        }
+    }
 }
 
 void MinerApp::initWebSocket()
@@ -607,6 +934,12 @@ void MinerApp::initWebSocket()
                 return;
             }
         });
+
+    _peers.onBinaryMessage.connect(
+        [this](PeerManager::ConnectionProxyPtr connection, const std::string& rawmsg)
+        {
+            this->handleBinaryMessage(connection, rawmsg);
+        });
 }
 
 void MinerApp::initPeers()
@@ -624,14 +957,27 @@ void MinerApp::initPeers()
 
 void MinerApp::run()
 {
-    _rewardAddress= _settings->value("mining.miner.address", "");
-    if (_rewardAddress.empty() || _rewardAddress == "<CHANGE ME>")
+    const auto rewardAddress = _settings->value("mining.miner.address", "");
+    if (rewardAddress.empty() || rewardAddress == "<CHANGE ME>")
     {
         _logger->critical("the setting 'mining.miner.address' in the config file must be updated");
         _logger->critical("use 'ash --createwallet' to create a new address");
         return;
     }
 
+    if (const auto address = ash::Address::FromBase58(rewardAddress); address.has_value())
+    {
+        _rewardAddress = *address;
+    }
+    else
+    {
+        _logger->critical("the setting 'mining.miner.address' is not a valid address: '{}'", rewardAddress);
+        return;
+    }
+
+    const auto nonceBits = _settings->value("mining.work.noncebits", 32u);
+    _workManager = std::make_unique<WorkManager>(_rewardAddress, _uuid, std::uint64_t{ 1 } << nonceBits);
+
     initHttp();
     initWebSocket();
     initPeers();
@@ -641,7 +987,7 @@ void MinerApp::run()
         {
             Transactions txs;
             txs.push_back(ash::CreateCoinbaseTransaction(0, _rewardAddress));
-            Block gen{ 0, "", std::move(txs) };
+            Block gen{ 0, Hash256{}, std::move(txs) };
             gen.setMiner(this->_uuid);
 
             std::time_t t = std::time(nullptr);
@@ -656,7 +1002,12 @@ void MinerApp::run()
 
     // maybe it's ok if the blockchain has some concept of
     // a persistence object?
-    _database->initialize(*_blockchain, genesisBlockCallback);
+    {
+        // peers are already connected and may queue a chain
+        std::lock_guard<std::mutex> lock{_chainMutex};
+        _database->initialize(*_blockchain, genesisBlockCallback);
+        _chainTip.publish(_blockchain->back().index(), _blockchain->back().hash());
+    }
 
     _httpThread = std::thread(
         [this]()
@@ -665,6 +1016,8 @@ void MinerApp::run()
             _httpServer.start();
         });
 
+    _statsThread = std::thread(&MinerApp::runStatsThread, this);
+
     if (_settings->value("mining.autostart", false))
     {
         _mineThread = std::thread(&MinerApp::runMineThread, this);
@@ -691,81 +1044,269 @@ void MinerApp::run()
 
 void MinerApp::runMineThread()
 {
-    auto keepMiningCallback =
-        [this](std::uint64_t index) -> bool
+    TemplateBuilder builder{ _rewardAddress, _uuid };
+
+    // the template being mined and the last block this node mined,
+    // which is announced while the next block is being mined
+    std::optional<BlockTemplate> current;
+    std::optional<codec::Buffer> announce;
+
+    // gives a template's transactions back to the chain, the
+    // caller must hold `_chainMutex`
+    auto requeue =
+        [this](std::optional<BlockTemplate>& tmpl) -> std::size_t
         {
-            std::lock_guard<std::mutex> lock{_chainMutex};
-            return !_tempchain
-                || _tempchain->size() == 0
-                || _tempchain->back().index() < index;
+            std::size_t count = 0;
+            if (tmpl)
+            {
+                count = _blockchain->reQueueTransactions(*tmpl->block);
+                tmpl.reset();
+            }
+
+            return count;
         };
 
+    // transactions queued while a block is mined join it
+    // without the miner starting over
+    _miner.setRefreshFunc(
+        [this, &builder, &current](Block& block) -> std::optional<BlockCommitment>
+        {
+            // mining threads run at the lowest priority so they must
+            // not wait on the chain or make anyone else wait for long
+            std::unique_lock<std::mutex> lock{_chainMutex, std::try_to_lock};
+            if (!lock.owns_lock())
+            {
+                return std::nullopt;
+            }
+
+            assert(current && current->block.get() == &block);
+
+            if (!builder.refresh(*_blockchain, *current))
+            {
+                return std::nullopt;
+            }
+
+            return current->commitment;
+        });
+
     while (!_miningDone && !_done)
     {
-        std::unique_ptr<Block> newblock;
-
+        if (!current)
         {
             std::lock_guard<std::mutex> lock{_chainMutex};
-
-            auto newDifficulty = _blockchain->getAdjustedDifficulty();
-            _miner.setDifficulty(newDifficulty);
-
-            newblock = _blockchain->createUnminedBlock(_rewardAddress);
-            newblock->setMiner(_uuid);
-            newblock->setData(fmt::format("coinbase block #{}", newblock->index()));
+            current = builder.build(*_blockchain);
+            _miner.setDifficulty(_blockchain->getAdjustedDifficulty());
         }
 
-        assert(newblock);
+        auto& newblock = *current->block;
+        const auto index = newblock.index();
         _logger->debug("mining block #{}, difficulty={}, transactions={}",
-            newblock->index(), _miner.difficulty(), newblock->transactions().size());
+            index, _miner.difficulty(), newblock.transactions().size());
+
+        // announce the last block and build the next block's template
+        // while this one is mined so hashing only pauses to append blocks
+        auto background = std::async(std::launch::async,
+            [this, &builder, index, announce = std::move(announce)]()
+            {
+                // see if there's an update waiting for the local
+                // copy of the chain
+                if (announce && !syncBlockchain())
+                {
+                    // let the network know about our new coin
+                    broadcastNewBlock(*announce);
+                }
+
+                std::lock_guard<std::mutex> lock{_chainMutex};
+                return std::optional<BlockTemplate>{ builder.prebuild(*_blockchain, index + 1) };
+            });
 
-        if (auto result = _miner.mineBlock(*newblock, keepMiningCallback);
-                result != Miner::SUCCESS)
+        announce.reset();
+
+        // the miner watches `_chainTip` and gives up on the block
+        // as soon as a peer's chain reaches the same height
+        const auto result = _miner.mineBlock(newblock, current->commitment);
+        auto next = background.get();
+
+        if (result != Miner::SUCCESS)
         {
+            if (result == Miner::STALE)
+            {
+                _logger->debug("mining block #{} went stale {}us after the chain tip changed",
+                    index,
+                    std::chrono::duration_cast<std::chrono::microseconds>(_miner.staleStats().last).count());
+            }
+
             {
                 std::lock_guard<std::mutex> lock{_chainMutex};
-                auto count = _blockchain->reQueueTransactions(*newblock);
-                _logger->debug("mining block #{} was aborted, requeueing {} transaction", newblock->index(), count);
+                auto count = requeue(current) + requeue(next);
+                _logger->debug("mining block #{} was aborted, requeueing {} transaction", index, count);
             }
 
             syncBlockchain();
             continue;
         }
 
-        // TODO: need better locking/syncing on the chain from 
-        //       point on
+        std::lock_guard<std::mutex> lock{_chainMutex};
+
+        // an external miner may have solved this height first, or a
+        // peer's chain of the same height was adopted while mining
+        if (index != _blockchain->size()
+            || newblock.previousHash() != _blockchain->back().hash())
+        {
+            auto count = requeue(current) + requeue(next);
+            _logger->debug("block #{} no longer extends the chain, requeueing {} transaction",
+                index, count);
+            continue;
+        }
 
         // append the block to the chain
-        if (!_blockchain->addNewBlock(*newblock))
+        if (!_blockchain->addNewBlock(newblock))
         {
-            _logger->error("could not add new block #{} to blockchain, stopping mining", newblock->index());
+            _logger->error("could not add new block #{} to blockchain, stopping mining", index);
+            requeue(next);
             _miningDone = true;
             break;
         }
 
-        // write the block to the database
-        _database->write(*newblock);
+        _chainTip.publish(index, newblock.hash());
 
-        // see if there's an update waiting for the local
-        // copy of the chain
-        if (!syncBlockchain())
+        // the same bytes are written to the database and broadcast
+        announce = EncodeBlock(newblock);
+        _database->write(*announce);
+
+        // switch to the next template before the chain can change
+        if (builder.finish(*_blockchain, *next))
         {
-            // let the network know about our new coin
-            broadcastNewBlock(*newblock);
+            current = std::move(next);
+            _miner.setDifficulty(_blockchain->getAdjustedDifficulty());
         }
+        else
+        {
+            current.reset();
+            requeue(next);
+        }
+    }
+
+    if (announce && !syncBlockchain())
+    {
+        broadcastNewBlock(*announce);
     }
+
+    _miner.setRefreshFunc(nullptr);
+
+    std::lock_guard<std::mutex> lock{_chainMutex};
+    requeue(current);
 }
 
-void MinerApp::broadcastNewBlock(const Block& block)
+// samples the miner's hash counters every second and
+// logs the rates every `mining.stats.interval` seconds
+void MinerApp::runStatsThread()
+{
+    const auto logInterval =
+        std::chrono::seconds{ _settings->value("mining.stats.interval", 60u) };
+
+    auto nextSample = HashRateMeter::Clock::now();
+    auto nextLog = nextSample + logInterval;
+
+    while (!_done)
+    {
+        const auto now = HashRateMeter::Clock::now();
+        if (now < nextSample)
+        {
+            std::this_thread::sleep_for(100ms);
+            continue;
+        }
+
+        _hashRate.sample(_miner.threadHashCounts(), now);
+        nextSample = now + 1s;
+
+        if (logInterval.count() == 0 || now < nextLog || _miningDone)
+        {
+            continue;
+        }
+
+        nextLog = now + logInterval;
+
+        double network = 0;
+        {
+            std::lock_guard<std::mutex> lock{_chainMutex};
+            network = EstimateNetworkHashRate(*_blockchain, NetworkHashRateWindow);
+        }
+
+        const auto rates = _hashRate.rates();
+        _logger->info("hash rate {} (1m {}, 15m {}) on {} thread(s), network {}",
+            FormatHashRate(rates.second), FormatHashRate(rates.minute),
+            FormatHashRate(rates.quarter), rates.threads.size(), FormatHashRate(network));
+    }
+}
+
+nl::json MinerApp::getWork()
 {
     std::lock_guard<std::mutex> lock{_chainMutex};
+    return _workManager->getWork(*_blockchain, _chainTip);
+}
+
+std::tuple<WorkResult, nl::json> MinerApp::submitWork(std::uint64_t jobId, std::uint64_t nonce)
+{
+    WorkResult result;
+    std::optional<Block> block;
+    codec::Buffer encoded;
+
+    {
+        std::lock_guard<std::mutex> lock{_chainMutex};
+        std::tie(result, block) = _workManager->submitWork(*_blockchain, _chainTip, jobId, nonce);
 
+        if (block)
+        {
+            _chainTip.publish(block->index(), block->hash());
+            encoded = EncodeBlock(*block);
+            _database->write(encoded);
+        }
+    }
+
+    nl::json retval;
+    retval["result"] = WorkResultValue::ToString(result);
+
+    if (block)
+    {
+        retval["index"] = block->index();
+        retval["hash"] = block->hash();
+        broadcastNewBlock(encoded);
+    }
+
+    return { result, retval };
+}
+
+// `block` is the block's codec encoding, see EncodeBlock()
+void MinerApp::broadcastNewBlock(const codec::Buffer& block)
+{
+    codec::Buffer frame;
+    frame.reserve(block.size() + 64);
+
+    codec::Writer writer{ frame };
+    codec::WriteFrameHeader(writer, "newblock", "request");
+
+    // peers that did not say they read binary frames get JSON
     nl::json msg;
     msg["message"] = "newblock";
     msg["message-type"] = "request";
-    msg["block"] = _blockchain->back();
-    msg["cumdiff"] = _blockchain->cumDifficulty();
-    _peers.broadcast(msg.dump());
+
+    {
+        Block decoded;
+        codec::Reader reader{ block };
+        read_block(reader, decoded, codec::FORMAT_VERSION);
+        msg["block"] = decoded;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock{_chainMutex};
+        const auto cumdiff = _blockchain->cumDifficulty();
+        WriteChainWork(writer, cumdiff);
+        msg["cumdiff"] = ChainWorkToJson(cumdiff);
+    }
+
+    writer.bytes(block);
+    _peers.broadcast(frame, msg.dump());
 }
 
 // the blockchain is synced at startup and
@@ -774,6 +1315,8 @@ void MinerApp::broadcastNewBlock(const Block& block)
 // the temp blockchain
 bool MinerApp::syncBlockchain()
 {
+    const auto busy = _scheduler.busy();
+
     bool retval = false;
     if (std::lock_guard<std::mutex> lock{_chainMutex}; 
         _tempchain)
@@ -782,7 +1325,6 @@ bool MinerApp::syncBlockchain()
         {
             // we're replacing the full chain
             _blockchain.swap(_tempchain);
-            _database->reset();
             _database->writeChain(*_blockchain);
             retval = true;
         }
@@ -800,7 +1342,6 @@ bool MinerApp::syncBlockchain()
                 }
             }
 
-            _database->reset();
             _database->writeChain(*_blockchain);
             retval = true;
         }
@@ -823,6 +1364,7 @@ bool MinerApp::syncBlockchain()
         }
 
         _tempchain.reset();
+        _chainTip.publish(_blockchain->back().index(), _blockchain->back().hash());
     }
     
     return retval;
@@ -836,15 +1378,23 @@ void MinerApp::dispatchRequest(HcConnectionPtr connection, const nl::json& json)
     nl::json jresponse;
     if (message == "summary")
     {
+        std::lock_guard<std::mutex> lock{_chainMutex};
         jresponse["blocks"].push_back(_blockchain->front());
         jresponse["blocks"].push_back(_blockchain->back());
-        jresponse["cumdiff"] = _blockchain->cumDifficulty();
+        jresponse["cumdiff"] = ChainWorkToJson(_blockchain->cumDifficulty());
+
+        // new blocks can be sent to this node as binary frames
+        jresponse["encoding"] = "binary";
     }
     else if (message == "chain")
     {
+        // the blocks [first, last) of the local chain
+        auto first = _blockchain->begin();
+        auto last = _blockchain->end();
+
         if (!json.contains("id1") && !json.contains("id2"))
         {
-            jresponse["blocks"] = *(this->_blockchain);
+            // nothing to do
         }
         else if (!json["id1"].is_number())
         {
@@ -859,48 +1409,76 @@ void MinerApp::dispatchRequest(HcConnectionPtr connection, const nl::json& json)
             auto id1 = json["id1"].get<std::uint64_t>();
             auto id2 = json["id2"].get<std::uint64_t>();
 
-            auto startIt = std::find_if(_blockchain->begin(), _blockchain->end(),
+            first = std::find_if(_blockchain->begin(), _blockchain->end(),
                 [id1](const Block& block)
                 {
                     return block.index() == id1;
                 });
 
-            if (startIt == _blockchain->end())
+            if (first == _blockchain->end())
             {
                 jresponse["error"] = "could not find id1 in chain";
             }
             else
             {
-                for (auto currentIt = startIt; 
-                    currentIt != _blockchain->end() && currentIt->index() <= id2; currentIt++)
-                {
-                    jresponse["blocks"].push_back(*currentIt);
-                }
+                last = std::find_if(first, _blockchain->end(),
+                    [id2](const Block& block)
+                    {
+                        return block.index() > id2;
+                    });
+            }
+        }
+
+        if (jresponse.contains("error"))
+        {
+            // nothing to do
+        }
+        else if (json.value("encoding", "") == "binary")
+        {
+            codec::Buffer frame;
+            codec::Writer writer{ frame };
+            codec::WriteFrameHeader(writer, "chain", "response");
+            write_blocks(writer,
+                first != last ? &*first : nullptr, static_cast<std::size_t>(last - first));
+
+            connection->sendBinary(frame);
+            return;
+        }
+        else
+        {
+            jresponse["blocks"] = nl::json::array();
+            for (auto currentIt = first; currentIt != last; currentIt++)
+            {
+                jresponse["blocks"].push_back(*currentIt);
             }
         }
     }
     else if (message == "newblock")
     {
-        std::lock_guard<std::mutex> _lock(_chainMutex);
-
-        const auto newblock = json["block"].get<Block>();
-        auto remote_cumdiff = json["cumdiff"].get<std::uint64_t>();
-        auto local_cumdiff = _blockchain->cumDifficulty();
-
-        _logger->trace("received 'newblock' message with block #{} and cumulative diff of {}",
-            newblock.index(), remote_cumdiff);
-
-        if (remote_cumdiff > local_cumdiff
-            || (remote_cumdiff == local_cumdiff && newblock.index() > _blockchain->back().index()))
+        if (handleNewBlock(connection, json["block"].get<Block>(), ChainWorkFromJson(json["cumdiff"])))
         {
-            // TODO: it would probably be best here to check if `newblock` is the next
-            // in our chain and add it to our tempchain
-
-            // get a summary from the machine that sent us this longer chain
-            connection->sendRequest("summary");
             return;
         }
     }
+    else if (message == "getwork")
+    {
+        jresponse = getWork();
+    }
+    else if (message == "submitwork")
+    {
+        if (!json.contains("jobid")
+            || !json["jobid"].is_number_unsigned()
+            || !json.contains("nonce")
+            || !json["nonce"].is_number_unsigned())
+        {
+            jresponse["error"] = "invalid work submission";
+        }
+        else
+        {
+            jresponse = std::get<1>(submitWork(
+                json["jobid"].get<std::uint64_t>(), json["nonce"].get<std::uint64_t>()));
+        }
+    }
     else if (message == "createtx")
     {
         if (!json.contains("privatekey")
@@ -945,20 +1523,35 @@ void MinerApp::handleResponse(HcConnectionPtr connection, const nl::json& json)
             return;
         }
 
+        if (json.value("encoding", "") == "binary")
+        {
+            _peers.setBinary(connection->_client);
+        }
+
         const auto& remote_gen = json["blocks"].at(0).get<ash::Block>();
         const auto& remote_last = json["blocks"].at(1).get<ash::Block>();
 
-        auto local_cumdiff = _blockchain->cumDifficulty();
-        auto remote_cumdiff = json["cumdiff"].get<std::uint64_t>();
-        
+        const auto remote_cumdiff = ChainWorkFromJson(json["cumdiff"]);
+
         // TODO: we're using the 'summary' command to determine
         // if we need to replace/update the chain, but we only
         // do those checks in 'summary'. We should do the thing
         // in the 'chain' command.
-        const auto& genesis = _tempchain ? _tempchain->front() : _blockchain->front();
-        const auto& lastblock = _tempchain ? _tempchain->back() : _blockchain->back();
+        ChainWork local_cumdiff;
+        bool knownChain = false;
+        std::uint64_t lastIndex = 0;
+
+        {
+            std::lock_guard<std::mutex> lock{_chainMutex};
+            const auto& genesis = _tempchain ? _tempchain->front() : _blockchain->front();
+            const auto& lastblock = _tempchain ? _tempchain->back() : _blockchain->back();
+
+            local_cumdiff = _blockchain->cumDifficulty();
+            knownChain = genesis == remote_gen;
+            lastIndex = lastblock.index();
+        }
 
-        if (genesis != remote_gen)
+        if (!knownChain)
         {
             _logger->warn("wsc:/chain 'summary' returned unknown chain on connection {}", 
                 static_cast<void*>(connection.get()));
@@ -966,18 +1559,18 @@ void MinerApp::handleResponse(HcConnectionPtr connection, const nl::json& json)
             if (_settings->value("chain.reset.enable", false))
             {
                 _logger->info("requesting full remote chain");
-                connection->sendRequest("chain");
+                connection->sendRequestFmt("chain", R"({{ "encoding":"binary" }})");
             }
         }
         else if (local_cumdiff < remote_cumdiff)
         {
-            auto startIdx = lastblock.index() + 1;
+            auto startIdx = lastIndex + 1;
             auto stopIdx = remote_last.index();
 
             _logger->info("remote chain has a greater cumulative difficulty ({}) than local chain ({}), requesting #{}-#{}",
-                remote_cumdiff, local_cumdiff, startIdx, stopIdx);
+                remote_cumdiff.str(), local_cumdiff.str(), startIdx, stopIdx);
 
-            connection->sendRequestFmt("chain", R"({{ "id1":{},"id2":{} }})", startIdx, stopIdx);
+            connection->sendRequestFmt("chain", R"({{ "id1":{},"id2":{},"encoding":"binary" }})", startIdx, stopIdx);
         }
         else
         {
@@ -987,19 +1580,10 @@ void MinerApp::handleResponse(HcConnectionPtr connection, const nl::json& json)
     }
     else if (message == "chain")
     {
-        if (const auto tempchain = json["blocks"].get<ash::Blockchain>();
-                tempchain.size() <= 0 || !tempchain.isValidChain())
+        if (!handleChainBlocks(connection, json["blocks"].get<ash::Blockchain>()))
         {
-            _logger->info("received invalid chain from connection {}", 
-                static_cast<void*>(connection.get()));
-
             return;
         }
-        else
-        {
-            std::lock_guard<std::mutex> lock(_chainMutex);
-            handleChainResponse(connection, tempchain);
-        }        
     }
 
     if (this->_miningDone)
@@ -1008,6 +1592,112 @@ void MinerApp::handleResponse(HcConnectionPtr connection, const nl::json& json)
     }
 }
 
+// binary frames from peers, these carry the messages with blocks
+void MinerApp::handleBinaryMessage(HcConnectionPtr connection, const std::string& rawmsg)
+{
+    try
+    {
+        codec::Reader reader{ { reinterpret_cast<const std::uint8_t*>(rawmsg.data()), rawmsg.size() } };
+        const auto header = codec::ReadFrameHeader(reader);
+
+        _logger->debug("binary message='{}' message-type='{}' received from {}",
+            header.message, header.type, connection->address());
+
+        if (header.message == "newblock" && header.type == "request")
+        {
+            const auto cumdiff = ReadChainWork(reader);
+
+            Block block;
+            read_block(reader, block, header.version);
+            handleNewBlock(connection, block, cumdiff);
+        }
+        else if (header.message == "chain" && header.type == "response")
+        {
+            Blockchain tempchain;
+            read_blocks(reader, tempchain, header.version);
+
+            if (handleChainBlocks(connection, tempchain) && this->_miningDone)
+            {
+                syncBlockchain();
+            }
+        }
+        else
+        {
+            _logger->warn("ws:/chain received unknown binary message '{}' from node {}",
+                header.message, connection->address());
+        }
+    }
+    catch (const std::exception& ex)
+    {
+        _logger->warn("ws:/chain received malformed binary message from node {}: {}",
+            connection->address(), ex.what());
+
+        connection->sendError("the recieved message was malformed");
+    }
+}
+
+// returns 'true' when a summary of the sender's longer chain was requested
+bool MinerApp::handleNewBlock(HcConnectionPtr connection, const Block& newblock, const ChainWork& remote_cumdiff)
+{
+    std::lock_guard<std::mutex> _lock(_chainMutex);
+
+    auto local_cumdiff = _blockchain->cumDifficulty();
+
+    _logger->trace("received 'newblock' message with block #{} and cumulative diff of {}",
+        newblock.index(), remote_cumdiff.str());
+
+    if (remote_cumdiff > local_cumdiff
+        || (remote_cumdiff == local_cumdiff && newblock.index() > _blockchain->back().index()))
+    {
+        // TODO: it would probably be best here to check if `newblock` is the next
+        // in our chain and add it to our tempchain
+
+        // get a summary from the machine that sent us this longer chain
+        connection->sendRequest("summary");
+        return true;
+    }
+
+    return false;
+}
+
+// returns 'false' if the blocks were not a valid chain
+bool MinerApp::handleChainBlocks(HcConnectionPtr connection, const Blockchain& tempchain)
+{
+    const auto busy = _scheduler.busy();
+
+    if (tempchain.size() <= 0)
+    {
+        _logger->info("received empty chain from connection {}", 
+            static_cast<void*>(connection.get()));
+
+        return false;
+    }
+    else if (const auto invalid = tempchain.firstInvalidBlock(); invalid.has_value())
+    {
+        _logger->info("received invalid chain from connection {}, block #{} failed validation", 
+            static_cast<void*>(connection.get()), tempchain.at(*invalid).index());
+
+        return false;
+    }
+
+    // a full chain replaces ours as it is, so its transactions are checked
+    // here. Blocks that extend our chain go through addNewBlock() instead
+    if (tempchain.front().index() == 0)
+    {
+        if (const auto invalid = tempchain.firstInvalidTransactions(); invalid.has_value())
+        {
+            _logger->info("received invalid chain from connection {}, block #{} has invalid transactions",
+                static_cast<void*>(connection.get()), tempchain.at(*invalid).index());
+
+            return false;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(_chainMutex);
+    handleChainResponse(connection, tempchain);
+    return true;
+}
+
 void MinerApp::handleChainResponse(HcConnectionPtr connection, const Blockchain& tempchain)
 {
     if (tempchain.front().index() == 0)
@@ -1017,6 +1707,7 @@ void MinerApp::handleChainResponse(HcConnectionPtr connection, const Blockchain&
 
         _tempchain = std::make_unique<ash::Blockchain>();
         *_tempchain = std::move(tempchain);
+        _chainTip.queue(_tempchain->back().index());
     }
     else if (tempchain.front().index() > _blockchain->back().index() + 1)
     {
@@ -1025,7 +1716,7 @@ void MinerApp::handleChainResponse(HcConnectionPtr connection, const Blockchain&
         auto stopIdx = tempchain.back().index();
 
         _logger->info("temp chain has gap, requesting remote blocks {}-{}", startIdx, stopIdx);
-        connection->sendRequestFmt("chain", R"({{ "message":"chain","id1":{},"id2":{} }})", startIdx, stopIdx);
+        connection->sendRequestFmt("chain", R"({{ "message":"chain","id1":{},"id2":{},"encoding":"binary" }})", startIdx, stopIdx);
     }
     else
     {
@@ -1044,6 +1735,7 @@ void MinerApp::handleChainResponse(HcConnectionPtr connection, const Blockchain&
 
             _tempchain = std::make_unique<ash::Blockchain>();
             *_tempchain = tempchain;
+            _chainTip.queue(_tempchain->back().index());
         }
         else
         {
@@ -1051,7 +1743,7 @@ void MinerApp::handleChainResponse(HcConnectionPtr connection, const Blockchain&
             auto stopIdx = tempchain.back().index();
             
             _logger->debug("temp chain is misaligned, requesting remote blocks {}-{}", startIdx, stopIdx);
-            connection->sendRequestFmt("chain", R"x({{ "id1":{},"id2":{} }})x", startIdx, stopIdx);
+            connection->sendRequestFmt("chain", R"x({{ "id1":{},"id2":{},"encoding":"binary" }})x", startIdx, stopIdx);
         }
     }
 }
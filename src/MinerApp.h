@@ -13,11 +13,15 @@
 
 #include "AshUtils.h"
 #include "AshLogger.h"
+#include "BinaryCodec.h"
 #include "Blockchain.h"
+#include "ChainTip.h"
 #include "ChainDatabase.h"
 #include "Settings.h"
 #include "PeerManager.h"
 #include "Miner.h"
+#include "MiningScheduler.h"
+#include "WorkManager.h"
 
 namespace ash
 {
@@ -25,6 +29,14 @@ namespace ash
 constexpr auto HTTPServerPortDefault = 27182u;
 constexpr auto WebSocketServerPorDefault = 14142u;
 
+// number of recent blocks used to estimate the network's hash rate
+constexpr std::size_t NetworkHashRateWindow = 100u;
+
+// entries of an address's ledger returned by /rest/history when no
+// count is given, and the most that are returned at once
+constexpr std::size_t HistoryPageDefault = 25u;
+constexpr std::size_t HistoryPageMax = 500u;
+
 using HttpServer = SimpleWeb::Server<SimpleWeb::HTTP>;
 
 using HttpRequest = HttpServer::Request;
@@ -38,7 +50,7 @@ using WsServer = SimpleWeb::SocketServer<SimpleWeb::WS>;
 struct UpdatePackage
 {
     BlockChainPtr   tempchain;
-    std::uint64_t   tempcumdiff;
+    ChainWork       tempcumdiff;
 };
 
 class MinerApp
@@ -71,14 +83,22 @@ private:
     void initPeers();
 
     void runMineThread();
+    void runStatsThread();
     [[maybe_unused]] bool syncBlockchain();
-    void broadcastNewBlock(const Block& block);
+    void broadcastNewBlock(const codec::Buffer& block);
+
+    // jobs for external miners, shared by REST and the websocket RPC
+    nl::json getWork();
+    std::tuple<WorkResult, nl::json> submitWork(std::uint64_t jobId, std::uint64_t nonce);
 
     using HcConnection = PeerManager::ConnectionProxy;
     using HcConnectionPtr = std::shared_ptr<HcConnection>;
 
     void dispatchRequest(HcConnectionPtr, const nl::json& json);
     void handleResponse(HcConnectionPtr, const nl::json& json);
+    void handleBinaryMessage(HcConnectionPtr, const std::string& rawmsg);
+    bool handleNewBlock(HcConnectionPtr, const Block& block, const ChainWork& cumdiff);
+    bool handleChainBlocks(HcConnectionPtr, const Blockchain&);
     void handleChainResponse(HcConnectionPtr, const Blockchain&);
     void handleError(HcConnectionPtr, const nl::json&);
 
@@ -88,7 +108,7 @@ private:
 
 private:
     std::string             _uuid;
-    std::string             _rewardAddress;
+    Address                 _rewardAddress;
 
     ChainDatabasePtr        _database;
     
@@ -96,6 +116,7 @@ private:
     
     BlockChainPtr           _blockchain;
     BlockChainPtr           _tempchain;
+    ChainTip                _chainTip;      // published under _chainMutex
 
     SettingsPtr             _settings;
     PeerManager             _peers;
@@ -106,9 +127,15 @@ private:
     std::atomic_bool        _done = false;
     std::atomic_bool        _miningDone = false;
     
+    MiningScheduler         _scheduler;
     Miner                   _miner;
     std::thread             _mineThread;
 
+    std::unique_ptr<WorkManager>    _workManager;   // guarded by `_chainMutex`
+
+    HashRateMeter           _hashRate;
+    std::thread             _statsThread;
+
     SpdLogPtr               _logger;
 };
 
@@ -0,0 +1,204 @@
+#include <charconv>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#if defined(__linux__)
+#include <pthread.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+#include "MiningScheduler.h"
+
+namespace ash
+{
+
+namespace
+{
+
+std::uint32_t ParseCpu(std::string_view text, std::string_view cpuset)
+{
+    std::uint32_t retval = 0;
+    const auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), retval);
+    if (text.empty() || ec != std::errc{} || ptr != text.data() + text.size())
+    {
+        throw std::invalid_argument(fmt::format("invalid cpu set '{}'", cpuset));
+    }
+
+    return retval;
+}
+
+} // namespace
+
+std::vector<std::uint32_t> ParseCpuSet(std::string_view text)
+{
+    std::vector<std::uint32_t> retval;
+
+    auto rest = text;
+    while (!rest.empty())
+    {
+        const auto comma = rest.find(',');
+        const auto item = rest.substr(0, comma);
+        rest = comma == std::string_view::npos ? std::string_view{} : rest.substr(comma + 1);
+
+        if (const auto dash = item.find('-'); dash != std::string_view::npos)
+        {
+            const auto first = ParseCpu(item.substr(0, dash), text);
+            const auto last = ParseCpu(item.substr(dash + 1), text);
+            if (first > last)
+            {
+                throw std::invalid_argument(fmt::format("invalid cpu set '{}'", text));
+            }
+
+            for (auto cpu = first; cpu <= last; cpu++)
+            {
+                retval.push_back(cpu);
+            }
+        }
+        else
+        {
+            retval.push_back(ParseCpu(item, text));
+        }
+    }
+
+    return retval;
+}
+
+//*** MiningScheduler::WorkerScope
+MiningScheduler::WorkerScope::WorkerScope(const MiningScheduler& scheduler, std::uint32_t workerIdx)
+    : _logger{ scheduler._logger },
+      _workerIdx{ workerIdx }
+{
+    const auto& cpus = scheduler._cpus;
+
+#if defined(__linux__)
+    const auto self = pthread_self();
+
+    if (!cpus.empty()
+        && pthread_getaffinity_np(self, sizeof(_affinity), &_affinity) == 0)
+    {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(cpus[workerIdx % cpus.size()], &cpuset);
+
+        _restoreAffinity = pthread_setaffinity_np(self, sizeof(cpuset), &cpuset) == 0;
+        if (!_restoreAffinity)
+        {
+            scheduler._logger->warn("could not pin mining worker {} to cpu {}",
+                workerIdx, cpus[workerIdx % cpus.size()]);
+        }
+    }
+
+    // SCHED_IDLE threads only get a core when nothing else wants it
+    sched_param param{};
+    if (pthread_getschedparam(self, &_policy, &param) == 0)
+    {
+        _priority = param.sched_priority;
+
+        sched_param idle{};
+        if (pthread_setschedparam(self, SCHED_IDLE, &idle) != 0)
+        {
+            _policy = -1;
+        }
+    }
+#elif defined(_WIN32)
+    const auto self = GetCurrentThread();
+
+    if (!cpus.empty())
+    {
+        const auto cpu = cpus[workerIdx % cpus.size()];
+        _affinity = static_cast<std::uintptr_t>(SetThreadAffinityMask(self, DWORD_PTR{ 1 } << cpu));
+        if (_affinity == 0)
+        {
+            scheduler._logger->warn("could not pin mining worker {} to cpu {}", workerIdx, cpu);
+        }
+    }
+
+    _priority = GetThreadPriority(self);
+    _restorePriority = _priority != THREAD_PRIORITY_ERROR_RETURN
+        && SetThreadPriority(self, THREAD_PRIORITY_IDLE);
+#else
+    // macOS has no thread affinity, the workers only pause
+    // when the node is busy
+    (void)cpus;
+    (void)workerIdx;
+#endif
+}
+
+MiningScheduler::WorkerScope::~WorkerScope()
+{
+#if defined(__linux__)
+    const auto self = pthread_self();
+
+    if (_policy != -1)
+    {
+        sched_param param{};
+        param.sched_priority = _priority;
+        if (const auto error = pthread_setschedparam(self, _policy, &param); error != 0)
+        {
+            _logger->warn("could not restore the priority of mining worker {} (error {})",
+                _workerIdx, error);
+        }
+    }
+
+    if (_restoreAffinity)
+    {
+        pthread_setaffinity_np(self, sizeof(_affinity), &_affinity);
+    }
+#elif defined(_WIN32)
+    const auto self = GetCurrentThread();
+
+    if (_restorePriority && !SetThreadPriority(self, _priority))
+    {
+        _logger->warn("could not restore the priority of mining worker {} (error {})",
+            _workerIdx, GetLastError());
+    }
+
+    if (_affinity != 0)
+    {
+        SetThreadAffinityMask(self, static_cast<DWORD_PTR>(_affinity));
+    }
+#endif
+}
+
+//*** MiningScheduler
+MiningScheduler::MiningScheduler()
+    : _logger(ash::initializeLogger("MiningScheduler"))
+{
+    // nothing to do
+}
+
+void MiningScheduler::recordLatency(std::chrono::nanoseconds latency)
+{
+    if (_budget.count() == 0 || latency <= _budget)
+    {
+        return;
+    }
+
+    _overBudget.fetch_add(1, std::memory_order_relaxed);
+
+    const auto until = (Clock::now() + THROTTLE_WINDOW).time_since_epoch().count();
+    auto current = _throttleUntil.load(std::memory_order_relaxed);
+    while (current < until
+        && !_throttleUntil.compare_exchange_weak(current, until, std::memory_order_relaxed))
+    {
+        // try again
+    }
+
+    _logger->trace("request took {}us, throttling the miner",
+        std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+}
+
+bool MiningScheduler::throttled() const noexcept
+{
+    if (_budget.count() == 0)
+    {
+        return false;
+    }
+
+    return _busy.load(std::memory_order_relaxed) > 0
+        || Clock::now().time_since_epoch().count() < _throttleUntil.load(std::memory_order_relaxed);
+}
+
+} // namespace ash
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "AshLogger.h"
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+namespace ash
+{
+
+// "0-3,6" is cpus 0, 1, 2, 3 and 6. Throws std::invalid_argument
+// if the text is not a list of cpus and cpu ranges
+std::vector<std::uint32_t> ParseCpuSet(std::string_view text);
+
+//! Keeps the miner out of the way of the rest of the node. Mining
+//  workers are pinned to a set of cpus and run at the lowest OS
+//  priority, and they pause while a chain sync is running or after
+//  a request took longer than the latency budget
+class MiningScheduler final
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // how long the miner backs off after a request went over budget
+    static constexpr auto THROTTLE_WINDOW = std::chrono::milliseconds{ 500 };
+
+    // how long a throttled worker sleeps before checking again
+    static constexpr auto THROTTLE_PAUSE = std::chrono::milliseconds{ 2 };
+
+    //! Pins the calling thread and lowers its priority for as long
+    //  as it lives, then puts both back. Mining worker `n` is pinned
+    //  to the n-th cpu of the scheduler's set. An unprivileged process
+    //  may not be allowed to raise the priority again, so this is only
+    //  meant for threads that exit when the worker is done
+    class WorkerScope final
+    {
+        SpdLogPtr           _logger;
+        std::uint32_t       _workerIdx;
+
+#if defined(__linux__)
+        cpu_set_t           _affinity;
+        bool                _restoreAffinity = false;
+        int                 _policy = -1;
+        int                 _priority = 0;
+#elif defined(_WIN32)
+        std::uintptr_t      _affinity = 0;
+        int                 _priority = 0;
+        bool                _restorePriority = false;
+#endif
+
+    public:
+        WorkerScope(const MiningScheduler& scheduler, std::uint32_t workerIdx);
+
+        WorkerScope(const WorkerScope&) = delete;
+        WorkerScope& operator=(const WorkerScope&) = delete;
+        ~WorkerScope();
+    };
+
+    //! Throttles the miner for as long as it lives
+    class BusyScope final
+    {
+        MiningScheduler*    _scheduler;
+
+    public:
+        explicit BusyScope(MiningScheduler& scheduler)
+            : _scheduler{ &scheduler }
+        {
+            _scheduler->_busy.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        BusyScope(const BusyScope&) = delete;
+        BusyScope& operator=(const BusyScope&) = delete;
+
+        ~BusyScope()
+        {
+            _scheduler->_busy.fetch_sub(1, std::memory_order_relaxed);
+        }
+    };
+
+    MiningScheduler();
+
+    // an empty set leaves the workers unpinned, this must not be
+    // called while a block is being mined
+    void setCpus(std::vector<std::uint32_t> cpus) { _cpus = std::move(cpus); }
+    const std::vector<std::uint32_t>& cpus() const noexcept { return _cpus; }
+
+    // a budget of zero never throttles the miner
+    void setLatencyBudget(std::chrono::milliseconds budget) { _budget = budget; }
+    std::chrono::milliseconds latencyBudget() const noexcept { return _budget; }
+
+    // the time it took the node to handle a request
+    void recordLatency(std::chrono::nanoseconds latency);
+
+    // sync work in progress, see BusyScope
+    [[nodiscard]] BusyScope busy() { return BusyScope{ *this }; }
+
+    // checked by the workers before every batch of nonces
+    bool throttled() const noexcept;
+
+    // requests that went over the budget
+    std::uint64_t overBudgetCount() const noexcept { return _overBudget.load(std::memory_order_relaxed); }
+
+private:
+    std::vector<std::uint32_t>  _cpus;
+    std::chrono::milliseconds   _budget{ 0 };
+
+    std::atomic_int64_t         _throttleUntil{ 0 };    // Clock ticks
+    std::atomic_uint32_t        _busy{ 0 };
+    std::atomic_uint64_t        _overBudget{ 0 };
+
+    SpdLogPtr                   _logger;
+};
+
+} // namespace ash
@@ -124,6 +124,7 @@ void PeerManager::createClient(const std::string& peer)
             _peers[peer].connection.reset();
             _peers[peer].connection = connection;
             _peers[peer].state = PeerData::State::CONNECTED;
+            _peers[peer].binary = false;
             
             if (_connectCallback)
             {
@@ -160,7 +161,7 @@ void PeerManager::createClient(const std::string& peer)
         [this](WsClientConnPtr connection, std::shared_ptr<WsClient::InMessage> message)
         {
             auto conn = std::make_shared<ConnectionProxy>(connection);
-            this->onChainMessage(conn, message->string());
+            this->dispatchMessage(conn, message->fin_rsv_opcode, message->string());
         };
 
     _peers[peer].worker = std::make_unique<std::thread>(
@@ -199,6 +200,50 @@ void PeerManager::broadcast(std::string_view message)
     }
 }
 
+void PeerManager::broadcast(const codec::Buffer& frame, std::string_view fallback)
+{
+    std::lock_guard<std::mutex> lock{ _peerMutex };
+    for (const auto& [peer, data] : _peers)
+    {
+        if (data.state == PeerData::State::CONNECTED)
+        {
+            assert(data.connection);
+            if (data.binary)
+            {
+                data.connection->send(AsFrameData(frame), nullptr, BinaryFrameOpcode);
+            }
+            else
+            {
+                data.connection->send(fallback);
+            }
+        }
+    }
+}
+
+void PeerManager::setBinary(const WsClientConnPtr& connection)
+{
+    std::lock_guard<std::mutex> lock{ _peerMutex };
+    for (auto& [peer, data] : _peers)
+    {
+        if (connection && data.connection == connection)
+        {
+            data.binary = true;
+        }
+    }
+}
+
+void PeerManager::dispatchMessage(ConnectionProxyPtr connection, unsigned char fin_rsv_opcode, const std::string& message)
+{
+    if ((fin_rsv_opcode & 0x0f) == (BinaryFrameOpcode & 0x0f))
+    {
+        onBinaryMessage(connection, message);
+    }
+    else
+    {
+        onChainMessage(connection, message);
+    }
+}
+
 void PeerManager::initWebSocketServer(std::uint32_t port)
 {
     _wsServer.config.port = port;
@@ -218,7 +263,7 @@ void PeerManager::initWebSocketServer(std::uint32_t port)
         [this](WsServerConnPtr connection, std::shared_ptr<WsServer::InMessage> message)
         {
             auto conn = std::make_shared<ConnectionProxy>(connection);
-            this->onChainMessage(conn, message->string());
+            this->dispatchMessage(conn, message->fin_rsv_opcode, message->string());
         };
 
     _wsThread = std::thread(
@@ -19,12 +19,21 @@
 #include <nlohmann/json.hpp>
 
 #include "AshLogger.h"
+#include "BinaryCodec.h"
 
 namespace nl = nlohmann;
 
 namespace ash
 {
 
+// fin bit set with the binary opcode, text frames are 129
+constexpr unsigned char BinaryFrameOpcode = 130;
+
+inline std::string_view AsFrameData(const codec::Buffer& frame)
+{
+    return { reinterpret_cast<const char*>(frame.data()), frame.size() };
+}
+
 class PeerManager;
 
 using WsServer = SimpleWeb::SocketServer<SimpleWeb::WS>;
@@ -45,6 +54,10 @@ struct PeerData
     WsClientConnPtr connection;
     std::unique_ptr<std::thread>     worker;
     State           state = State::OFFLINE;
+
+    // whether the peer said it reads binary frames, older
+    // nodes only understand JSON
+    bool            binary = false;
 };
 
 using PeerMap = std::map<std::string, PeerData>;
@@ -141,6 +154,13 @@ public:
             _client->send(message, callback, fin_rsv_opcode);
         }
 
+        // binary frames carry codec encoded blocks, see codec::FrameHeader
+        void sendBinary(const codec::Buffer& frame, 
+            std::function<void(const boost::system::error_code&)> callback = nullptr)
+        {
+            send(AsFrameData(frame), callback, BinaryFrameOpcode);
+        }
+
         void sendMessage(std::string_view msg, 
             std::string_view msgtype, 
             std::string_view payload, 
@@ -233,12 +253,21 @@ public:
     void connectAll(std::function<void(WsClientConnPtr)> cb);
     void broadcast(std::string_view message);
 
+    // `frame` goes to the peers that read binary frames and
+    // `fallback` to the others
+    void broadcast(const codec::Buffer& frame, std::string_view fallback);
+
+    // marks the peer on `connection` as one that reads binary frames
+    void setBinary(const WsClientConnPtr& connection);
+
     void initWebSocketServer(std::uint32_t port);
 
     boost::signals2::signal<void(ConnectionProxyPtr, const std::string&)> onChainMessage;
+    boost::signals2::signal<void(ConnectionProxyPtr, const std::string&)> onBinaryMessage;
 
 private:
     void createClient(const std::string& endpoint);
+    void dispatchMessage(ConnectionProxyPtr connection, unsigned char fin_rsv_opcode, const std::string& message);
 
     PeerMap                             _peers;      
     std::mutex                          _peerMutex;
@@ -0,0 +1,225 @@
+#include <cassert>
+
+#include "Sha256.h"
+
+#ifdef ASH_SHA256_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace ash
+{
+
+namespace crypto
+{
+
+namespace
+{
+
+constexpr std::uint32_t RotateRight(std::uint32_t x, unsigned n)
+{
+    return (x >> n) | (x << (32 - n));
+}
+
+void CompressOne(Sha256State& state, const std::uint8_t* block)
+{
+    std::array<std::uint32_t, 64> w;
+    for (auto idx = 0u; idx < 16u; idx++)
+    {
+        w[idx] = detail::ReadBigEndian32(block + (idx * 4));
+    }
+
+    for (auto idx = 16u; idx < 64u; idx++)
+    {
+        const auto s0 = RotateRight(w[idx - 15], 7) ^ RotateRight(w[idx - 15], 18) ^ (w[idx - 15] >> 3);
+        const auto s1 = RotateRight(w[idx - 2], 17) ^ RotateRight(w[idx - 2], 19) ^ (w[idx - 2] >> 10);
+        w[idx] = w[idx - 16] + s0 + w[idx - 7] + s1;
+    }
+
+    auto a = state.h[0];
+    auto b = state.h[1];
+    auto c = state.h[2];
+    auto d = state.h[3];
+    auto e = state.h[4];
+    auto f = state.h[5];
+    auto g = state.h[6];
+    auto h = state.h[7];
+
+    for (auto idx = 0u; idx < 64u; idx++)
+    {
+        const auto s1 = RotateRight(e, 6) ^ RotateRight(e, 11) ^ RotateRight(e, 25);
+        const auto ch = (e & f) ^ (~e & g);
+        const auto t1 = h + s1 + ch + SHA256_ROUND_CONSTANTS[idx] + w[idx];
+        const auto s0 = RotateRight(a, 2) ^ RotateRight(a, 13) ^ RotateRight(a, 22);
+        const auto maj = (a & b) ^ (a & c) ^ (b & c);
+        const auto t2 = s0 + maj;
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    state.h[0] += a;
+    state.h[1] += b;
+    state.h[2] += c;
+    state.h[3] += d;
+    state.h[4] += e;
+    state.h[5] += f;
+    state.h[6] += g;
+    state.h[7] += h;
+}
+
+void CompressScalar(Sha256State* states, const std::uint8_t* const* blocks, std::size_t count)
+{
+    for (auto idx = 0u; idx < count; idx++)
+    {
+        CompressOne(states[idx], blocks[idx]);
+    }
+}
+
+void HashNoncesScalar(const Sha256State& midstate, const std::uint8_t* block,
+    std::size_t nonceOffset, std::uint64_t nonce, std::size_t count, Digest* out)
+{
+    assert(ValidSha256NonceOffset(nonceOffset));
+
+    std::array<std::uint8_t, SHA256_BLOCK_SIZE> temp;
+    std::copy(block, block + SHA256_BLOCK_SIZE, temp.begin());
+
+    for (auto idx = 0u; idx < count; idx++)
+    {
+        const auto current = nonce + idx;
+        for (auto byte = 0u; byte < 8u; byte++)
+        {
+            temp[nonceOffset + byte] = static_cast<std::uint8_t>(current >> (byte * 8));
+        }
+
+        auto state = midstate;
+        CompressOne(state, temp.data());
+        out[idx] = Sha256StateToDigest(state);
+    }
+}
+
+const Sha256Kernel ScalarKernel
+{
+    "scalar",
+    1u,
+    &CompressScalar,
+    &HashNoncesScalar
+};
+
+#ifdef ASH_SHA256_X86
+struct CpuFeatures
+{
+    bool sse4 = false;
+    bool avx2 = false;
+    bool shani = false;
+};
+
+CpuFeatures DetectCpuFeatures()
+{
+    CpuFeatures features;
+    unsigned int regs[4] = { 0, 0, 0, 0 };
+    auto cpuid =
+        [&regs](unsigned int leaf, unsigned int subleaf)
+        {
+#ifdef _MSC_VER
+            int info[4];
+            __cpuidex(info, static_cast<int>(leaf), static_cast<int>(subleaf));
+            for (auto idx = 0u; idx < 4u; idx++) regs[idx] = static_cast<unsigned int>(info[idx]);
+#else
+            __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+        };
+
+    cpuid(0, 0);
+    const auto maxLeaf = regs[0];
+    if (maxLeaf < 1)
+    {
+        return features;
+    }
+
+    cpuid(1, 0);
+    const bool ssse3 = (regs[2] & (1u << 9)) != 0;
+    features.sse4 = ssse3 && (regs[2] & (1u << 19)) != 0;
+
+    // AVX2 also needs the OS to save the YMM registers
+    const bool osxsave = (regs[2] & (1u << 27)) != 0;
+    bool ymmEnabled = false;
+    if (osxsave)
+    {
+#ifdef _MSC_VER
+        const auto xcr0 = _xgetbv(0);
+#else
+        unsigned int eax = 0, edx = 0;
+        __asm__ volatile ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        const auto xcr0 = (static_cast<std::uint64_t>(edx) << 32) | eax;
+#endif
+        ymmEnabled = (xcr0 & 0x6) == 0x6;
+    }
+
+    if (maxLeaf >= 7)
+    {
+        cpuid(7, 0);
+        features.avx2 = ymmEnabled && (regs[1] & (1u << 5)) != 0;
+        features.shani = features.sse4 && (regs[1] & (1u << 29)) != 0;
+    }
+
+    return features;
+}
+#endif
+
+} // namespace
+
+Digest Sha256StateToDigest(const Sha256State& state)
+{
+    Digest digest;
+    for (auto idx = 0u; idx < state.h.size(); idx++)
+    {
+        digest[idx * 4] = static_cast<std::uint8_t>(state.h[idx] >> 24);
+        digest[idx * 4 + 1] = static_cast<std::uint8_t>(state.h[idx] >> 16);
+        digest[idx * 4 + 2] = static_cast<std::uint8_t>(state.h[idx] >> 8);
+        digest[idx * 4 + 3] = static_cast<std::uint8_t>(state.h[idx]);
+    }
+
+    return digest;
+}
+
+const Sha256Kernel& GetScalarSha256Kernel()
+{
+    return ScalarKernel;
+}
+
+std::vector<const Sha256Kernel*> GetAvailableSha256Kernels()
+{
+    std::vector<const Sha256Kernel*> retval;
+
+#ifdef ASH_SHA256_X86
+    const auto features = DetectCpuFeatures();
+
+    // in order of preference
+    if (features.shani) retval.push_back(detail::GetShaNiSha256Kernel());
+    if (features.avx2) retval.push_back(detail::GetAvx2Sha256Kernel());
+    if (features.sse4) retval.push_back(detail::GetSse4Sha256Kernel());
+#endif
+
+    retval.push_back(&ScalarKernel);
+    return retval;
+}
+
+const Sha256Kernel& GetSha256Kernel()
+{
+    static const Sha256Kernel* kernel = GetAvailableSha256Kernels().front();
+    return *kernel;
+}
+
+} // namespace ash::crypto
+
+} // namespace ash
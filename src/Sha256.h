@@ -0,0 +1,111 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "CryptoUtils.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define ASH_SHA256_X86 1
+#endif
+
+namespace ash
+{
+
+namespace crypto
+{
+
+constexpr std::size_t SHA256_BLOCK_SIZE = 64u;
+
+struct Sha256State
+{
+    std::array<std::uint32_t, 8> h;
+};
+
+constexpr Sha256State SHA256_INITIAL_STATE
+{{
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+}};
+
+constexpr std::array<std::uint32_t, 64> SHA256_ROUND_CONSTANTS
+{
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+//! A set of SHA-256 compression routines for one instruction set.
+//  `lanes` is the number of messages the kernel works on at once
+//  so callers should hand it work in multiples of that
+struct Sha256Kernel
+{
+    const char*     name;
+    std::size_t     lanes;
+
+    // runs one compression of `blocks[i]` into `states[i]` for
+    // each of the `count` independent states
+    void (*compress)(Sha256State* states, const std::uint8_t* const* blocks, std::size_t count);
+
+    // hashes `count` copies of the padded final block `block` that
+    // only differ by the little endian nonce written at `nonceOffset`
+    // which starts at `nonce` and increments by one per copy, every
+    // copy is compressed starting from `midstate`
+    void (*hashNonces)(const Sha256State& midstate, const std::uint8_t* block,
+        std::size_t nonceOffset, std::uint64_t nonce, std::size_t count, Digest* out);
+};
+
+// the fastest kernel supported by this CPU, picked on first use
+const Sha256Kernel& GetSha256Kernel();
+
+// the portable kernel that every other kernel must agree with
+const Sha256Kernel& GetScalarSha256Kernel();
+
+// every kernel that this build and this CPU can run
+std::vector<const Sha256Kernel*> GetAvailableSha256Kernels();
+
+// big endian encoding of a state as a digest
+Digest Sha256StateToDigest(const Sha256State& state);
+
+// the nonce must fall on 32-bit word boundaries within the block
+constexpr bool ValidSha256NonceOffset(std::size_t offset)
+{
+    return (offset % 4) == 0 && offset + 8 <= SHA256_BLOCK_SIZE;
+}
+
+namespace detail
+{
+
+#ifdef ASH_SHA256_X86
+const Sha256Kernel* GetSse4Sha256Kernel();
+const Sha256Kernel* GetAvx2Sha256Kernel();
+const Sha256Kernel* GetShaNiSha256Kernel();
+#endif
+
+constexpr std::uint32_t ReadBigEndian32(const std::uint8_t* data)
+{
+    return (static_cast<std::uint32_t>(data[0]) << 24)
+        | (static_cast<std::uint32_t>(data[1]) << 16)
+        | (static_cast<std::uint32_t>(data[2]) << 8)
+        | static_cast<std::uint32_t>(data[3]);
+}
+
+constexpr std::uint32_t ByteSwap32(std::uint32_t value)
+{
+    return (value >> 24)
+        | ((value >> 8) & 0x0000ff00u)
+        | ((value << 8) & 0x00ff0000u)
+        | (value << 24);
+}
+
+} // namespace detail
+
+} // namespace ash::crypto
+
+} // namespace ash
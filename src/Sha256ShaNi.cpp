@@ -0,0 +1,143 @@
+#include "Sha256.h"
+
+#ifdef ASH_SHA256_X86
+
+#include <cassert>
+
+#include <immintrin.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define ASH_TARGET_SHANI __attribute__((target("sha,sse4.1")))
+#else
+#define ASH_TARGET_SHANI
+#endif
+
+namespace ash
+{
+
+namespace crypto
+{
+
+namespace
+{
+
+// the SHA extensions keep the state as ABEF/CDGH register pairs and
+// run two rounds per sha256rnds2, the message schedule is four words
+// per register rotated through msg[0..3]
+ASH_TARGET_SHANI void CompressOneShaNi(Sha256State& state, const std::uint8_t* block)
+{
+    const auto shuffleMask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    auto temp = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&state.h[0]));
+    auto state1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&state.h[4]));
+
+    temp = _mm_shuffle_epi32(temp, 0xB1);           // CDAB
+    state1 = _mm_shuffle_epi32(state1, 0x1B);       // EFGH
+    auto state0 = _mm_alignr_epi8(temp, state1, 8); // ABEF
+    state1 = _mm_blend_epi16(state1, temp, 0xF0);   // CDGH
+
+    const auto saved0 = state0;
+    const auto saved1 = state1;
+
+    __m128i msg[4];
+    for (auto idx = 0u; idx < 4u; idx++)
+    {
+        msg[idx] = _mm_shuffle_epi8(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + (idx * 16))), shuffleMask);
+    }
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC unroll 16
+#endif
+    for (auto group = 0u; group < 16u; group++)
+    {
+        auto& current = msg[group & 3];
+        auto& next = msg[(group + 1) & 3];
+        auto& previous = msg[(group + 3) & 3];
+
+        auto words = _mm_add_epi32(current,
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(&SHA256_ROUND_CONSTANTS[group * 4])));
+        state1 = _mm_sha256rnds2_epu32(state1, state0, words);
+
+        if (group >= 3 && group <= 14)
+        {
+            next = _mm_add_epi32(next, _mm_alignr_epi8(current, previous, 4));
+            next = _mm_sha256msg2_epu32(next, current);
+        }
+
+        words = _mm_shuffle_epi32(words, 0x0E);
+        state0 = _mm_sha256rnds2_epu32(state0, state1, words);
+
+        if (group >= 1 && group <= 12)
+        {
+            previous = _mm_sha256msg1_epu32(previous, current);
+        }
+    }
+
+    state0 = _mm_add_epi32(state0, saved0);
+    state1 = _mm_add_epi32(state1, saved1);
+
+    temp = _mm_shuffle_epi32(state0, 0x1B);         // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xB1);       // DCHG
+    state0 = _mm_blend_epi16(temp, state1, 0xF0);   // DCBA
+    state1 = _mm_alignr_epi8(state1, temp, 8);      // ABEF
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state.h[0]), state0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state.h[4]), state1);
+}
+
+void CompressShaNi(Sha256State* states, const std::uint8_t* const* blocks, std::size_t count)
+{
+    for (auto idx = 0u; idx < count; idx++)
+    {
+        CompressOneShaNi(states[idx], blocks[idx]);
+    }
+}
+
+void HashNoncesShaNi(const Sha256State& midstate, const std::uint8_t* block,
+    std::size_t nonceOffset, std::uint64_t nonce, std::size_t count, Digest* out)
+{
+    assert(ValidSha256NonceOffset(nonceOffset));
+
+    alignas(16) std::uint8_t temp[SHA256_BLOCK_SIZE];
+    std::copy(block, block + SHA256_BLOCK_SIZE, temp);
+
+    for (auto idx = 0u; idx < count; idx++)
+    {
+        const auto current = nonce + idx;
+        for (auto byte = 0u; byte < 8u; byte++)
+        {
+            temp[nonceOffset + byte] = static_cast<std::uint8_t>(current >> (byte * 8));
+        }
+
+        auto state = midstate;
+        CompressOneShaNi(state, temp);
+        out[idx] = Sha256StateToDigest(state);
+    }
+}
+
+const Sha256Kernel ShaNiKernel
+{
+    "shani",
+    1u,
+    &CompressShaNi,
+    &HashNoncesShaNi
+};
+
+} // namespace
+
+namespace detail
+{
+
+const Sha256Kernel* GetShaNiSha256Kernel()
+{
+    return &ShaNiKernel;
+}
+
+} // namespace detail
+
+} // namespace ash::crypto
+
+} // namespace ash
+
+#endif // ASH_SHA256_X86
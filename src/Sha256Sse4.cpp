@@ -0,0 +1,234 @@
+#include "Sha256.h"
+
+#ifdef ASH_SHA256_X86
+
+#include <algorithm>
+#include <cassert>
+
+#include <immintrin.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define ASH_TARGET_SSE4 __attribute__((target("sse4.1")))
+#else
+#define ASH_TARGET_SSE4
+#endif
+
+namespace ash
+{
+
+namespace crypto
+{
+
+namespace
+{
+
+// four messages are hashed side by side, one per 32-bit lane
+constexpr std::size_t LANES = 4u;
+
+using Vec = __m128i;
+
+ASH_TARGET_SSE4 inline Vec Set1(std::uint32_t x) { return _mm_set1_epi32(static_cast<int>(x)); }
+ASH_TARGET_SSE4 inline Vec Add(Vec a, Vec b) { return _mm_add_epi32(a, b); }
+ASH_TARGET_SSE4 inline Vec Add(Vec a, Vec b, Vec c, Vec d) { return Add(Add(a, b), Add(c, d)); }
+ASH_TARGET_SSE4 inline Vec Xor(Vec a, Vec b, Vec c) { return _mm_xor_si128(_mm_xor_si128(a, b), c); }
+ASH_TARGET_SSE4 inline Vec Or(Vec a, Vec b) { return _mm_or_si128(a, b); }
+ASH_TARGET_SSE4 inline Vec And(Vec a, Vec b) { return _mm_and_si128(a, b); }
+
+template<int N>
+ASH_TARGET_SSE4 inline Vec Shr(Vec x) { return _mm_srli_epi32(x, N); }
+
+template<int N>
+ASH_TARGET_SSE4 inline Vec Rotr(Vec x) { return Or(_mm_srli_epi32(x, N), _mm_slli_epi32(x, 32 - N)); }
+
+ASH_TARGET_SSE4 inline Vec BigSigma0(Vec x) { return Xor(Rotr<2>(x), Rotr<13>(x), Rotr<22>(x)); }
+ASH_TARGET_SSE4 inline Vec BigSigma1(Vec x) { return Xor(Rotr<6>(x), Rotr<11>(x), Rotr<25>(x)); }
+ASH_TARGET_SSE4 inline Vec SmallSigma0(Vec x) { return Xor(Rotr<7>(x), Rotr<18>(x), Shr<3>(x)); }
+ASH_TARGET_SSE4 inline Vec SmallSigma1(Vec x) { return Xor(Rotr<17>(x), Rotr<19>(x), Shr<10>(x)); }
+
+ASH_TARGET_SSE4 inline Vec Ch(Vec e, Vec f, Vec g)
+{
+    return _mm_xor_si128(And(e, f), _mm_andnot_si128(e, g));
+}
+
+ASH_TARGET_SSE4 inline Vec Maj(Vec a, Vec b, Vec c)
+{
+    return Or(And(a, b), And(c, Or(a, b)));
+}
+
+// the message schedule is kept in a rolling window of 16 words
+ASH_TARGET_SSE4 void Transform(Vec* state, Vec* w)
+{
+    auto a = state[0];
+    auto b = state[1];
+    auto c = state[2];
+    auto d = state[3];
+    auto e = state[4];
+    auto f = state[5];
+    auto g = state[6];
+    auto h = state[7];
+
+    for (auto idx = 0u; idx < 64u; idx++)
+    {
+        if (idx >= 16)
+        {
+            w[idx & 15] = Add(w[idx & 15], SmallSigma0(w[(idx + 1) & 15]),
+                w[(idx + 9) & 15], SmallSigma1(w[(idx + 14) & 15]));
+        }
+
+        const auto t1 = Add(Add(h, BigSigma1(e), Ch(e, f, g), Set1(SHA256_ROUND_CONSTANTS[idx])), w[idx & 15]);
+        const auto t2 = Add(BigSigma0(a), Maj(a, b, c));
+
+        h = g;
+        g = f;
+        f = e;
+        e = Add(d, t1);
+        d = c;
+        c = b;
+        b = a;
+        a = Add(t1, t2);
+    }
+
+    state[0] = Add(state[0], a);
+    state[1] = Add(state[1], b);
+    state[2] = Add(state[2], c);
+    state[3] = Add(state[3], d);
+    state[4] = Add(state[4], e);
+    state[5] = Add(state[5], f);
+    state[6] = Add(state[6], g);
+    state[7] = Add(state[7], h);
+}
+
+ASH_TARGET_SSE4 void CompressSse4(Sha256State* states, const std::uint8_t* const* blocks, std::size_t count)
+{
+    for (std::size_t done = 0; done < count; done += LANES)
+    {
+        // short batches repeat the first message in the unused lanes
+        const auto used = std::min(LANES, count - done);
+        auto lane =
+            [done, used](std::size_t idx) { return done + (idx < used ? idx : 0); };
+
+        Vec state[8];
+        Vec w[16];
+        alignas(16) std::uint32_t values[LANES];
+
+        for (auto word = 0u; word < 8u; word++)
+        {
+            for (auto idx = 0u; idx < LANES; idx++)
+            {
+                values[idx] = states[lane(idx)].h[word];
+            }
+
+            state[word] = _mm_load_si128(reinterpret_cast<const Vec*>(values));
+        }
+
+        for (auto word = 0u; word < 16u; word++)
+        {
+            for (auto idx = 0u; idx < LANES; idx++)
+            {
+                values[idx] = detail::ReadBigEndian32(blocks[lane(idx)] + (word * 4));
+            }
+
+            w[word] = _mm_load_si128(reinterpret_cast<const Vec*>(values));
+        }
+
+        Transform(state, w);
+
+        for (auto word = 0u; word < 8u; word++)
+        {
+            _mm_store_si128(reinterpret_cast<Vec*>(values), state[word]);
+            for (auto idx = 0u; idx < used; idx++)
+            {
+                states[done + idx].h[word] = values[idx];
+            }
+        }
+    }
+}
+
+ASH_TARGET_SSE4 void HashNoncesSse4(const Sha256State& midstate, const std::uint8_t* block,
+    std::size_t nonceOffset, std::uint64_t nonce, std::size_t count, Digest* out)
+{
+    assert(ValidSha256NonceOffset(nonceOffset));
+
+    std::uint32_t words[16];
+    for (auto word = 0u; word < 16u; word++)
+    {
+        words[word] = detail::ReadBigEndian32(block + (word * 4));
+    }
+
+    const auto nonceWord = nonceOffset / 4;
+
+    for (std::size_t done = 0; done < count; done += LANES)
+    {
+        Vec state[8];
+        Vec w[16];
+
+        for (auto word = 0u; word < 8u; word++)
+        {
+            state[word] = Set1(midstate.h[word]);
+        }
+
+        for (auto word = 0u; word < 16u; word++)
+        {
+            w[word] = Set1(words[word]);
+        }
+
+        // the little endian nonce read as two big endian words
+        alignas(16) std::uint32_t low[LANES];
+        alignas(16) std::uint32_t high[LANES];
+        for (auto idx = 0u; idx < LANES; idx++)
+        {
+            const auto current = nonce + done + idx;
+            low[idx] = detail::ByteSwap32(static_cast<std::uint32_t>(current));
+            high[idx] = detail::ByteSwap32(static_cast<std::uint32_t>(current >> 32));
+        }
+
+        w[nonceWord] = _mm_load_si128(reinterpret_cast<const Vec*>(low));
+        w[nonceWord + 1] = _mm_load_si128(reinterpret_cast<const Vec*>(high));
+
+        Transform(state, w);
+
+        alignas(16) std::uint32_t values[8][LANES];
+        for (auto word = 0u; word < 8u; word++)
+        {
+            _mm_store_si128(reinterpret_cast<Vec*>(values[word]), state[word]);
+        }
+
+        const auto used = std::min(LANES, count - done);
+        for (auto idx = 0u; idx < used; idx++)
+        {
+            Sha256State result;
+            for (auto word = 0u; word < 8u; word++)
+            {
+                result.h[word] = values[word][idx];
+            }
+
+            out[done + idx] = Sha256StateToDigest(result);
+        }
+    }
+}
+
+const Sha256Kernel Sse4Kernel
+{
+    "sse4",
+    LANES,
+    &CompressSse4,
+    &HashNoncesSse4
+};
+
+} // namespace
+
+namespace detail
+{
+
+const Sha256Kernel* GetSse4Sha256Kernel()
+{
+    return &Sse4Kernel;
+}
+
+} // namespace detail
+
+} // namespace ash::crypto
+
+} // namespace ash
+
+#endif // ASH_SHA256_X86
@@ -0,0 +1,82 @@
+#include "HashWriter.h"
+#include "SignatureCache.h"
+
+namespace ash
+{
+
+SignatureCache::SignatureCache(std::size_t capacity)
+    : _capacity{ capacity }
+{
+    // nothing to do
+}
+
+crypto::Digest SignatureCache::MakeKey(const crypto::Digest& sighash, std::size_t inputIndex,
+    const Address& address, std::string_view signature)
+{
+    crypto::HashWriter writer{ crypto::HashWriter::Mode::BINARY };
+    writer.bytes(sighash.data(), sighash.size());
+    writer << static_cast<std::uint64_t>(inputIndex);
+    writer.bytes(address.data(), Address::SIZE);
+    writer << signature;
+    return writer.digest();
+}
+
+bool SignatureCache::contains(const crypto::Digest& key) const
+{
+    std::lock_guard<std::mutex> lock{ _mutex };
+    return _entries.find(key) != _entries.end();
+}
+
+void SignatureCache::insert(const crypto::Digest& key)
+{
+    std::lock_guard<std::mutex> lock{ _mutex };
+    if (_capacity == 0 || !_entries.insert(key).second)
+    {
+        return;
+    }
+
+    _order.push_back(key);
+    while (_order.size() > _capacity)
+    {
+        _entries.erase(_order.front());
+        _order.pop_front();
+    }
+}
+
+std::size_t SignatureCache::size() const
+{
+    std::lock_guard<std::mutex> lock{ _mutex };
+    return _entries.size();
+}
+
+std::size_t SignatureCache::capacity() const
+{
+    std::lock_guard<std::mutex> lock{ _mutex };
+    return _capacity;
+}
+
+void SignatureCache::setCapacity(std::size_t capacity)
+{
+    std::lock_guard<std::mutex> lock{ _mutex };
+    _capacity = capacity;
+    while (_order.size() > _capacity)
+    {
+        _entries.erase(_order.front());
+        _order.pop_front();
+    }
+}
+
+void SignatureCache::clear()
+{
+    std::lock_guard<std::mutex> lock{ _mutex };
+    _entries.clear();
+    _order.clear();
+}
+
+SignatureCache& GetSignatureCache()
+{
+    static SignatureCache cache;
+    return cache;
+}
+
+} // namespace ash
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string_view>
+#include <unordered_set>
+
+#include "CryptoUtils.h"
+
+namespace ash
+{
+
+// the default number of verified signatures that are remembered
+constexpr std::size_t DefaultSignatureCacheSize = 100000;
+
+//! Signatures that were already verified, so a transaction that was
+//  checked when it was queued is not verified again when its block
+//  arrives. Once full the oldest entries are dropped first. Lookups
+//  and inserts can run on any number of threads
+class SignatureCache final
+{
+    // the keys are SHA-256 digests so any 8 of their bytes hash well
+    struct KeyHash
+    {
+        std::size_t operator()(const crypto::Digest& key) const noexcept
+        {
+            std::size_t retval;
+            std::memcpy(&retval, key.data(), sizeof(retval));
+            return retval;
+        }
+    };
+
+    mutable std::mutex                                  _mutex;
+    std::unordered_set<crypto::Digest, KeyHash>         _entries;
+    std::deque<crypto::Digest>                          _order;     // oldest first
+    std::size_t                                         _capacity;
+
+public:
+    explicit SignatureCache(std::size_t capacity = DefaultSignatureCacheSize);
+
+    // the transaction's id changes with the block it is mined in, so
+    // an entry is keyed by everything the verification looked at: the
+    // signature hash, the input, the address of the output it spends
+    // and the signature itself
+    static crypto::Digest MakeKey(const crypto::Digest& sighash, std::size_t inputIndex,
+        const Address& address, std::string_view signature);
+
+    bool contains(const crypto::Digest& key) const;
+    void insert(const crypto::Digest& key);
+
+    std::size_t size() const;
+
+    std::size_t capacity() const;
+
+    // a capacity of 0 disables the cache
+    void setCapacity(std::size_t capacity);
+
+    void clear();
+};
+
+// the cache shared by the chain and the transaction queue
+SignatureCache& GetSignatureCache();
+
+} // namespace ash
@@ -0,0 +1,215 @@
+#include <iterator>
+#include <unordered_set>
+
+#include "TemplateBuilder.h"
+
+namespace ash
+{
+
+namespace
+{
+
+using OutPointSet = std::unordered_set<TxOutPoint, std::hash<TxOutPoint>, TxOutPointEqual>;
+
+// a wallet only looks at the chain, so two queued transactions can
+// spend the same output and a block with both would be rejected.
+// The inputs are added to `spent` if the transaction can be mined
+bool CanSpend(const UtxoSet& unspent, const Transaction& tx, OutPointSet& spent)
+{
+    const auto& txins = tx.txIns();
+    for (auto idx = 0u; idx < txins.size(); idx++)
+    {
+        const auto& point = txins[idx].txOutPt();
+        if (unspent.find(point) == nullptr || !spent.insert(point).second)
+        {
+            for (auto undo = 0u; undo < idx; undo++)
+            {
+                spent.erase(txins[undo].txOutPt());
+            }
+
+            return false;
+        }
+    }
+
+    return true;
+}
+
+OutPointSet SpentOutputs(const Transactions& txs)
+{
+    OutPointSet retval;
+    for (const auto& tx : txs)
+    {
+        if (!tx.isCoinbase())
+        {
+            for (const auto& txin : tx.txIns())
+            {
+                retval.insert(txin.txOutPt());
+            }
+        }
+    }
+
+    return retval;
+}
+
+} // namespace
+
+TemplateBuilder::TemplateBuilder(const Address& rewardAddress, std::string_view minerId)
+    : _rewardAddress{ rewardAddress },
+      _minerId{ minerId },
+      _logger(ash::initializeLogger("TemplateBuilder"))
+{
+    // nothing to do
+}
+
+BlockTemplate TemplateBuilder::build(Blockchain& chain) const
+{
+    auto retval = prebuild(chain, chain.size());
+    [[maybe_unused]] const auto linked = finish(chain, retval);
+    assert(linked);
+    return retval;
+}
+
+BlockTemplate TemplateBuilder::prebuild(Blockchain& chain, std::uint64_t index) const
+{
+    ash::Transactions txs;
+    txs.push_back(ash::CreateCoinbaseTransaction(index, _rewardAddress));
+
+    BlockTemplate retval;
+    retval.block = std::make_unique<Block>(index, Hash256{}, std::move(txs));
+    retval.block->setMiner(_minerId);
+    retval.block->setData(fmt::format("coinbase block #{}", index));
+    retval.tree = MerkleTree{ retval.block->transactions() };
+
+    addTransactions(chain, retval, chain.dequeueTransactions(index));
+    retval.commitment = CalculateBlockCommitment(retval.block->data(), retval.tree.root());
+
+    _logger->trace("prebuilt template for block #{} with {} transaction(s)",
+        index, retval.block->transactions().size());
+
+    return retval;
+}
+
+bool TemplateBuilder::finish(Blockchain& chain, BlockTemplate& tmpl) const
+{
+    assert(tmpl.block);
+    auto& block = *tmpl.block;
+
+    if (chain.size() == 0 || block.index() != chain.size())
+    {
+        return false;
+    }
+
+    block.setPreviousHash(chain.back().hash());
+
+    // the blocks added since the template was built may have spent
+    // the same outputs as some of its transactions
+    bool changed = false;
+    if (auto& txs = block.transactions(); txs.size() > 1)
+    {
+        const auto& unspent = chain.unspentOutputs();
+
+        OutPointSet spent;
+        Transactions kept;
+        kept.reserve(txs.size());
+
+        for (auto& tx : txs)
+        {
+            if (kept.empty() || CanSpend(unspent, tx, spent))
+            {
+                kept.push_back(std::move(tx));
+            }
+            else
+            {
+                _logger->warn("dropped transaction {} from the template for block #{}, its inputs were spent",
+                    tx.id(), block.index());
+            }
+        }
+
+        const auto dropped = txs.size() - kept.size();
+        txs = std::move(kept);
+
+        if (dropped > 0)
+        {
+            tmpl.tree = MerkleTree{ txs };
+            changed = true;
+        }
+    }
+
+    // the previous hash is not part of the commitment so it
+    // only changes when the transactions do
+    if (auto late = chain.dequeueTransactions(block.index()); !late.empty())
+    {
+        const auto count = addTransactions(chain, tmpl, std::move(late));
+        changed = changed || count > 0;
+
+        _logger->trace("added {} late transaction(s) to the template for block #{}",
+            count, block.index());
+    }
+
+    if (changed)
+    {
+        tmpl.commitment = CalculateBlockCommitment(block.data(), tmpl.tree.root());
+    }
+
+    return true;
+}
+
+bool TemplateBuilder::refresh(Blockchain& chain, BlockTemplate& tmpl) const
+{
+    assert(tmpl.block);
+    auto& block = *tmpl.block;
+
+    auto late = chain.dequeueTransactions(block.index());
+    if (late.empty())
+    {
+        return false;
+    }
+
+    const auto count = addTransactions(chain, tmpl, std::move(late));
+    if (count == 0)
+    {
+        return false;
+    }
+
+    // every refresh of the template gets its own coinbase
+    auto& coinbase = block.transactions().front();
+    assert(coinbase.isCoinbase());
+    coinbase.setExtraNonce(coinbase.extraNonce() + 1);
+    coinbase.calcuateId(block.index());
+    tmpl.tree.update(0, coinbase.hash());
+
+    tmpl.commitment = CalculateBlockCommitment(block.data(), tmpl.tree.root());
+
+    _logger->debug("added {} transaction(s) to block #{} while mining, extranonce={}",
+        count, block.index(), coinbase.extraNonce());
+
+    return true;
+}
+
+std::size_t TemplateBuilder::addTransactions(const Blockchain& chain, BlockTemplate& tmpl, Transactions&& txs) const
+{
+    auto& block = *tmpl.block;
+    const auto& unspent = chain.unspentOutputs();
+    auto spent = SpentOutputs(block.transactions());
+
+    std::size_t retval = 0;
+    for (auto& tx : txs)
+    {
+        if (!CanSpend(unspent, tx, spent))
+        {
+            _logger->warn("dropped transaction {} from the template for block #{}, it spends an output that is missing or already spent",
+                tx.id(), block.index());
+
+            continue;
+        }
+
+        // each transaction only rehashes its path to the root
+        tmpl.tree.append(tx.hash());
+        block.transactions().push_back(std::move(tx));
+        retval++;
+    }
+
+    return retval;
+}
+
+} // namespace ash
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <optional>
+#include <string>
+
+#include "AshLogger.h"
+#include "Block.h"
+#include "BlockHeader.h"
+#include "Blockchain.h"
+#include "MerkleTree.h"
+
+namespace ash
+{
+
+//! An unmined block along with the commitment to its data and
+//  transactions, which is the expensive part of starting to mine it.
+//  The merkle tree is kept so transactions can be added cheaply
+struct BlockTemplate
+{
+    BlockUniquePtr      block;
+    MerkleTree          tree;
+    BlockCommitment     commitment;
+};
+
+//! Builds the blocks that this node mines. The template of the next
+//  block is built while the current one is being mined, everything
+//  but the previous block's hash is known ahead of time so switching
+//  to it once the current block is solved only fills in that hash
+class TemplateBuilder final
+{
+    Address         _rewardAddress;
+    std::string     _minerId;
+    SpdLogPtr       _logger;
+
+    // appends the transactions that spend outputs the chain left
+    // unspent and the template does not already spend, the others
+    // are dropped. Returns how many were added
+    std::size_t addTransactions(const Blockchain& chain, BlockTemplate& tmpl, Transactions&& txs) const;
+
+public:
+    TemplateBuilder(const Address& rewardAddress, std::string_view minerId);
+
+    // the template of the block after the chain's tip
+    BlockTemplate build(Blockchain& chain) const;
+
+    // the template of block `index` without a previous hash, this
+    // takes the chain's queued transactions
+    BlockTemplate prebuild(Blockchain& chain, std::uint64_t index) const;
+
+    // links a prebuilt template to the chain's tip and adds any
+    // transactions queued since it was built, transactions spending
+    // outputs the new tip spent are dropped. Returns false if the
+    // template is not for the block after the tip, in which case the
+    // caller should requeue its transactions and build a new one
+    bool finish(Blockchain& chain, BlockTemplate& tmpl) const;
+
+    // adds the transactions queued since the template was built to a
+    // template that is being mined and bumps its coinbase's extra
+    // nonce. Returns false if nothing was queued
+    bool refresh(Blockchain& chain, BlockTemplate& tmpl) const;
+};
+
+} // namespace ash
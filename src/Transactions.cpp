@@ -1,5 +1,7 @@
 #include <nlohmann/json.hpp>
 
+#include "BinaryCodec.h"
+#include "HashWriter.h"
 #include "Transactions.h"
 
 #include <cryptopp/sha.h>
@@ -61,6 +63,11 @@ void to_json(nl::json& j, const Transaction& tx)
     j["id"] = tx.id();
     j["inputs"] = tx.txIns();
     j["outputs"] = tx.txOuts();
+
+    if (tx.extraNonce() != 0)
+    {
+        j["extranonce"] = tx.extraNonce();
+    }
 }
 
 void to_json(nl::json& j, const Transactions& txs)
@@ -79,7 +86,7 @@ void from_json(const nl::json& j, TxOutPoint& pt)
 
     if (j.contains("address"))
     {
-        pt.address = j["address"].get<std::string>();
+        pt.address = j["address"].get<Address>();
     }
 
     if (j.contains("amount"))
@@ -125,6 +132,11 @@ void from_json(const nl::json& j, Transaction& tx)
     j["id"].get_to(tx._id);
     j["inputs"].get_to(tx._txIns);
     j["outputs"].get_to(tx._txOuts);
+
+    if (j.contains("extranonce"))
+    {
+        j["extranonce"].get_to(tx._extraNonce);
+    }
 }
 
 void from_json(const nl::json& j, Transactions& txs)
@@ -155,35 +167,33 @@ void from_json(const nl::json& j, UnspentTxOuts& outs)
     }
 }
 
-std::string GetTransactionId(const Transaction& tx, std::uint64_t blockid)
+Hash256 GetTransactionId(const Transaction& tx, std::uint64_t blockid)
 {
-    std::stringstream ss;
+    crypto::HashWriter writer{ crypto::HashWriter::Mode::COMPAT };
     for (const auto& txin : tx.txIns())
     {
-        ss << txin.txOutPt().blockIndex
+        writer << txin.txOutPt().blockIndex
             << txin.txOutPt().txIndex
             << txin.txOutPt().txOutIndex;
     }
 
     for (const auto& txout : tx.txOuts())
     {
-        ss << txout.address() << txout.amount();
+        writer << txout.address() << txout.amount();
     }
 
-    ss << blockid;
-
-    std::string digest;
-    CryptoPP::SHA256 hash;
+    writer << blockid;
 
-    CryptoPP::StringSource src(ss.str(), true,
-        new CryptoPP::HashFilter(hash,
-            new CryptoPP::HexEncoder(
-                new CryptoPP::StringSink(digest), false)));
+    // left out when unset so the ids of older transactions hold
+    if (tx.extraNonce() != 0)
+    {
+        writer << tx.extraNonce();
+    }
 
-    return digest;
+    return Hash256{ writer.digest() };
 }
 
-Transaction CreateCoinbaseTransaction(std::uint64_t blockIdx, std::string_view address)
+Transaction CreateCoinbaseTransaction(std::uint64_t blockIdx, const Address& address)
 {
     Transaction tx;
     tx.txIns().emplace_back(blockIdx, 0, 0);
@@ -197,4 +207,51 @@ void Transaction::calcuateId(std::uint64_t blockid)
     _id = ash::GetTransactionId(*this, blockid);
 }
 
+TxHash CalculateTransactionHash(const Transaction& tx)
+{
+    // reused so hashing a block's transactions allocates once
+    thread_local codec::Buffer buffer;
+    buffer.clear();
+
+    codec::Writer writer{ buffer };
+    write_data(writer, tx);
+
+    TxHash retval;
+    CryptoPP::SHA256().CalculateDigest(retval.data(), buffer.data(), buffer.size());
+    return retval;
+}
+
+TxHash CalculateSignatureHash(const Transaction& tx)
+{
+    crypto::HashWriter writer{ crypto::HashWriter::Mode::BINARY };
+
+    writer << static_cast<std::uint64_t>(tx.txIns().size());
+    for (const auto& txin : tx.txIns())
+    {
+        writer << txin.txOutPt().blockIndex
+            << txin.txOutPt().txIndex
+            << txin.txOutPt().txOutIndex;
+    }
+
+    writer << static_cast<std::uint64_t>(tx.txOuts().size());
+    for (const auto& txout : tx.txOuts())
+    {
+        writer << txout.address() << txout.amount();
+    }
+
+    return writer.digest();
+}
+
+void SignTransaction(Transaction& tx, std::string_view privateKey)
+{
+    // every input is signed by the same key so the signature is shared
+    const auto signature = crypto::GetPublicKey(privateKey)
+        + crypto::SignDigest(privateKey, CalculateSignatureHash(tx));
+
+    for (auto& txin : tx.txIns())
+    {
+        txin.setSignature(signature);
+    }
+}
+
 } // namespace ash
@@ -1,4 +1,6 @@
 #pragma once
+#include <array>
+#include <optional>
 #include <string>
 #include <vector>
 #include <sstream>
@@ -10,6 +12,9 @@
 
 #include <nlohmann/json.hpp>
 
+#include "Address.h"
+#include "Hash256.h"
+
 namespace nl = nlohmann;
 
 namespace ash
@@ -26,6 +31,12 @@ class TxIn;
 class TxOut;
 class Transaction;
 
+namespace codec
+{
+class Reader;
+class Writer;
+}
+
 struct TxOutPoint;
 using UnspentTxOut = TxOutPoint;
 
@@ -34,6 +45,9 @@ using TxOuts = std::vector<TxOut>;
 using Transactions = std::vector<Transaction>;
 using UnspentTxOuts = std::vector<UnspentTxOut>;
 
+// raw SHA-256 of a transaction, the leaves of a block's merkle tree
+using TxHash = std::array<std::uint8_t, 32>;
+
 void to_json(nl::json& j, const Transaction& tx);
 void from_json(const nl::json& j, Transaction& tx);
 
@@ -115,7 +129,28 @@ public:
     }
 };
 
-Transaction CreateCoinbaseTransaction(std::uint64_t blockIdx, std::string_view address);
+Transaction CreateCoinbaseTransaction(std::uint64_t blockIdx, const Address& address);
+
+// the id of `tx` when it is mined into the block at `blockid`
+Hash256 GetTransactionId(const Transaction& tx, std::uint64_t blockid);
+
+// SHA-256 of the transaction's codec encoding, see write_data()
+// and Transaction::hash()
+TxHash CalculateTransactionHash(const Transaction& tx);
+
+// an input's signature is the uncompressed public key of the address
+// that owns the spent output followed by the signature of the
+// transaction's signature hash, both in lowercase hex
+constexpr std::size_t PublicKeyHexSize = 130;
+
+// SHA-256 of the outputs the transaction spends and of its outputs.
+// The id is left out since it depends on the block the transaction
+// is mined in, and so are the signatures themselves
+TxHash CalculateSignatureHash(const Transaction& tx);
+
+// signs every input with the key of the address that owns
+// the outputs the transaction spends
+void SignTransaction(Transaction& tx, std::string_view privateKey);
 
 struct TxOutPoint
 {
@@ -123,7 +158,7 @@ struct TxOutPoint
     std::uint64_t   txIndex;       // the transaction id inside the block
     std::uint64_t   txOutIndex;    // the index of the TxOut inside the transaction
 
-    std::optional<std::string>  address;
+    std::optional<Address>      address;
     std::optional<double>       amount;
 };
 
@@ -132,7 +167,8 @@ class TxIn final
     TxOutPoint      _txOutPt;    
     std::string     _signature;
 
-    friend void read_data(std::istream& stream, TxIn& txin);
+    friend void read_data(codec::Reader& reader, TxIn& txin);
+    friend void write_data(codec::Writer& writer, const TxIn& txin);
     friend void from_json(const nl::json& j, TxIn& txin);
 
 public:
@@ -154,7 +190,8 @@ public:
     TxOutPoint& txOutPt() { return _txOutPt; }
     const TxOutPoint& txOutPt() const noexcept { return _txOutPt; }
 
-    std::string signature() const { return _signature; }
+    const std::string& signature() const noexcept { return _signature; }
+    void setSignature(std::string_view val) { _signature = val; }
 };
 
 } // ash
@@ -194,20 +231,21 @@ class TxOut final
 public:
 
     TxOut() = default;
-    TxOut(std::string_view address, double amount)
+    TxOut(const Address& address, double amount)
         : _address{address}, _amount{amount}
     {
         // nothing to do
     }
 
-    std::string address() const { return _address; }
+    const Address& address() const noexcept { return _address; }
     double amount() const noexcept { return _amount; }
 
 private:
-    friend void read_data(std::istream& stream, TxOut& txout);
+    friend void read_data(codec::Reader& reader, TxOut& txout);
+    friend void write_data(codec::Writer& writer, const TxOut& txout);
     friend void from_json(const nl::json& j, TxOut& txout);
 
-    std::string _address;   // public-key/address of receiver
+    Address     _address;   // public-key/address of receiver
     double      _amount;
 
 };
@@ -221,7 +259,7 @@ namespace std
         std::size_t operator()(const ash::TxOut& txout) const noexcept
         {
             std::size_t seed = 0;
-            boost::hash_combine(seed, std::hash<std::string>{}(txout.address()));
+            boost::hash_combine(seed, std::hash<ash::Address>{}(txout.address()));
             boost::hash_combine(seed, std::hash<double>{}(txout.amount()));
             return seed;
         }
@@ -233,19 +271,38 @@ namespace ash
 
 class Transaction final
 {
-    std::string _id;
-    TxIns       _txIns;
-    TxOuts      _txOuts;
+    Hash256         _id;
+    TxIns           _txIns;
+    TxOuts          _txOuts;
+    std::uint64_t   _extraNonce = 0;    // only used by coinbase transactions
 
-    friend Transaction CreateCoinbaseTransaction(std::uint64_t blockIdx, std::string_view address);
+    friend Transaction CreateCoinbaseTransaction(std::uint64_t blockIdx, const Address& address);
     friend void from_json(const nl::json& j, Transaction& tx);
-    friend void read_data(std::istream& stream, Transaction& tx);
+    friend void read_data(codec::Reader& reader, Transaction& tx, std::uint32_t version);
+    friend void write_data(codec::Writer& writer, const Transaction& tx);
 
 public:
 
-    std::string id() const { return _id; }
+    const Hash256& id() const noexcept { return _id; }
     void calcuateId(std::uint64_t blockid);
 
+    // computed on every call, txIns() and txOuts() hand out references
+    // a copy could go stale through. The template keeps the hashes it
+    // reuses in its MerkleTree
+    TxHash hash() const
+    {
+        return CalculateTransactionHash(*this);
+    }
+
+    // changing a coinbase's extra nonce gives the block a new header
+    // without touching the other transactions, the id must be
+    // recalculated afterwards
+    std::uint64_t extraNonce() const noexcept { return _extraNonce; }
+    void setExtraNonce(std::uint64_t val)
+    {
+        _extraNonce = val;
+    }
+
     const TxIns& txIns() const { return _txIns; }
     TxIns& txIns()
     {
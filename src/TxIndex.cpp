@@ -0,0 +1,48 @@
+#include "TxIndex.h"
+
+namespace ash
+{
+
+std::optional<TxPoint> TxIndex::find(const Hash256& txid) const
+{
+    if (const auto it = _points.find(txid); it != _points.end())
+    {
+        return it->second;
+    }
+
+    return {};
+}
+
+std::size_t TxIndex::size() const noexcept
+{
+    return _points.size();
+}
+
+void TxIndex::connect(const Block& block)
+{
+    const auto& txs = block.transactions();
+    for (auto txidx = 0u; txidx < txs.size(); txidx++)
+    {
+        _points.emplace(txs[txidx].id(), TxPoint{ block.index(), txidx });
+    }
+}
+
+void TxIndex::disconnect(const Block& block)
+{
+    for (const auto& tx : block.transactions())
+    {
+        // only if this block's transaction is the one that was indexed
+        if (const auto it = _points.find(tx.id());
+            it != _points.end() && std::get<0>(it->second) == block.index())
+        {
+            _points.erase(it);
+        }
+    }
+}
+
+void TxIndex::clear()
+{
+    _points.clear();
+}
+
+} // namespace ash
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <tuple>
+#include <unordered_map>
+
+#include "Block.h"
+#include "Hash256.h"
+
+namespace ash
+{
+
+// 0 - block index, 1 - tx index
+using TxPoint = std::tuple<std::uint64_t, std::uint64_t>;
+
+//! Where each transaction of a chain is, by its id. Lookups can run
+//  on any number of threads as long as no block is connected at the
+//  same time
+class TxIndex final
+{
+    std::unordered_map<Hash256, TxPoint>    _points;
+
+public:
+    std::optional<TxPoint> find(const Hash256& txid) const;
+
+    std::size_t size() const noexcept;
+
+    // adds the block's transactions, an id that is already in the
+    // index keeps the earlier position
+    void connect(const Block& block);
+
+    // undoes connect() for the last block that was connected
+    void disconnect(const Block& block);
+
+    void clear();
+};
+
+} // namespace ash
@@ -0,0 +1,445 @@
+#include <cmath>
+#include <limits>
+#include <optional>
+#include <unordered_set>
+
+#include "Blockchain.h"
+#include "FirstFailure.h"
+#include "SignatureCache.h"
+#include "TxValidation.h"
+
+namespace ash
+{
+
+namespace
+{
+
+// transactions are claimed by the workers this many at a time
+constexpr std::size_t TxValidationBatchSize = 64;
+
+std::uint64_t signatureHeight = std::numeric_limits<std::uint64_t>::max();
+std::uint64_t spendingHeight = std::numeric_limits<std::uint64_t>::max();
+
+TxValidationResult Reject(TxRejectReason reason, std::size_t txidx, std::size_t txinidx, std::string detail)
+{
+    return { reason, txidx, txinidx, std::move(detail) };
+}
+
+std::string PointText(const TxOutPoint& point)
+{
+    return fmt::format("{}:{}:{}", point.blockIndex, point.txIndex, point.txOutIndex);
+}
+
+// an output that is in the chain, spent or not
+const TxOut* FindChainOutput(const Blockchain& chain, const TxOutPoint& point)
+{
+    if (point.blockIndex >= chain.size())
+    {
+        return nullptr;
+    }
+
+    const auto& txs = chain.at(point.blockIndex).transactions();
+    if (point.txIndex >= txs.size()
+        || point.txOutIndex >= txs[point.txIndex].txOuts().size())
+    {
+        return nullptr;
+    }
+
+    return &(txs[point.txIndex].txOuts()[point.txOutIndex]);
+}
+
+TxValidationResult CheckShape(const Transaction& tx, std::size_t txidx)
+{
+    if (tx.txIns().empty())
+    {
+        return Reject(TxRejectReason::TXINS_EMPTY, txidx, 0, "transaction has no inputs");
+    }
+    else if (tx.txOuts().empty())
+    {
+        return Reject(TxRejectReason::TXOUTS_EMPTY, txidx, 0, "transaction has no outputs");
+    }
+
+    return {};
+}
+
+TxValidationResult SumOutputs(const Transaction& tx, std::size_t txidx, double& total)
+{
+    total = 0;
+    for (const auto& txout : tx.txOuts())
+    {
+        if (!std::isfinite(txout.amount()) || txout.amount() <= 0)
+        {
+            return Reject(TxRejectReason::BAD_AMOUNT, txidx, 0,
+                fmt::format("output amount {} is not positive", txout.amount()));
+        }
+
+        total += txout.amount();
+    }
+
+    return {};
+}
+
+// an input that spends an output of an earlier block, `spent`
+// is set if the output is still unspent
+TxValidationResult FindUnspent(const Blockchain& chain, const UtxoSet& unspent,
+    const TxOutPoint& point, std::size_t txidx, std::size_t inidx, const TxOut*& spent)
+{
+    spent = unspent.find(point);
+    if (spent != nullptr)
+    {
+        return {};
+    }
+    else if (FindChainOutput(chain, point) != nullptr)
+    {
+        return Reject(TxRejectReason::SPENT_OUTPUT, txidx, inidx,
+            fmt::format("output {} was already spent", PointText(point)));
+    }
+
+    return Reject(TxRejectReason::MISSING_OUTPUT, txidx, inidx,
+        fmt::format("output {} does not exist", PointText(point)));
+}
+
+// the input must be signed by the key of the address that owns the
+// output it spends. Signatures in the cache were verified before
+TxValidationResult CheckSignature(const Transaction& tx, const TxHash& sighash,
+    std::size_t txidx, std::size_t inidx, const TxOut& spent)
+{
+    auto& cache = GetSignatureCache();
+
+    const auto& signature = tx.txIns()[inidx].signature();
+    const auto key = SignatureCache::MakeKey(sighash, inidx, spent.address(), signature);
+    if (cache.contains(key))
+    {
+        return {};
+    }
+
+    if (signature.size() <= PublicKeyHexSize)
+    {
+        return Reject(TxRejectReason::BAD_SIGNATURE, txidx, inidx, "signature is malformed");
+    }
+
+    const auto publicKey = std::string_view{ signature }.substr(0, PublicKeyHexSize);
+    if (crypto::GetAddressFromPublicKey(publicKey) != spent.address())
+    {
+        return Reject(TxRejectReason::WRONG_KEY, txidx, inidx,
+            fmt::format("signing key does not belong to {}", spent.address()));
+    }
+
+    if (!crypto::VerifyDigest(publicKey, sighash, std::string_view{ signature }.substr(PublicKeyHexSize)))
+    {
+        return Reject(TxRejectReason::BAD_SIGNATURE, txidx, inidx, "signature does not match the transaction");
+    }
+
+    cache.insert(key);
+    return {};
+}
+
+// the checks that only need the transaction, the unspent outputs
+// of the chain and the transactions before it in the block
+TxValidationResult CheckTransaction(const Blockchain& chain, const UtxoSet& unspent,
+    const Block& block, std::size_t txidx)
+{
+    const auto& txs = block.transactions();
+    const auto& tx = txs[txidx];
+
+    if (auto result = CheckShape(tx, txidx); !result.valid())
+    {
+        return result;
+    }
+    else if (txidx == 0 && !tx.isCoinbase())
+    {
+        return Reject(TxRejectReason::MISSING_COINBASE, txidx, 0, "first transaction is not a coinbase");
+    }
+    else if (txidx > 0 && tx.isCoinbase())
+    {
+        return Reject(TxRejectReason::EXTRA_COINBASE, txidx, 0, "coinbase after the first transaction");
+    }
+
+    if (tx.id() != GetTransactionId(tx, block.index()))
+    {
+        return Reject(TxRejectReason::BAD_TXID, txidx, 0,
+            fmt::format("id '{}' does not match the transaction", tx.id()));
+    }
+
+    // blocks below the spending height were mined before inputs had to
+    // spend unspent outputs, only their coinbase pays a checked amount
+    const bool spending = block.index() >= spendingHeight;
+
+    double outputs = 0;
+    if (txidx == 0 || spending)
+    {
+        if (auto result = SumOutputs(tx, txidx, outputs); !result.valid())
+        {
+            return result;
+        }
+    }
+
+    if (txidx == 0)
+    {
+        if (tx.txIns().size() != 1 || tx.txIns().front().txOutPt().blockIndex != block.index())
+        {
+            return Reject(TxRejectReason::BAD_COINBASE, txidx, 0,
+                fmt::format("coinbase input is not for block #{}", block.index()));
+        }
+        else if (outputs > COINBASE_REWARD + AmountTolerance)
+        {
+            return Reject(TxRejectReason::BAD_COINBASE, txidx, 0,
+                fmt::format("coinbase pays {}, more than the reward of {}", outputs, COINBASE_REWARD));
+        }
+
+        return {};
+    }
+
+    std::optional<TxHash> sighash;
+    if (block.index() >= signatureHeight)
+    {
+        sighash = CalculateSignatureHash(tx);
+    }
+    else if (!spending)
+    {
+        return {};
+    }
+
+    double inputs = 0;
+    for (auto inidx = 0u; inidx < tx.txIns().size(); inidx++)
+    {
+        const auto& point = tx.txIns()[inidx].txOutPt();
+
+        const TxOut* spent = nullptr;
+        if (point.blockIndex == block.index())
+        {
+            // outputs of earlier transactions in the same block
+            if (point.txIndex < txidx
+                && point.txOutIndex < txs[point.txIndex].txOuts().size())
+            {
+                spent = &(txs[point.txIndex].txOuts()[point.txOutIndex]);
+            }
+            else
+            {
+                return Reject(TxRejectReason::MISSING_OUTPUT, txidx, inidx,
+                    fmt::format("output {} does not exist", PointText(point)));
+            }
+        }
+        else if (!spending)
+        {
+            // the output only has to exist so its owner's key can be checked
+            spent = FindChainOutput(chain, point);
+            if (spent == nullptr)
+            {
+                return Reject(TxRejectReason::MISSING_OUTPUT, txidx, inidx,
+                    fmt::format("output {} does not exist", PointText(point)));
+            }
+        }
+        else if (auto result = FindUnspent(chain, unspent, point, txidx, inidx, spent); !result.valid())
+        {
+            return result;
+        }
+
+        if (sighash.has_value())
+        {
+            if (auto result = CheckSignature(tx, *sighash, txidx, inidx, *spent); !result.valid())
+            {
+                return result;
+            }
+        }
+
+        inputs += spent->amount();
+    }
+
+    if (spending && outputs > inputs + AmountTolerance)
+    {
+        return Reject(TxRejectReason::INSUFFICIENT_INPUTS, txidx, 0,
+            fmt::format("outputs of {} exceed inputs of {}", outputs, inputs));
+    }
+
+    return {};
+}
+
+} // namespace
+
+std::string_view ToString(TxRejectReason reason)
+{
+    switch (reason)
+    {
+        default:
+            throw std::runtime_error("unknown TxRejectReason");
+
+        case TxRejectReason::NONE:
+            return "none";
+
+        case TxRejectReason::NO_TRANSACTIONS:
+            return "no_transactions";
+
+        case TxRejectReason::MISSING_COINBASE:
+            return "missing_coinbase";
+
+        case TxRejectReason::EXTRA_COINBASE:
+            return "extra_coinbase";
+
+        case TxRejectReason::BAD_COINBASE:
+            return "bad_coinbase";
+
+        case TxRejectReason::TXINS_EMPTY:
+            return "txins_empty";
+
+        case TxRejectReason::TXOUTS_EMPTY:
+            return "txouts_empty";
+
+        case TxRejectReason::BAD_TXID:
+            return "bad_txid";
+
+        case TxRejectReason::BAD_AMOUNT:
+            return "bad_amount";
+
+        case TxRejectReason::MISSING_OUTPUT:
+            return "missing_output";
+
+        case TxRejectReason::SPENT_OUTPUT:
+            return "spent_output";
+
+        case TxRejectReason::DOUBLE_SPEND:
+            return "double_spend";
+
+        case TxRejectReason::INSUFFICIENT_INPUTS:
+            return "insufficient_inputs";
+
+        case TxRejectReason::BAD_SIGNATURE:
+            return "bad_signature";
+
+        case TxRejectReason::WRONG_KEY:
+            return "wrong_key";
+    }
+}
+
+void SetSignatureHeight(std::uint64_t height)
+{
+    signatureHeight = height;
+}
+
+std::uint64_t SignatureHeight()
+{
+    return signatureHeight;
+}
+
+void SetSpendingHeight(std::uint64_t height)
+{
+    spendingHeight = height;
+}
+
+std::uint64_t SpendingHeight()
+{
+    return spendingHeight;
+}
+
+TxValidationResult ValidateBlockTransactions(const Blockchain& chain, const Block& block, std::size_t threads)
+{
+    const auto& txs = block.transactions();
+    if (txs.empty())
+    {
+        return Reject(TxRejectReason::NO_TRANSACTIONS, 0, 0, "block has no transactions");
+    }
+
+    // brought up to date here, before the workers share it
+    const auto& unspent = chain.unspentOutputs();
+
+    // each failure is kept where the worker that found it put it,
+    // only the one at the lowest index is returned
+    std::vector<TxValidationResult> failures(txs.size());
+    const auto failure = FindFirstFailure(txs.size(), TxValidationBatchSize, threads,
+        [&](std::size_t start, std::size_t end) -> std::optional<std::size_t>
+        {
+            for (auto txidx = start; txidx < end; txidx++)
+            {
+                if (auto result = CheckTransaction(chain, unspent, block, txidx); !result.valid())
+                {
+                    failures[txidx] = std::move(result);
+                    return txidx;
+                }
+            }
+
+            return {};
+        });
+
+    // two transactions can each be fine on their own and still spend
+    // the same output, only the transactions before the first failure
+    // need to be looked at
+
+    std::unordered_set<TxOutPoint, std::hash<TxOutPoint>, TxOutPointEqual> spent;
+    const auto checked = block.index() >= spendingHeight ? failure : 0;
+    for (auto txidx = 1u; txidx < checked; txidx++)
+    {
+        const auto& txins = txs[txidx].txIns();
+        for (auto inidx = 0u; inidx < txins.size(); inidx++)
+        {
+            if (!spent.insert(txins[inidx].txOutPt()).second)
+            {
+                return Reject(TxRejectReason::DOUBLE_SPEND, txidx, inidx,
+                    fmt::format("output {} is spent twice in the block", PointText(txins[inidx].txOutPt())));
+            }
+        }
+    }
+
+    if (failure < txs.size())
+    {
+        return std::move(failures[failure]);
+    }
+
+    return {};
+}
+
+TxValidationResult ValidateTransaction(const Blockchain& chain, const Transaction& tx)
+{
+    if (auto result = CheckShape(tx, 0); !result.valid())
+    {
+        return result;
+    }
+    else if (tx.isCoinbase())
+    {
+        return Reject(TxRejectReason::EXTRA_COINBASE, 0, 0, "coinbase transactions can not be queued");
+    }
+
+    double outputs = 0;
+    if (auto result = SumOutputs(tx, 0, outputs); !result.valid())
+    {
+        return result;
+    }
+
+    const auto& unspent = chain.unspentOutputs();
+    const auto sighash = CalculateSignatureHash(tx);
+
+    std::unordered_set<TxOutPoint, std::hash<TxOutPoint>, TxOutPointEqual> points;
+    double inputs = 0;
+
+    for (auto inidx = 0u; inidx < tx.txIns().size(); inidx++)
+    {
+        const auto& point = tx.txIns()[inidx].txOutPt();
+        if (!points.insert(point).second)
+        {
+            return Reject(TxRejectReason::DOUBLE_SPEND, 0, inidx,
+                fmt::format("output {} is spent twice in the transaction", PointText(point)));
+        }
+
+        const TxOut* spent = nullptr;
+        if (auto result = FindUnspent(chain, unspent, point, 0, inidx, spent); !result.valid())
+        {
+            return result;
+        }
+
+        if (auto result = CheckSignature(tx, sighash, 0, inidx, *spent); !result.valid())
+        {
+            return result;
+        }
+
+        inputs += spent->amount();
+    }
+
+    if (outputs > inputs + AmountTolerance)
+    {
+        return Reject(TxRejectReason::INSUFFICIENT_INPUTS, 0, 0,
+            fmt::format("outputs of {} exceed inputs of {}", outputs, inputs));
+    }
+
+    return {};
+}
+
+} // namespace ash
\ No newline at end of file
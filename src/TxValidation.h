@@ -0,0 +1,80 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include "Block.h"
+#include "Transactions.h"
+
+namespace ash
+{
+
+class Blockchain;
+
+// amounts are doubles so sums are compared with this much slack
+constexpr double AmountTolerance = 1e-8;
+
+enum class TxRejectReason
+{
+    NONE = 0,
+    NO_TRANSACTIONS,        // the block has no transactions at all
+    MISSING_COINBASE,       // the first transaction is not a coinbase
+    EXTRA_COINBASE,         // a coinbase after the first transaction
+    BAD_COINBASE,           // wrong height or pays more than the reward
+    TXINS_EMPTY,
+    TXOUTS_EMPTY,
+    BAD_TXID,               // the id is not the transaction's hash
+    BAD_AMOUNT,             // an output that is not a positive amount
+    MISSING_OUTPUT,         // an input spends an output that does not exist
+    SPENT_OUTPUT,           // an input spends an output spent by an earlier block
+    DOUBLE_SPEND,           // two inputs of the block spend the same output
+    INSUFFICIENT_INPUTS,    // the outputs are worth more than the inputs
+    BAD_SIGNATURE,          // an input's signature is malformed or does not match
+    WRONG_KEY               // an input is signed by a key that does not own the output
+};
+
+std::string_view ToString(TxRejectReason reason);
+
+struct TxValidationResult
+{
+    TxRejectReason  reason = TxRejectReason::NONE;
+    std::size_t     txIndex = 0;    // the rejected transaction in the block
+    std::size_t     txInIndex = 0;  // the offending input, if the reason is about one
+    std::string     detail;
+
+    bool valid() const noexcept
+    {
+        return reason == TxRejectReason::NONE;
+    }
+};
+
+// Blocks at or above this height must sign their inputs, older blocks
+// were mined before transactions were signed. Every node on a network
+// must use the same activation height, it is set once at startup
+void SetSignatureHeight(std::uint64_t height);
+std::uint64_t SignatureHeight();
+
+// Blocks at or above this height may only spend outputs that are still
+// unspent, once, and for no more than they are worth. Older blocks were
+// mined before any of that was checked and some spend the same output
+// twice. Like the signature height it is set once at startup
+void SetSpendingHeight(std::uint64_t height);
+std::uint64_t SpendingHeight();
+
+// Checks every transaction of `block` against the outputs left unspent
+// by `chain`, which the block must be the next block of. Transactions
+// are checked on `threads` threads (0 uses every core), along with the
+// signatures of their inputs if the block is at or above the signature
+// height. What the inputs spend and the amounts are only checked at
+// or above the spending height, where inputs that spend the same
+// output are found in a sequential pass afterwards. The result
+// describes the first transaction of the block that failed
+TxValidationResult ValidateBlockTransactions(const Blockchain& chain, const Block& block, std::size_t threads = 0);
+
+// Checks a transaction before it is queued, its inputs must spend
+// outputs the chain left unspent and its signatures are always
+// verified. Verified signatures are added to the signature cache so
+// they are not verified again when the block with them arrives
+TxValidationResult ValidateTransaction(const Blockchain& chain, const Transaction& tx);
+
+} // namespace ash
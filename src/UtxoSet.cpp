@@ -0,0 +1,137 @@
+#include <cassert>
+
+#include "UtxoSet.h"
+
+namespace ash
+{
+
+const TxOut* UtxoSet::find(const TxOutPoint& point) const
+{
+    if (const auto it = _outputs.find(point); it != _outputs.end())
+    {
+        return &(it->second);
+    }
+
+    return nullptr;
+}
+
+const UtxoSet::AddressOutputs* UtxoSet::findAddress(const Address& address) const
+{
+    if (const auto it = _addresses.find(address); it != _addresses.end())
+    {
+        return &(it->second);
+    }
+
+    return nullptr;
+}
+
+std::size_t UtxoSet::size() const noexcept
+{
+    return _outputs.size();
+}
+
+std::size_t UtxoSet::connect(const Block& block)
+{
+    auto& changes = _undo.emplace_back();
+    std::size_t missing = 0;
+
+    const auto& txs = block.transactions();
+    for (auto txidx = 0u; txidx < txs.size(); txidx++)
+    {
+        const auto& tx = txs[txidx];
+        if (!tx.txIns().empty() && !tx.txOuts().empty() && !tx.isCoinbase())
+        {
+            for (const auto& txin : tx.txIns())
+            {
+                const auto& pt = txin.txOutPt();
+                const TxOutPoint point{ pt.blockIndex, pt.txIndex, pt.txOutIndex };
+                if (auto spent = take(point); spent.has_value())
+                {
+                    changes.push_back({ point, std::move(spent) });
+                }
+                else
+                {
+                    missing++;
+                }
+            }
+        }
+
+        for (auto outidx = 0u; outidx < tx.txOuts().size(); outidx++)
+        {
+            const TxOutPoint point{ block.index(), txidx, outidx };
+            changes.push_back({ point, take(point) });
+            add(point, tx.txOuts()[outidx]);
+        }
+    }
+
+    return missing;
+}
+
+void UtxoSet::disconnect()
+{
+    assert(!_undo.empty());
+
+    // backwards since a transaction can spend the outputs of the
+    // transactions before it in the block
+    const auto& changes = _undo.back();
+    for (auto it = changes.rbegin(); it != changes.rend(); it++)
+    {
+        remove(it->point);
+        if (it->previous.has_value())
+        {
+            add(it->point, *(it->previous));
+        }
+    }
+
+    _undo.pop_back();
+}
+
+void UtxoSet::clear()
+{
+    _outputs.clear();
+    _addresses.clear();
+    _undo.clear();
+}
+
+void UtxoSet::add(const TxOutPoint& point, const TxOut& txout)
+{
+    assert(_outputs.find(point) == _outputs.end());
+    _outputs.emplace(point, txout);
+
+    _addresses[txout.address()].outputs.insert(point);
+}
+
+void UtxoSet::remove(const TxOutPoint& point)
+{
+    const auto it = _outputs.find(point);
+    if (it == _outputs.end())
+    {
+        return;
+    }
+
+    const auto entry = _addresses.find(it->second.address());
+    assert(entry != _addresses.end());
+
+    entry->second.outputs.erase(point);
+    if (entry->second.outputs.empty())
+    {
+        _addresses.erase(entry);
+    }
+
+    _outputs.erase(it);
+}
+
+std::optional<TxOut> UtxoSet::take(const TxOutPoint& point)
+{
+    const auto it = _outputs.find(point);
+    if (it == _outputs.end())
+    {
+        return {};
+    }
+
+    auto retval = std::make_optional(it->second);
+    remove(point);
+    return retval;
+}
+
+} // namespace ash
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "Block.h"
+#include "Transactions.h"
+
+namespace ash
+{
+
+// only the position of an output, the optional address and
+// amount are ignored
+struct TxOutPointEqual
+{
+    bool operator()(const TxOutPoint& lhs, const TxOutPoint& rhs) const noexcept
+    {
+        return lhs.blockIndex == rhs.blockIndex
+            && lhs.txIndex == rhs.txIndex
+            && lhs.txOutIndex == rhs.txOutIndex;
+    }
+};
+
+//! The outputs of a chain that have not been spent yet, also indexed
+//  by the address they pay. Lookups can run on any number of threads
+//  as long as no block is connected at the same time
+class UtxoSet final
+{
+public:
+    using OutputMap = std::unordered_map<TxOutPoint, TxOut, std::hash<TxOutPoint>, TxOutPointEqual>;
+    using OutPointSet = std::unordered_set<TxOutPoint, std::hash<TxOutPoint>, TxOutPointEqual>;
+
+    // the unspent outputs of one address
+    struct AddressOutputs
+    {
+        OutPointSet outputs;
+    };
+
+private:
+    // an output that connect() added or took out of the set and
+    // what was there before, nothing if the point was free
+    struct Change
+    {
+        TxOutPoint              point;
+        std::optional<TxOut>    previous;
+    };
+
+    OutputMap   _outputs;
+    std::unordered_map<Address, AddressOutputs> _addresses;
+
+    // the changes of every connected block in the order they were
+    // made, so a block from a chain that was never validated is
+    // undone exactly
+    std::vector<std::vector<Change>>    _undo;
+
+public:
+    const TxOut* find(const TxOutPoint& point) const;
+
+    // nullptr if the address has no unspent outputs
+    const AddressOutputs* findAddress(const Address& address) const;
+
+    // in no particular order
+    OutputMap::const_iterator begin() const { return _outputs.begin(); }
+    OutputMap::const_iterator end() const { return _outputs.end(); }
+
+    std::size_t size() const noexcept;
+
+    // spends the inputs of the block's transactions and adds their
+    // outputs. Inputs whose output is not in the set are skipped and
+    // counted, a valid block has none
+    std::size_t connect(const Block& block);
+
+    // undoes the last connect()
+    void disconnect();
+
+    void clear();
+
+private:
+    void add(const TxOutPoint& point, const TxOut& txout);
+    void remove(const TxOutPoint& point);
+
+    // removes the output at `point` and returns it
+    std::optional<TxOut> take(const TxOutPoint& point);
+};
+
+} // namespace ash
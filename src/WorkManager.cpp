@@ -0,0 +1,163 @@
+#include <limits>
+
+#include "BlockHeader.h"
+#include "CryptoUtils.h"
+#include "WorkManager.h"
+
+namespace ash
+{
+
+namespace
+{
+
+// the largest digest that has `difficulty` leading zero nibbles
+std::string TargetHex(std::uint64_t difficulty)
+{
+    constexpr std::size_t nibbles = 64;
+    const auto zeros = static_cast<std::size_t>(std::min<std::uint64_t>(difficulty, nibbles));
+    return std::string(zeros, '0') + std::string(nibbles - zeros, 'f');
+}
+
+std::string BytesToHex(const std::uint8_t* data, std::size_t size)
+{
+    constexpr std::string_view digits = "0123456789abcdef";
+
+    std::string retval;
+    retval.reserve(size * 2);
+    for (auto idx = 0u; idx < size; idx++)
+    {
+        retval.push_back(digits[data[idx] >> 4]);
+        retval.push_back(digits[data[idx] & 0x0f]);
+    }
+
+    return retval;
+}
+
+} // namespace
+
+WorkManager::WorkManager(const Address& rewardAddress, std::string_view minerId, std::uint64_t nonceRange)
+    : _rewardAddress{ rewardAddress },
+      _minerId{ minerId },
+      _nonceRange{ std::max<std::uint64_t>(nonceRange, 1u) },
+      _logger(ash::initializeLogger("WorkManager"))
+{
+    // nothing to do
+}
+
+void WorkManager::buildTemplate(Blockchain& chain, const ChainTip& tip)
+{
+    if (_template)
+    {
+        const auto count = chain.reQueueTransactions(*_template);
+        _logger->debug("work template for block #{} is stale, requeueing {} transaction(s)",
+            _template->index(), count);
+    }
+
+    _difficulty = chain.getAdjustedDifficulty();
+
+    _template = chain.createUnminedBlock(_rewardAddress);
+    _template->setMiner(_minerId);
+    _template->setData(fmt::format("coinbase block #{}", _template->index()));
+
+    // the difficulty is part of the header so external miners
+    // need it on the template
+    _template->setMinedData(0, _difficulty, _template->time(), {});
+
+    _templateEpoch = tip.epoch();
+    _nextNonce = 0;
+    _firstJobId = _nextJobId;
+    _jobs.clear();
+
+    _logger->debug("built work template for block #{}, difficulty={}, transactions={}",
+        _template->index(), _difficulty, _template->transactions().size());
+}
+
+nl::json WorkManager::getWork(Blockchain& chain, const ChainTip& tip)
+{
+    if (!_template
+        || _templateEpoch != tip.epoch()
+        || _template->index() != chain.size()
+        || _nextNonce > std::numeric_limits<std::uint64_t>::max() - _nonceRange)
+    {
+        buildTemplate(chain, tip);
+    }
+
+    const WorkJob job{ _nextJobId++, _nextNonce, _nextNonce + _nonceRange };
+    _nextNonce = job.nonceEnd;
+    _jobs.emplace(job.id, job);
+
+    const auto version = BlockHeaderVersion(_template->index());
+
+    nl::json retval;
+    retval["jobid"] = job.id;
+    retval["index"] = _template->index();
+    retval["difficulty"] = _difficulty;
+    retval["target"] = TargetHex(_difficulty);
+    retval["noncestart"] = job.nonceStart;
+    retval["nonceend"] = job.nonceEnd;
+    retval["headerversion"] = version;
+
+    if (version == BLOCK_HEADER_V2)
+    {
+        // the nonce is the last 8 bytes and is zero in the template
+        const auto header = MakeBlockHeader(*_template);
+        retval["header"] = BytesToHex(header.data(), header.size());
+    }
+
+    retval["block"] = *_template;
+    return retval;
+}
+
+std::tuple<WorkResult, std::optional<Block>> WorkManager::submitWork(
+    Blockchain& chain, const ChainTip& tip, std::uint64_t jobId, std::uint64_t nonce)
+{
+    if (jobId < _firstJobId)
+    {
+        return { WorkResult::STALE_JOB, std::nullopt };
+    }
+
+    const auto jobIt = _jobs.find(jobId);
+    if (jobIt == _jobs.end())
+    {
+        return { WorkResult::UNKNOWN_JOB, std::nullopt };
+    }
+
+    if (!_template
+        || _templateEpoch != tip.epoch()
+        || _template->index() != chain.size())
+    {
+        return { WorkResult::STALE_JOB, std::nullopt };
+    }
+
+    const auto& job = jobIt->second;
+    if (nonce < job.nonceStart || nonce >= job.nonceEnd)
+    {
+        return { WorkResult::NONCE_OUT_OF_RANGE, std::nullopt };
+    }
+
+    Block block = *_template;
+    BlockHeaderHasher hasher{ block, _difficulty, block.time() };
+    const auto digest = hasher.digest(nonce);
+
+    if (!crypto::HasLeadingZeroNibbles(digest, _difficulty))
+    {
+        return { WorkResult::INVALID_SOLUTION, std::nullopt };
+    }
+
+    block.setMinedData(nonce, _difficulty, block.time(), Hash256{ digest });
+    if (!chain.addNewBlock(block))
+    {
+        return { WorkResult::REJECTED, std::nullopt };
+    }
+
+    // the template's transactions are in the chain now so
+    // they must not be requeued with the next template
+    _template.reset();
+    _jobs.clear();
+    _firstJobId = _nextJobId;
+
+    _logger->info("accepted external solution for block #{} from job {}", block.index(), jobId);
+    return { WorkResult::ACCEPTED, std::move(block) };
+}
+
+} // namespace ash
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <optional>
+
+#include <nlohmann/json.hpp>
+
+#include "AshLogger.h"
+#include "Block.h"
+#include "Blockchain.h"
+#include "ChainTip.h"
+
+namespace nl = nlohmann;
+
+namespace ash
+{
+
+enum class WorkResult
+{
+    ACCEPTED = 0,
+    UNKNOWN_JOB,
+    STALE_JOB,
+    NONCE_OUT_OF_RANGE,
+    INVALID_SOLUTION,
+    REJECTED
+};
+
+class WorkResultValue
+{
+    const WorkResult    _value;
+
+public:
+    static std::string ToString(WorkResult v)
+    {
+        switch (v)
+        {
+            default:
+                throw std::runtime_error("unknown WorkResult");
+
+            case WorkResult::ACCEPTED:
+                return "accepted";
+
+            case WorkResult::UNKNOWN_JOB:
+                return "unknown_job";
+
+            case WorkResult::STALE_JOB:
+                return "stale_job";
+
+            case WorkResult::NONCE_OUT_OF_RANGE:
+                return "nonce_out_of_range";
+
+            case WorkResult::INVALID_SOLUTION:
+                return "invalid_solution";
+
+            case WorkResult::REJECTED:
+                return "rejected";
+        }
+
+        assert(false);
+        return {}; // should never happen
+    }
+
+    explicit WorkResultValue(WorkResult v)
+        : _value { v }
+    {
+    }
+
+    std::string toString() const
+    {
+        return WorkResultValue::ToString(_value);
+    }
+};
+
+//! A slice of the nonce space for the current block template
+struct WorkJob
+{
+    std::uint64_t   id;
+    std::uint64_t   nonceStart;
+    std::uint64_t   nonceEnd;   // exclusive
+};
+
+//! Hands out work to miners running outside of this process.
+//  Every miner shares one block template per chain tip and gets its
+//  own job id and nonce range within it. When the tip moves on, the
+//  template's transactions go back into the queue and every job
+//  handed out for it becomes stale.
+//
+//  This class is not thread safe, the client must hold the same
+//  lock that guards the chain
+class WorkManager final
+{
+    Address                             _rewardAddress;
+    std::string                         _minerId;
+    std::uint64_t                       _nonceRange;
+
+    BlockUniquePtr                      _template;
+    std::uint64_t                       _templateEpoch = 0;
+    std::uint64_t                       _difficulty = 0;
+    std::uint64_t                       _nextNonce = 0;
+
+    std::uint64_t                       _firstJobId = 1; // of the current template
+    std::uint64_t                       _nextJobId = 1;
+    std::map<std::uint64_t, WorkJob>    _jobs;
+
+    SpdLogPtr                           _logger;
+
+    void buildTemplate(Blockchain& chain, const ChainTip& tip);
+
+public:
+    WorkManager(const Address& rewardAddress, std::string_view minerId, std::uint64_t nonceRange);
+
+    // a job for the current template, rebuilding the template first
+    // if the tip has changed since it was built
+    nl::json getWork(Blockchain& chain, const ChainTip& tip);
+
+    // validates a solution and appends the solved block to the chain,
+    // the caller is responsible for persisting and announcing it
+    std::tuple<WorkResult, std::optional<Block>> submitWork(
+        Blockchain& chain, const ChainTip& tip, std::uint64_t jobId, std::uint64_t nonce);
+};
+
+} // namespace ash
@@ -21,6 +21,7 @@
 #include "Blockchain.h"
 #include "Settings.h"
 #include "MinerApp.h"
+#include "SignatureCache.h"
 
 namespace po = boost::program_options;
 
@@ -28,8 +29,28 @@ ash::SettingsPtr registerSettings()
 {
     auto retval = std::make_unique<ash::Settings>();
 
+    // blocks up to the checkpoint are only checked for linkage when
+    // the chain is loaded, without one the node uses the last block
+    // it validated in full
+    retval->registerBool("chain.assumevalid.enable", true);
+    retval->registerInt("chain.assumevalid.height", -1);
+    retval->registerString("chain.assumevalid.hash", "");
+
     retval->registerBool("chain.reset.enable", true);
 
+    // -1 disables the v2 block header
+    retval->registerInt("chain.headerv2.height", -1);
+
+    // -1 never requires blocks to sign their inputs
+    retval->registerInt("chain.signatures.height", -1);
+
+    // -1 never checks what the inputs of blocks spend
+    retval->registerInt("chain.spending.height", -1);
+
+    // verified signatures that are remembered, 0 disables the cache
+    retval->registerUInt("chain.sigcache.size", static_cast<std::uint32_t>(ash::DefaultSignatureCacheSize),
+        std::make_shared<ash::RangeValidator<std::uint32_t>>(0u, 10000000u));
+
     const std::string dbfolder = utils::getDefaultDatabaseFolder();
     retval->registerString("database.folder", dbfolder, 
         std::make_shared<ash::NotEmptyValidator>());
@@ -44,6 +65,27 @@ ash::SettingsPtr registerSettings()
     retval->registerString("mining.miner.address", "<CHANGE ME>", 
         std::make_shared<ash::NotEmptyValidator>());
 
+    // 0 will use all available cores
+    constexpr auto threadsMax = 1024u;
+    retval->registerUInt("mining.threads", 1u,
+        std::make_shared<ash::RangeValidator<std::uint32_t>>(0u, threadsMax));
+
+    // e.g. "0-3,6", empty leaves the mining threads unpinned
+    retval->registerString("mining.cpus", "");
+
+    // milliseconds a request may take before the miner backs off,
+    // 0 never throttles the miner
+    retval->registerUInt("mining.latency_budget_ms", 0u,
+        std::make_shared<ash::RangeValidator<std::uint32_t>>(0u, 60000u));
+
+    // seconds between hash rate log lines, 0 disables them
+    retval->registerUInt("mining.stats.interval", 60u,
+        std::make_shared<ash::RangeValidator<std::uint32_t>>(0u, 86400u));
+
+    // external miners get 2^noncebits nonces per job
+    retval->registerUInt("mining.work.noncebits", 32u,
+        std::make_shared<ash::RangeValidator<std::uint32_t>>(8u, 62u));
+
     constexpr auto portMin = 1024u;
     constexpr auto portMax = 65535u;
     constexpr auto portDefault = ash::HTTPServerPortDefault;
@@ -135,6 +177,7 @@ int main(int argc, char* argv[])
         ("version,v", "print version string")
         ("config,c",po::value<std::string>(), "config file")
         ("createwallet", "create a wallet")
+        ("verifychain", "verify every block of the saved chain at startup")
         ;
 
     po::variables_map vm;
@@ -167,6 +210,12 @@ int main(int argc, char* argv[])
     }
 
     auto settings = initSettings(configFile);
+    if (vm.count("verifychain") > 0)
+    {
+        // only for this run, the settings file is not saved again
+        settings->set("chain.assumevalid.enable", "false");
+    }
+
     initializeLogs(settings);
     ash::rootLogger()->info("using setting file {}", configFile);
 
@@ -1,7 +1,10 @@
 #include <iterator>
+#include <limits>
 #include <fstream>
 #include <streambuf>
 #include <memory>
+#include <numeric>
+#include <unordered_map>
 
 #include <boost/test/unit_test.hpp>
 #include <boost/test/data/test_case.hpp>
@@ -14,17 +17,23 @@
 
 #include <test-config.h>
 
+#include "../src/BinaryCodec.h"
 #include "../src/Block.h"
 #include "../src/Blockchain.h"
 #include "../src/Miner.h"
 #include "../src/CryptoUtils.h"
+#include "../src/HashRate.h"
+#include "../src/SignatureCache.h"
+#include "../src/TemplateBuilder.h"
 #include "../src/Transactions.h"
+#include "../src/TxValidation.h"
 #include "../src/Miner.h"
 
 namespace nl = nlohmann;
 namespace data = boost::unit_test::data;
 
 using namespace std::string_literals;
+using namespace ash::literals;
 
 namespace std
 {
@@ -41,7 +50,7 @@ std::ostream& operator<<(std::ostream& out, const std::vector<std::string>& stri
 std::ostream& operator<<(std::ostream& out, const ash::TxOutPoint& v)
 {
     const std::string address =
-            (v.address.has_value() ? *(v.address) : "null"s);
+            (v.address.has_value() ? v.address->base58() : "null"s);
 
     const std::string amount =
             (v.amount.has_value() ? std::to_string(*(v.amount)) : "null"s);
@@ -110,6 +119,349 @@ BOOST_AUTO_TEST_CASE(LoadChainFromJson)
     BOOST_TEST(chain.at(1).transactions().size() == 2);
 }
 
+BOOST_AUTO_TEST_CASE(ValidChainTest)
+{
+    const auto chain = LoadBlockchain("blockchain4.json");
+    BOOST_TEST(chain.size() == 4);
+    BOOST_TEST(chain.isValidChain());
+
+    for (auto idx = 1u; idx < chain.size(); idx++)
+    {
+        BOOST_TEST(ash::ValidHash(chain.at(idx)));
+        BOOST_TEST(ash::CalculateBlockHash(chain.at(idx)) == chain.at(idx).hash());
+    }
+}
+
+ash::Blockchain MakeChain(const std::vector<ash::Block>& blocks)
+{
+    ash::codec::Buffer buffer;
+    ash::codec::Writer writer{ buffer };
+    ash::write_blocks(writer, blocks.data(), blocks.size());
+
+    ash::Blockchain retval;
+    ash::codec::Reader reader{ buffer };
+    ash::read_blocks(reader, retval, ash::codec::FORMAT_VERSION);
+    return retval;
+}
+
+// mines `count` blocks onto `chain` that pay their coinbase to the
+// same address and take in the queued transactions
+void MineBlocks(ash::Blockchain& chain, std::size_t count)
+{
+    ash::TemplateBuilder builder{ "1LahaosvBaCG4EbDamyvuRmcrqc5P2iv7t"_address, "test" };
+    ash::Miner miner{ 0 };
+    for (auto idx = 0u; idx < count; idx++)
+    {
+        auto tmpl = builder.build(chain);
+        BOOST_REQUIRE(miner.mineBlock(*tmpl.block, tmpl.commitment) == ash::Miner::SUCCESS);
+        BOOST_REQUIRE(chain.addNewBlock(*tmpl.block));
+    }
+}
+
+// checks what every block spends, by default the rules never activate
+// so the legacy test chains stay valid
+struct SpendingFixture
+{
+    SpendingFixture() { ash::SetSpendingHeight(0); }
+    ~SpendingFixture() { ash::SetSpendingHeight(std::numeric_limits<std::uint64_t>::max()); }
+};
+
+BOOST_AUTO_TEST_CASE(ParallelValidChainTest)
+{
+    // enough blocks for several validation batches
+    auto chain = LoadBlockchain("blockchain1.json");
+    MineBlocks(chain, 700 - chain.size());
+
+    const std::vector<ash::Block> blocks(chain.begin(), chain.end());
+    for (auto threads : { 1u, 3u, 8u })
+    {
+        BOOST_TEST(!chain.firstInvalidBlock(threads).has_value());
+
+        // a block whose data no longer matches its hash
+        auto tampered = blocks;
+        tampered[600].setData("tampered");
+        tampered[300].setData("tampered");
+        BOOST_TEST((MakeChain(tampered).firstInvalidBlock(threads) == 300u));
+
+        // blocks up to a trusted height are not hashed again
+        BOOST_TEST((MakeChain(tampered).firstInvalidBlock(threads, 400) == 600u));
+        BOOST_TEST(!MakeChain(tampered).firstInvalidBlock(threads, 650).has_value());
+
+        // a valid block in the wrong place only fails the linkage pass
+        auto relinked = blocks;
+        relinked[200] = blocks[199];
+        relinked[500].setData("tampered");
+        BOOST_TEST((MakeChain(relinked).firstInvalidBlock(threads) == 200u));
+        BOOST_TEST((MakeChain(relinked).firstInvalidBlock(threads, 699) == 200u));
+    }
+
+    BOOST_TEST(chain.isValidChain());
+}
+
+BOOST_FIXTURE_TEST_CASE(DataChainTransactionsTest, SpendingFixture)
+{
+    const auto validateAt = [](const ash::Blockchain& chain, std::size_t idx)
+    {
+        const std::vector<ash::Block> blocks(chain.begin(), std::next(chain.begin(), idx));
+        return ash::ValidateBlockTransactions(MakeChain(blocks), chain.at(idx));
+    };
+
+    const auto chain2 = LoadBlockchain("blockchain2.json");
+    BOOST_TEST(validateAt(chain2, 1).valid());
+
+    // these blocks were mined before transactions were validated, the
+    // wallet spent the same coinbase output in six transactions
+    const auto chain4 = LoadBlockchain("blockchain4.json");
+    BOOST_TEST(validateAt(chain4, 1).valid());
+
+    // which is fine below the spending height
+    ash::SetSpendingHeight(3);
+    BOOST_TEST(validateAt(chain4, 2).valid());
+    ash::SetSpendingHeight(2);
+
+    const auto result = validateAt(chain4, 2);
+    BOOST_TEST((result.reason == ash::TxRejectReason::DOUBLE_SPEND));
+    BOOST_TEST(result.txIndex == 2u);
+    BOOST_TEST(result.detail == "output 1:0:0 is spent twice in the block");
+}
+
+BOOST_FIXTURE_TEST_CASE(TxValidationTest, SpendingFixture)
+{
+    const auto address = "1LahaosvBaCG4EbDamyvuRmcrqc5P2iv7t"_address;
+    const auto receiver = "1Cus7TLessdAvkzN2BhK3WD3Ymru48X3z8"_address;
+
+    // every coinbase pays the same address so there is an
+    // output to spend in every block
+    auto chain = LoadBlockchain("blockchain1.json");
+    MineBlocks(chain, 300 - chain.size());
+
+    const auto spend = [&](std::uint64_t blockIdx, double amount)
+    {
+        ash::Transaction tx;
+        tx.txIns().emplace_back(blockIdx, 0, 0, "signature");
+        tx.txOuts().emplace_back(receiver, amount);
+        tx.calcuateId(chain.size());
+        return tx;
+    };
+
+    const auto makeBlock = [&](ash::Transactions txs)
+    {
+        txs.insert(txs.begin(), ash::CreateCoinbaseTransaction(chain.size(), address));
+        return ash::Block{ chain.size(), chain.back().hash(), std::move(txs) };
+    };
+
+    const auto validate = [&](ash::Transactions txs, std::size_t threads = 0)
+    {
+        return ash::ValidateBlockTransactions(chain, makeBlock(std::move(txs)), threads);
+    };
+
+    // one transaction for each coinbase, several batches of them
+    ash::Transactions spendAll;
+    for (auto idx = 1u; idx < chain.size(); idx++)
+    {
+        spendAll.push_back(spend(idx, 57.0));
+    }
+
+    for (auto threads : { 1u, 4u })
+    {
+        BOOST_TEST(validate(spendAll, threads).valid());
+
+        // the double spend comes first even though it is only found
+        // after the parallel checks
+        auto txs = spendAll;
+        txs[149] = spend(20, 1.0);
+        txs[199] = spend(200, -1.0);
+        auto result = validate(txs, threads);
+        BOOST_TEST((result.reason == ash::TxRejectReason::DOUBLE_SPEND));
+        BOOST_TEST(result.txIndex == 150u);
+
+        txs[99] = spend(100, 0.0);
+        result = validate(txs, threads);
+        BOOST_TEST((result.reason == ash::TxRejectReason::BAD_AMOUNT));
+        BOOST_TEST(result.txIndex == 100u);
+    }
+
+    BOOST_TEST((validate({ spend(5, 58.0) }).reason == ash::TxRejectReason::INSUFFICIENT_INPUTS));
+    BOOST_TEST((validate({ spend(5000, 1.0) }).reason == ash::TxRejectReason::MISSING_OUTPUT));
+    BOOST_TEST((validate({ ash::CreateCoinbaseTransaction(chain.size(), address) }).reason
+        == ash::TxRejectReason::EXTRA_COINBASE));
+
+    auto stale = spend(5, 10.0);
+    stale.txOuts().emplace_back(address, 47.0);
+    BOOST_TEST((validate({ stale }).reason == ash::TxRejectReason::BAD_TXID));
+
+    auto split = spend(5, 10.0);
+    split.txIns().emplace_back(5, 0, 0, "signature");
+    split.calcuateId(chain.size());
+    const auto splitResult = validate({ split });
+    BOOST_TEST((splitResult.reason == ash::TxRejectReason::DOUBLE_SPEND));
+    BOOST_TEST(splitResult.txInIndex == 1u);
+
+    auto greedy = makeBlock({});
+    greedy.transactions().front().txOuts().emplace_back(address, 1.0);
+    greedy.transactions().front().calcuateId(chain.size());
+    BOOST_TEST((ash::ValidateBlockTransactions(chain, greedy).reason == ash::TxRejectReason::BAD_COINBASE));
+
+    // a block that is accepted spends its outputs for the next one
+    ash::Miner miner{ 0 };
+    auto block = makeBlock({ spend(5, 57.0), spend(6, 57.0) });
+    BOOST_REQUIRE(miner.mineBlock(block) == ash::Miner::SUCCESS);
+    BOOST_REQUIRE(chain.addNewBlock(block));
+
+    const auto respend = validate({ spend(7, 57.0), spend(6, 57.0) });
+    BOOST_TEST((respend.reason == ash::TxRejectReason::SPENT_OUTPUT));
+    BOOST_TEST(respend.txIndex == 2u);
+
+    // and an invalid block is not added
+    auto rejected = makeBlock({ spend(5, 57.0) });
+    BOOST_REQUIRE(miner.mineBlock(rejected) == ash::Miner::SUCCESS);
+    BOOST_TEST(!chain.addNewBlock(rejected));
+    BOOST_TEST(chain.size() == 301u);
+}
+
+BOOST_AUTO_TEST_CASE(SignedTransactionTest)
+{
+    constexpr std::string_view privateKey = "1b3f78b45456dcfc3a2421da1d9961abd944b7e8a7c2ccc809a7ea92e200eeb1h";
+    const auto receiver = "1Cus7TLessdAvkzN2BhK3WD3Ymru48X3z8"_address;
+
+    // the blocks of the test chain were mined before signatures
+    auto chain = LoadBlockchain("blockchain1.json");
+    const auto signatureHeight = ash::SignatureHeight();
+    ash::SetSignatureHeight(chain.size());
+
+    auto [result, tx] = ash::CreateTransaction(chain, privateKey, receiver, 10.0);
+    BOOST_REQUIRE((result == ash::TxResult::SUCCESS));
+    BOOST_TEST(tx.txIns().front().signature().substr(0, ash::PublicKeyHexSize)
+        == ash::crypto::GetPublicKey(privateKey));
+
+    auto& cache = ash::GetSignatureCache();
+    cache.clear();
+    BOOST_TEST(ash::ValidateTransaction(chain, tx).valid());
+    BOOST_TEST(cache.size() == tx.txIns().size());
+
+    const auto validate = [&](ash::Transaction tx)
+    {
+        tx.calcuateId(chain.size());
+
+        ash::Transactions txs;
+        txs.push_back(ash::CreateCoinbaseTransaction(chain.size(), receiver));
+        txs.push_back(std::move(tx));
+        return ash::ValidateBlockTransactions(chain,
+            ash::Block{ chain.size(), chain.back().hash(), std::move(txs) });
+    };
+
+    // the block uses the signatures verified when the transaction was queued
+    BOOST_TEST(validate(tx).valid());
+    BOOST_TEST(cache.size() == tx.txIns().size());
+
+    auto redirected = tx;
+    redirected.txOuts().front() = ash::TxOut{ "1LahaosvBaCG4EbDamyvuRmcrqc5P2iv7t"_address, 10.0 };
+    BOOST_TEST((ash::ValidateTransaction(chain, redirected).reason == ash::TxRejectReason::BAD_SIGNATURE));
+    BOOST_TEST((validate(redirected).reason == ash::TxRejectReason::BAD_SIGNATURE));
+
+    auto stolen = tx;
+    ash::SignTransaction(stolen, "362116d38976078659ae158f6c21bcda40f75d4a8aa7f0a4ffbe56a48cacb93h");
+    BOOST_TEST((validate(stolen).reason == ash::TxRejectReason::WRONG_KEY));
+
+    auto unsigned_ = tx;
+    unsigned_.txIns().front().setSignature("signature");
+    const auto rejected = validate(unsigned_);
+    BOOST_TEST((rejected.reason == ash::TxRejectReason::BAD_SIGNATURE));
+    BOOST_TEST(rejected.txIndex == 1u);
+
+    // blocks below the activation height are not checked
+    ash::SetSignatureHeight(chain.size() + 1);
+    BOOST_TEST(validate(unsigned_).valid());
+
+    ash::SetSignatureHeight(signatureHeight);
+}
+
+BOOST_AUTO_TEST_CASE(NetworkHashRateTest)
+{
+    const auto chain = LoadBlockchain("blockchain4.json");
+    BOOST_REQUIRE(chain.size() > 3);
+
+    const auto last = chain.size() - 1;
+    const auto elapsed = std::chrono::duration<double>(
+        chain.at(last).time() - chain.at(last - 2).time()).count();
+    const auto hashes = std::pow(16.0, chain.at(last).difficulty())
+        + std::pow(16.0, chain.at(last - 1).difficulty());
+
+    BOOST_TEST(ash::EstimateNetworkHashRate(chain, 2) == hashes / elapsed,
+        boost::test_tools::tolerance(0.0001));
+
+    // a window larger than the chain uses every block
+    BOOST_TEST(ash::EstimateNetworkHashRate(chain, 1000) > 0.0);
+    BOOST_TEST(ash::EstimateNetworkHashRate(LoadBlockchain("blockchain1.json"), 10) == 0.0);
+}
+
+BOOST_FIXTURE_TEST_CASE(FirstInvalidTransactionsTest, SpendingFixture)
+{
+    // block #2 spends the coinbase of block #1 more than once
+    const auto invalid = LoadBlockchain("blockchain4.json");
+    BOOST_TEST(!invalid.firstInvalidBlock().has_value());
+    BOOST_TEST((invalid.firstInvalidTransactions() == std::optional<std::size_t>{ 2 }));
+
+    // a chain from before the spending height can still be adopted
+    ash::SetSpendingHeight(std::numeric_limits<std::uint64_t>::max());
+    BOOST_TEST(!invalid.firstInvalidTransactions().has_value());
+    ash::SetSpendingHeight(0);
+
+    auto chain = LoadBlockchain("blockchain1.json");
+    MineBlocks(chain, 3);
+
+    BOOST_TEST(!chain.firstInvalidTransactions().has_value());
+}
+
+BOOST_AUTO_TEST_CASE(CumDifficultyTest)
+{
+    auto chain = LoadBlockchain("blockchain4.json");
+    BOOST_REQUIRE(chain.size() == 4u);
+
+    // the blocks before each height, each worth 2^difficulty
+    std::vector<ash::ChainWork> expected{ 0 };
+    for (const auto& block : chain)
+    {
+        expected.push_back(expected.back() + (ash::ChainWork{ 1 } << static_cast<unsigned>(block.difficulty())));
+    }
+
+    for (auto idx = chain.size(); idx-- > 0;)
+    {
+        BOOST_TEST(chain.cumDifficulty(idx) == expected[idx]);
+    }
+
+    BOOST_TEST(chain.cumDifficulty() == expected[chain.size() - 1]);
+
+    chain.resize(2);
+    BOOST_TEST(chain.cumDifficulty() == expected[1]);
+    BOOST_TEST(chain.cumDifficulty(2) == expected[2]);
+
+    chain.clear();
+    BOOST_TEST(chain.cumDifficulty(0) == 0);
+}
+
+BOOST_AUTO_TEST_CASE(WideCumDifficultyTest)
+{
+    // the chain is loaded without checking that the hashes
+    // meet these difficulties
+    const std::string filename = fmt::format("{}/tests/data/blockchain4.json", ASH_SRC_DIRECTORY);
+    nl::json json = nl::json::parse(LoadFile(filename), nullptr, false);
+    BOOST_REQUIRE(!json.is_discarded());
+
+    json["blocks"][1]["difficulty"] = 40;
+    json["blocks"][2]["difficulty"] = 64;
+    json["blocks"][3]["difficulty"] = 100;
+    const auto chain = json["blocks"].get<ash::Blockchain>();
+
+    // a block never counts for more than a hash with 64 zero nibbles
+    const auto genesis = ash::ChainWork{ 1 } << static_cast<unsigned>(chain.front().difficulty());
+    const auto expected = genesis + (ash::ChainWork{ 1 } << 40) + (ash::ChainWork{ 1 } << 64) * 2;
+
+    BOOST_TEST(chain.cumDifficulty(chain.size()) == expected);
+    BOOST_TEST(chain.cumDifficulty(2) == genesis + (ash::ChainWork{ 1 } << 40));
+    BOOST_TEST(chain.cumDifficulty(3) > std::numeric_limits<std::uint64_t>::max());
+}
+
 BOOST_AUTO_TEST_CASE(GetAllUnspentTxOutsTest)
 {
     auto chain = LoadBlockchain("blockchain2.json");
@@ -124,13 +476,71 @@ BOOST_AUTO_TEST_CASE(GetAddressUnspentTxOutsTest)
     auto chain = LoadBlockchain("blockchain2.json");
     BOOST_TEST(chain.size() == 2);
 
-    const auto addyUnspent = ash::GetUnspentTxOuts(chain, "1LahaosvBaCG4EbDamyvuRmcrqc5P2iv7t");
+    const auto addyUnspent = ash::GetUnspentTxOuts(chain, "1LahaosvBaCG4EbDamyvuRmcrqc5P2iv7t"_address);
     BOOST_TEST(addyUnspent.size() == 2);
 
-    const auto stefanUnspent = ash::GetUnspentTxOuts(chain, "1Cus7TLessdAvkzN2BhK3WD3Ymru48X3z8");
+    const auto stefanUnspent = ash::GetUnspentTxOuts(chain, "1Cus7TLessdAvkzN2BhK3WD3Ymru48X3z8"_address);
     BOOST_TEST(stefanUnspent.size() == 1);
 }
 
+BOOST_AUTO_TEST_CASE(UnspentRollbackTest)
+{
+    constexpr std::string_view privateKey = "1b3f78b45456dcfc3a2421da1d9961abd944b7e8a7c2ccc809a7ea92e200eeb1h";
+    const auto receiver = "1Cus7TLessdAvkzN2BhK3WD3Ymru48X3z8"_address;
+
+    auto chain = LoadBlockchain("blockchain1.json");
+    MineBlocks(chain, 3);
+
+    const auto height = chain.size();
+    const nl::json before = ash::GetUnspentTxOuts(chain);
+
+    // every block spends outputs of the blocks before it
+    for (auto idx = 0u; idx < 3u; idx++)
+    {
+        auto [result, tx] = ash::CreateTransaction(chain, privateKey, receiver, 60.0);
+        BOOST_REQUIRE((result == ash::TxResult::SUCCESS));
+        chain.queueTransaction(std::move(tx));
+        MineBlocks(chain, 1);
+    }
+
+    const auto txid = chain.back().transactions().back().id();
+    BOOST_TEST(ash::GetAddressLedger(chain, receiver).size() == 3u);
+    BOOST_TEST((ash::FindTransaction(chain, txid) == ash::TxPoint{ chain.size() - 1, 1u }));
+    BOOST_TEST(ash::GetUnspentTxOuts(chain, receiver).size() == 3u);
+    BOOST_TEST(ash::GetAddressBalance(chain, receiver) == 180.0, boost::test_tools::tolerance(0.001));
+
+    chain.resize(height);
+    BOOST_TEST(nl::json(ash::GetUnspentTxOuts(chain)) == before);
+    BOOST_TEST(ash::GetUnspentTxOuts(chain, receiver).empty());
+    BOOST_TEST(ash::GetAddressBalance(chain, receiver) == 0.0);
+    BOOST_TEST(!ash::FindTransaction(chain, txid).has_value());
+    BOOST_TEST(ash::GetAddressLedger(chain, receiver).empty());
+    BOOST_TEST(ash::FindTransaction(chain, chain.back().transactions().front().id()).has_value());
+
+    // the outputs that were put back can be spent again
+    auto [result, tx] = ash::CreateTransaction(chain, privateKey, receiver, 100.0);
+    BOOST_REQUIRE((result == ash::TxResult::SUCCESS));
+    BOOST_TEST(ash::ValidateTransaction(chain, tx).valid());
+}
+
+BOOST_AUTO_TEST_CASE(UnvalidatedRollbackTest)
+{
+    // block #3 now spends an output block #2 already spent and one that
+    // does not exist. Rolling it back must only put back what connecting
+    // it took out
+    auto chain = LoadBlockchain("blockchain4.json");
+    chain.txAt(3, 1).txIns().at(0).txOutPt() = ash::TxOutPoint{ 1, 0, 0 };
+    chain.txAt(3, 2).txIns().at(0).txOutPt() = ash::TxOutPoint{ 7, 0, 0 };
+
+    BOOST_TEST(chain.unspentOutputs().size() > 0u);
+    chain.resize(3);
+
+    auto expected = LoadBlockchain("blockchain4.json");
+    expected.resize(3);
+
+    BOOST_TEST(nl::json(ash::GetUnspentTxOuts(chain)) == nl::json(ash::GetUnspentTxOuts(expected)));
+}
+
 BOOST_AUTO_TEST_CASE(GetAddressLedgerTest)
 {
     auto ledgerSort = [](const ash::LedgerInfo& x, const ash::LedgerInfo& y)
@@ -152,38 +562,98 @@ BOOST_AUTO_TEST_CASE(GetAddressLedgerTest)
     const auto chain = LoadBlockchain("blockchain4.json");
     BOOST_TEST(chain.size() == 4);
 
-    auto ledger = ash::GetAddressLedger(chain, "1Cus7TLessdAvkzN2BhK3WD3Ymru48X3z8");
+    auto ledger = ash::GetAddressLedger(chain, "1Cus7TLessdAvkzN2BhK3WD3Ymru48X3z8"_address);
     BOOST_TEST(ledger.size() == 5);
     std::sort(ledger.begin(), ledger.end(), ledgerSort);
 
     BOOST_TEST(dataLedger == ledger, boost::test_tools::per_element());
 }
 
+BOOST_AUTO_TEST_CASE(AddressHistoryPageTest)
+{
+    const auto chain = LoadBlockchain("blockchain4.json");
+    const auto address = "1Cus7TLessdAvkzN2BhK3WD3Ymru48X3z8"_address;
+    const auto& history = chain.addressHistory();
+
+    const auto ledger = ash::GetAddressLedger(chain, address);
+    BOOST_REQUIRE(ledger.size() == 5u);
+
+    // newest first
+    const auto first = history.page(address, 0, 2);
+    BOOST_REQUIRE(first.size() == 2u);
+    BOOST_TEST(first[0].txid == "f30da564d3839b25e2bdad1b056eabb1185276a7736eed0e2e8448d9ff3df562"_hash);
+    BOOST_TEST(first[1].txid == "78348ae3273195a3b1d0fb974f608be165d8498cf6b333594a7b761e3e51f86d"_hash);
+    BOOST_TEST(first[0].amount == -0.05, boost::test_tools::tolerance(0.0001));
+
+    const auto last = history.page(address, 4, 10);
+    BOOST_REQUIRE(last.size() == 1u);
+    BOOST_TEST(last[0].txid == ledger.front().txid);
+    BOOST_TEST(last[0].amount == 40.0);
+
+    BOOST_TEST(history.page(address, 5, 10).empty());
+    BOOST_TEST(history.page(ash::Address{}, 0, 10).empty());
+}
+
 BOOST_AUTO_TEST_CASE(GetAddressBalanceTest)
 {
     auto chain = LoadBlockchain("blockchain4.json");
     BOOST_TEST(chain.size() == 4);
 
-    auto addyBalance = ash::GetAddressBalance(chain, "1LahaosvBaCG4EbDamyvuRmcrqc5P2iv7t");
+    auto addyBalance = ash::GetAddressBalance(chain, "1LahaosvBaCG4EbDamyvuRmcrqc5P2iv7t"_address);
     BOOST_TEST(addyBalance == 185.594, boost::test_tools::tolerance(0.0001));
 
-    auto stefanBalance = ash::GetAddressBalance(chain, "1Cus7TLessdAvkzN2BhK3WD3Ymru48X3z8");
+    auto stefanBalance = ash::GetAddressBalance(chain, "1Cus7TLessdAvkzN2BhK3WD3Ymru48X3z8"_address);
     BOOST_TEST(stefanBalance == 39.954, boost::test_tools::tolerance(0.0001));
 
-    auto henryBalance = ash::GetAddressBalance(chain, "1KHEXSmHaLtz4v8XrHegLzyVuU6SLg7Atw");
+    auto henryBalance = ash::GetAddressBalance(chain, "1KHEXSmHaLtz4v8XrHegLzyVuU6SLg7Atw"_address);
     BOOST_TEST(henryBalance == 2.452, boost::test_tools::tolerance(0.0001));
 }
 
+BOOST_AUTO_TEST_CASE(AddressIndexTest)
+{
+    const auto chain = LoadBlockchain("blockchain4.json");
+
+    for (const auto& address : { "1LahaosvBaCG4EbDamyvuRmcrqc5P2iv7t"_address,
+        "1Cus7TLessdAvkzN2BhK3WD3Ymru48X3z8"_address, "1KHEXSmHaLtz4v8XrHegLzyVuU6SLg7Atw"_address })
+    {
+        // the index agrees with a pass over every unspent output
+        std::size_t count = 0;
+        for (const auto& [point, txout] : chain.unspentOutputs())
+        {
+            if (txout.address() == address)
+            {
+                count++;
+            }
+        }
+
+        const auto entry = chain.unspentOutputs().findAddress(address);
+        BOOST_REQUIRE(entry != nullptr);
+        BOOST_TEST(entry->outputs.size() == count);
+        BOOST_TEST(ash::GetUnspentTxOuts(chain, address).size() == count);
+
+        // and the balance with the ledger that /rest/address returns
+        const auto ledger = ash::GetAddressLedger(chain, address);
+        const auto ledgerBalance = std::accumulate(ledger.begin(), ledger.end(), 0.0,
+            [](auto accum, const auto& info) { return accum + info.amount; });
+
+        BOOST_TEST(ash::GetAddressBalance(chain, address) == ledgerBalance, boost::test_tools::tolerance(0.0001));
+    }
+
+    // an address that was never paid
+    BOOST_TEST(chain.unspentOutputs().findAddress(ash::Address{}) == nullptr);
+    BOOST_TEST(ash::GetAddressBalance(chain, ash::Address{}) == 0.0);
+}
+
 BOOST_AUTO_TEST_CASE(SingleQueueTransactionTest)
 {
     auto chain = LoadBlockchain("blockchain1.json");
     BOOST_TEST(chain.size() == 1);
 
-    auto addyBalance = ash::GetAddressBalance(chain, "1LahaosvBaCG4EbDamyvuRmcrqc5P2iv7t");
+    auto addyBalance = ash::GetAddressBalance(chain, "1LahaosvBaCG4EbDamyvuRmcrqc5P2iv7t"_address);
     BOOST_TEST(addyBalance == 57.00, boost::test_tools::tolerance(0.001));
 
     auto [result, newtx] = ash::CreateTransaction(chain, "1b3f78b45456dcfc3a2421da1d9961abd944b7e8a7c2ccc809a7ea92e200eeb1h",
-                                    "1Cus7TLessdAvkzN2BhK3WD3Ymru48X3z8", 10.0);
+                                    "1Cus7TLessdAvkzN2BhK3WD3Ymru48X3z8"_address, 10.0);
     BOOST_TEST((result == ash::TxResult::SUCCESS));
     BOOST_TEST(newtx.txIns().size() == 1);
     BOOST_TEST(newtx.txOuts().size() == 2);
@@ -195,7 +665,7 @@ BOOST_AUTO_TEST_CASE(SingleQueueTransactionTest)
     miner.setDifficulty(0);
     BOOST_TEST(miner.difficulty() == 0);
 
-    auto newblock = chain.createUnminedBlock("1LahaosvBaCG4EbDamyvuRmcrqc5P2iv7t");
+    auto newblock = chain.createUnminedBlock("1LahaosvBaCG4EbDamyvuRmcrqc5P2iv7t"_address);
     BOOST_TEST(chain.transactionQueueSize() == 0);
     BOOST_TEST(newblock->transactions().size() == 2);
 
@@ -205,20 +675,90 @@ BOOST_AUTO_TEST_CASE(SingleQueueTransactionTest)
     chain.addNewBlock(*newblock);
     BOOST_TEST(chain.size() == 2);
 
-    addyBalance = ash::GetAddressBalance(chain, "1LahaosvBaCG4EbDamyvuRmcrqc5P2iv7t");
+    addyBalance = ash::GetAddressBalance(chain, "1LahaosvBaCG4EbDamyvuRmcrqc5P2iv7t"_address);
     BOOST_TEST(addyBalance == 104.00, boost::test_tools::tolerance(0.001));
 
-    auto stefanBalance = ash::GetAddressBalance(chain, "1Cus7TLessdAvkzN2BhK3WD3Ymru48X3z8");
+    auto stefanBalance = ash::GetAddressBalance(chain, "1Cus7TLessdAvkzN2BhK3WD3Ymru48X3z8"_address);
     BOOST_TEST(stefanBalance == 10.00, boost::test_tools::tolerance(0.001));
 }
 
+BOOST_AUTO_TEST_CASE(TemplatePipelineTest)
+{
+    constexpr std::string_view privateKey = "1b3f78b45456dcfc3a2421da1d9961abd944b7e8a7c2ccc809a7ea92e200eeb1h";
+    const auto address = "1Cus7TLessdAvkzN2BhK3WD3Ymru48X3z8"_address;
+
+    auto chain = LoadBlockchain("blockchain1.json");
+    ash::TemplateBuilder builder{ "1LahaosvBaCG4EbDamyvuRmcrqc5P2iv7t"_address, "test" };
+
+    auto current = builder.build(chain);
+    BOOST_TEST(current.block->index() == 1u);
+    BOOST_TEST(current.block->previousHash() == chain.back().hash());
+
+    // queued while block #1 is mined so it goes into block #2
+    auto [result, tx] = ash::CreateTransaction(chain, privateKey, address, 10.0);
+    BOOST_REQUIRE((result == ash::TxResult::SUCCESS));
+    chain.queueTransaction(std::move(tx));
+
+    auto next = builder.prebuild(chain, current.block->index() + 1);
+    BOOST_TEST(next.block->transactions().size() == 2u);
+    BOOST_TEST(chain.transactionQueueSize() == 0u);
+
+    // block #1 has not been added yet
+    BOOST_TEST(!builder.finish(chain, next));
+
+    ash::Miner miner{ 0 };
+    BOOST_REQUIRE(miner.mineBlock(*current.block, current.commitment) == ash::Miner::SUCCESS);
+    BOOST_REQUIRE(chain.addNewBlock(*current.block));
+
+    // a transaction that shows up after the template was built
+    auto [lateResult, lateTx] = ash::CreateTransaction(chain, privateKey, address, 1.0);
+    BOOST_REQUIRE((lateResult == ash::TxResult::SUCCESS));
+    chain.queueTransaction(std::move(lateTx));
+
+    BOOST_TEST(builder.finish(chain, next));
+    BOOST_TEST(next.block->previousHash() == chain.back().hash());
+    BOOST_TEST(next.block->transactions().size() == 3u);
+    BOOST_TEST((next.commitment == ash::CalculateBlockCommitment(*next.block)));
+    BOOST_TEST(chain.transactionQueueSize() == 0u);
+}
+
+BOOST_AUTO_TEST_CASE(TemplateRefreshTest)
+{
+    auto chain = LoadBlockchain("blockchain1.json");
+    ash::TemplateBuilder builder{ "1LahaosvBaCG4EbDamyvuRmcrqc5P2iv7t"_address, "test" };
+
+    auto tmpl = builder.build(chain);
+    const auto coinbaseId = tmpl.block->transactions().front().id();
+    BOOST_TEST(!builder.refresh(chain, tmpl));
+    BOOST_TEST(!nl::json(tmpl.block->transactions().front()).contains("extranonce"));
+
+    auto [result, tx] = ash::CreateTransaction(chain,
+        "1b3f78b45456dcfc3a2421da1d9961abd944b7e8a7c2ccc809a7ea92e200eeb1h",
+        "1Cus7TLessdAvkzN2BhK3WD3Ymru48X3z8"_address, 10.0);
+    BOOST_REQUIRE((result == ash::TxResult::SUCCESS));
+    chain.queueTransaction(std::move(tx));
+
+    BOOST_TEST(builder.refresh(chain, tmpl));
+    BOOST_TEST(tmpl.block->transactions().size() == 2u);
+    BOOST_TEST((tmpl.commitment == ash::CalculateBlockCommitment(*tmpl.block)));
+
+    const auto& coinbase = tmpl.block->transactions().front();
+    BOOST_TEST(coinbase.extraNonce() == 1u);
+    BOOST_TEST(coinbase.id() != coinbaseId);
+
+    // the extra nonce survives a round trip
+    const auto copy = nl::json(coinbase).get<ash::Transaction>();
+    BOOST_TEST(copy.extraNonce() == 1u);
+    BOOST_TEST(copy.id() == coinbase.id());
+}
+
 BOOST_AUTO_TEST_CASE(InsufficientFundsQueueTransactionTest)
 {
     auto chain = LoadBlockchain("blockchain1.json");
     BOOST_TEST(chain.size() == 1);
 
     auto [result, tx] = ash::CreateTransaction(chain, "1b3f78b45456dcfc3a2421da1d9961abd944b7e8a7c2ccc809a7ea92e200eeb1h",
-                                         "1Cus7TLessdAvkzN2BhK3WD3Ymru48X3z8", 1000000.0);
+                                         "1Cus7TLessdAvkzN2BhK3WD3Ymru48X3z8"_address, 1000000.0);
     BOOST_TEST((result == ash::TxResult::INSUFFICIENT_FUNDS));
     BOOST_TEST(tx.txIns().size() == 0);
     BOOST_TEST(tx.txOuts().size() == 0);
@@ -231,7 +771,7 @@ BOOST_AUTO_TEST_CASE(TxOutsEmptyQueueTransactionTest)
     BOOST_TEST(chain.size() == 1);
 
     auto [result, tx] = ash::CreateTransaction(chain, "362116d38976078659ae158f6c21bcda40f75d4a8aa7f0a4ffbe56a48cacb93h",
-                                         "1Cus7TLessdAvkzN2BhK3WD3Ymru48X3z8", 1000000.0);
+                                         "1Cus7TLessdAvkzN2BhK3WD3Ymru48X3z8"_address, 1000000.0);
     BOOST_TEST((result == ash::TxResult::TXOUTS_EMPTY));
     BOOST_TEST(tx.txIns().size() == 0);
     BOOST_TEST(tx.txOuts().size() == 0);
@@ -244,7 +784,7 @@ BOOST_AUTO_TEST_CASE(NOOPQueueTransactionTest)
     BOOST_TEST(chain.size() == 1);
 
     auto [result, tx] = ash::CreateTransaction(chain, "b2dfbfd974bcf876ac64a21aadab1cbb0b0350fb41115a3f61de3bd76c6485eah",
-                                         "1Cus7TLessdAvkzN2BhK3WD3Ymru48X3z8", 1000000.0);
+                                         "1Cus7TLessdAvkzN2BhK3WD3Ymru48X3z8"_address, 1000000.0);
     BOOST_TEST((result == ash::TxResult::NOOP_TRANSACTION));
     BOOST_TEST(tx.txIns().size() == 0);
     BOOST_TEST(tx.txOuts().size() == 0);
@@ -256,7 +796,7 @@ BOOST_AUTO_TEST_CASE(FindTransactionTest)
     const auto chain = LoadBlockchain("blockchain4.json");
     BOOST_TEST(chain.size() == 4);
 
-    auto tx1 = ash::FindTransaction(chain, "78348ae3273195a3b1d0fb974f608be165d8498cf6b333594a7b761e3e51f86d");
+    auto tx1 = ash::FindTransaction(chain, "78348ae3273195a3b1d0fb974f608be165d8498cf6b333594a7b761e3e51f86d"_hash);
     BOOST_TEST(tx1.has_value());
     auto [blockIndex, txIndex] = *tx1;
     BOOST_TEST(chain.size() > blockIndex);
@@ -273,10 +813,114 @@ BOOST_AUTO_TEST_CASE(NotFindTransactionTest)
     const auto chain = LoadBlockchain("blockchain4.json");
     BOOST_TEST(chain.size() == 4);
 
-    auto tx2 = ash::FindTransaction(chain, "THISTRANSACTIONDOESNOTEXIST");
+    auto tx2 = ash::FindTransaction(chain, ash::Hash256{ ash::crypto::SHA256Digest("THISTRANSACTIONDOESNOTEXIST") });
     BOOST_TEST(!tx2.has_value());
 }
 
+BOOST_AUTO_TEST_CASE(TxIndexTest)
+{
+    // every id of the first `count` blocks is found where it first
+    // appears and the ones after them are not
+    auto checkIndex =
+        [](const ash::Blockchain& chain, const ash::Blockchain& blocks, std::size_t count)
+        {
+            std::unordered_map<ash::Hash256, ash::TxPoint> expected;
+            for (auto blockidx = 0u; blockidx < count; blockidx++)
+            {
+                const auto& txs = blocks.at(blockidx).transactions();
+                for (auto txidx = 0u; txidx < txs.size(); txidx++)
+                {
+                    expected.emplace(txs[txidx].id(), ash::TxPoint{ blocks.at(blockidx).index(), txidx });
+                }
+            }
+
+            const auto& index = chain.transactionIndex();
+            for (auto blockidx = 0u; blockidx < blocks.size(); blockidx++)
+            {
+                for (const auto& tx : blocks.at(blockidx).transactions())
+                {
+                    const auto point = index.find(tx.id());
+                    if (blockidx < count)
+                    {
+                        BOOST_TEST((point == expected.at(tx.id())));
+                    }
+                    else
+                    {
+                        BOOST_TEST(!point.has_value());
+                    }
+                }
+            }
+
+            BOOST_TEST(index.size() == expected.size());
+        };
+
+    const auto original = LoadBlockchain("blockchain4.json");
+    BOOST_REQUIRE(original.size() == 4u);
+
+    // loaded from JSON and from the codec
+    auto chain = LoadBlockchain("blockchain4.json");
+    checkIndex(chain, original, 4);
+
+    ash::codec::Buffer buffer;
+    ash::codec::Writer writer{ buffer };
+    ash::write_blocks(writer, &original.front(), original.size());
+
+    ash::Blockchain decoded;
+    ash::codec::Reader reader{ buffer };
+    ash::read_blocks(reader, decoded, ash::codec::FORMAT_VERSION);
+    checkIndex(decoded, original, 4);
+
+    // the last block is disconnected, then most of the chain is
+    // dropped and the index is rebuilt from what is left
+    chain.resize(3);
+    checkIndex(chain, original, 3);
+
+    chain.resize(1);
+    checkIndex(chain, original, 1);
+
+    chain.clear();
+    BOOST_TEST(chain.transactionIndex().size() == 0u);
+    BOOST_TEST(!chain.transactionIndex().find(original.txAt(0, 0).id()).has_value());
+
+    const auto missing = ash::Hash256{ ash::crypto::SHA256Digest("THISTRANSACTIONDOESNOTEXIST") };
+    BOOST_TEST(!decoded.transactionIndex().find(missing).has_value());
+}
+
+BOOST_AUTO_TEST_CASE(TxIndexDuplicateTest)
+{
+    const auto chain = LoadBlockchain("blockchain4.json");
+
+    // transactions #2 and #3 of block #2 have the same id, the
+    // first one is the one that is found
+    BOOST_REQUIRE(chain.txAt(2, 2).id() == chain.txAt(2, 3).id());
+    BOOST_TEST((chain.transactionIndex().find(chain.txAt(2, 3).id()) == ash::TxPoint{ 2, 2 }));
+
+    // a later block with the same transactions keeps the earlier
+    // positions, and undoing it leaves them alone
+    const auto& first = chain.at(2);
+    ash::Transactions txs = first.transactions();
+    const ash::Block second{ 7, first.hash(), std::move(txs) };
+
+    ash::TxIndex index;
+    index.connect(first);
+    const auto size = index.size();
+
+    index.connect(second);
+    BOOST_TEST(index.size() == size);
+
+    const auto& txid = first.transactions().back().id();
+    const auto lastidx = first.transactions().size() - 1;
+    BOOST_TEST((index.find(txid) == ash::TxPoint{ 2, lastidx }));
+
+    index.disconnect(second);
+    BOOST_TEST(index.size() == size);
+    BOOST_TEST((index.find(txid) == ash::TxPoint{ 2, lastidx }));
+
+    index.disconnect(first);
+    BOOST_TEST(!index.find(txid).has_value());
+    BOOST_TEST(index.size() == 0u);
+}
+
 BOOST_AUTO_TEST_CASE(GetBlockDetailsTest)
 {
     constexpr auto TestBlockIndex = 3u;
@@ -302,9 +946,98 @@ BOOST_AUTO_TEST_CASE(GetBlockDetailsTest)
     BOOST_TEST(txOutPt2.txIndex == 5);
     BOOST_TEST(txOutPt2.txOutIndex == 0);
     BOOST_TEST(txOutPt2.address.has_value());
-    BOOST_TEST(boost::iequals(*(txOutPt2.address), "1Cus7TLessdAvkzN2BhK3WD3Ymru48X3z8"));
+    BOOST_TEST(txOutPt2.address->base58() == "1Cus7TLessdAvkzN2BhK3WD3Ymru48X3z8");
     BOOST_TEST(txOutPt2.amount.has_value());
     BOOST_TEST(*(txOutPt2.amount) == 0.003, boost::test_tools::tolerance(0.0001));
 }
 
+BOOST_AUTO_TEST_CASE(CodecRoundTripTest)
+{
+    const auto chain = LoadBlockchain("blockchain4.json");
+
+    ash::codec::Buffer buffer;
+    ash::codec::Writer writer{ buffer };
+    ash::write_blocks(writer, &chain.front(), chain.size());
+
+    ash::Blockchain copy;
+    ash::codec::Reader reader{ buffer };
+    ash::read_blocks(reader, copy, ash::codec::FORMAT_VERSION);
+    BOOST_TEST(reader.empty());
+
+    BOOST_TEST(copy.size() == chain.size());
+    BOOST_TEST(copy.isValidChain());
+    for (auto idx = 0u; idx < chain.size(); idx++)
+    {
+        const auto& original = chain.at(idx);
+        const auto& decoded = copy.at(idx);
+        BOOST_TEST(decoded == original);
+        BOOST_TEST(decoded.hash() == original.hash());
+        BOOST_TEST(decoded.previousHash() == original.previousHash());
+        BOOST_TEST(decoded.miner() == original.miner());
+        BOOST_TEST(decoded.transactions().size() == original.transactions().size());
+        BOOST_TEST((ash::EncodeBlock(decoded) == ash::EncodeBlock(original)));
+
+        for (auto txidx = 0u; txidx < original.transactions().size(); txidx++)
+        {
+            BOOST_TEST((decoded.transactions().at(txidx).hash()
+                == original.transactions().at(txidx).hash()));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(LegacyAddressTest)
+{
+    // an output paid to text that is not an address, which used to be
+    // accepted, loads with the same txid and block hash
+    auto chain = LoadBlockchain("blockchain2.json");
+
+    ash::Transaction tx;
+    tx.txIns().emplace_back(1, 0, 0, "signature");
+    tx.txOuts().emplace_back(ash::Address::FromText("my wallet"), 10.0);
+    tx.calcuateId(chain.size());
+
+    ash::Transactions txs;
+    txs.push_back(ash::CreateCoinbaseTransaction(chain.size(), "1LahaosvBaCG4EbDamyvuRmcrqc5P2iv7t"_address));
+    txs.push_back(tx);
+    const ash::Block block{ chain.size(), chain.back().hash(), std::move(txs) };
+    const auto hash = ash::CalculateBlockHash(block);
+
+    const auto fromJson = nl::json(block).get<ash::Block>();
+    BOOST_TEST(fromJson.transactions().at(1).txOuts().front().address().base58() == "my wallet");
+    BOOST_TEST(fromJson.transactions().at(1).id() == tx.id());
+    BOOST_TEST(ash::GetTransactionId(fromJson.transactions().at(1), chain.size()) == tx.id());
+    BOOST_TEST(ash::CalculateBlockHash(fromJson) == hash);
+
+    const auto encoded = ash::EncodeBlock(block);
+    ash::Block decoded;
+    ash::codec::Reader reader{ encoded };
+    ash::read_block(reader, decoded, ash::codec::FORMAT_VERSION);
+    BOOST_TEST(decoded.transactions().at(1).txOuts().front().address().base58() == "my wallet");
+    BOOST_TEST((ash::EncodeBlock(decoded) == encoded));
+    BOOST_TEST(ash::CalculateBlockHash(decoded) == hash);
+}
+
+BOOST_AUTO_TEST_CASE(CodecMalformedTest)
+{
+    const auto chain = LoadBlockchain("blockchain4.json");
+    const auto encoded = ash::EncodeBlock(chain.at(3));
+
+    // every truncation runs out of data instead of reading past it
+    for (auto size = 0u; size < encoded.size(); size++)
+    {
+        ash::Block block;
+        ash::codec::Reader reader{ { encoded.data(), size } };
+        BOOST_CHECK_THROW(ash::read_block(reader, block, ash::codec::FORMAT_VERSION), std::runtime_error);
+    }
+
+    ash::codec::Buffer frame;
+    ash::codec::Writer writer{ frame };
+    writer.u32(ash::codec::FORMAT_VERSION + 1);
+    writer.string("newblock");
+    writer.string("request");
+
+    ash::codec::Reader reader{ frame };
+    BOOST_CHECK_THROW(ash::codec::ReadFrameHeader(reader), std::runtime_error);
+}
+
 BOOST_AUTO_TEST_SUITE_END() // block
\ No newline at end of file
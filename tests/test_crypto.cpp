@@ -1,4 +1,5 @@
 #include <iterator>
+#include <sstream>
 
 #include <boost/test/unit_test.hpp>
 #include <boost/test/data/test_case.hpp>
@@ -9,15 +10,22 @@
 
 #include <nlohmann/json.hpp>
 
+#include "../src/BinaryCodec.h"
 #include "../src/Block.h"
 #include "../src/Blockchain.h"
 #include "../src/Miner.h"
 #include "../src/CryptoUtils.h"
+#include "../src/Hash256.h"
+#include "../src/HashWriter.h"
+#include "../src/MerkleTree.h"
+#include "../src/Sha256.h"
+#include "../src/SignatureCache.h"
 
 namespace nl = nlohmann;
 namespace data = boost::unit_test::data;
 
 using namespace std::string_view_literals;
+using namespace ash::literals;
 
 BOOST_AUTO_TEST_SUITE(crypto)
 
@@ -48,7 +56,363 @@ std::tuple<std::string,std::string> addressGenData[] =
 BOOST_DATA_TEST_CASE(addressGenTest, data::make(addressGenData), pk, expected)
 {
     const auto address = ash::crypto::GetAddressFromPrivateKey(pk);
-    BOOST_TEST(address == expected);
+    BOOST_TEST(address.base58() == expected);
+}
+
+BOOST_AUTO_TEST_CASE(leadingZeroNibblesTest)
+{
+    const auto digest = ash::crypto::DigestFromHex(
+        "000f1937b4b2b266578c2ade3f4bb416f763da5bb6f7f74ae1e0e0625495fd14");
+
+    BOOST_REQUIRE(digest.has_value());
+    BOOST_TEST(ash::crypto::HasLeadingZeroNibbles(*digest, 0));
+    BOOST_TEST(ash::crypto::HasLeadingZeroNibbles(*digest, 1));
+    BOOST_TEST(ash::crypto::HasLeadingZeroNibbles(*digest, 3));
+    BOOST_TEST(!ash::crypto::HasLeadingZeroNibbles(*digest, 4));
+    BOOST_TEST(!ash::crypto::HasLeadingZeroNibbles(*digest, 65));
+
+    ash::crypto::Digest zeros{};
+    BOOST_TEST(ash::crypto::HasLeadingZeroNibbles(zeros, 64));
+}
+
+BOOST_AUTO_TEST_CASE(digestHexTest)
+{
+    constexpr auto hex = "037d390cd4ef796e5d75407fa72cc4708aa8a1ba3c36ed88db6fd3a441b68503"sv;
+
+    const auto digest = ash::crypto::DigestFromHex(hex);
+    BOOST_REQUIRE(digest.has_value());
+    BOOST_TEST(ash::crypto::DigestToHex(*digest) == hex);
+    BOOST_TEST(*digest == ash::crypto::SHA256Digest("ash"));
+
+    BOOST_TEST(!ash::crypto::DigestFromHex("e41ad9").has_value());
+    BOOST_TEST(!ash::crypto::DigestFromHex(
+        "037D390CD4EF796E5D75407FA72CC4708AA8A1BA3C36ED88DB6FD3A441B68503").has_value());
+}
+
+BOOST_AUTO_TEST_CASE(hash256Test)
+{
+    constexpr auto hex = "037d390cd4ef796e5d75407fa72cc4708aa8a1ba3c36ed88db6fd3a441b68503"sv;
+    constexpr auto hash = "037d390cd4ef796e5d75407fa72cc4708aa8a1ba3c36ed88db6fd3a441b68503"_hash;
+    static_assert(hash.bytes()[0] == 0x03 && hash.bytes()[31] == 0x03);
+    static_assert(std::is_trivially_copyable_v<ash::Hash256>);
+
+    BOOST_TEST((hash == ash::Hash256{ ash::crypto::SHA256Digest("ash") }));
+    BOOST_TEST(hash.hex() == hex);
+    BOOST_TEST(fmt::format("{}", hash) == hex);
+    BOOST_TEST(nl::json(hash).get<std::string>() == hex);
+    BOOST_TEST((nl::json(hex).get<ash::Hash256>() == hash));
+
+    std::stringstream ss;
+    ss << hash;
+    BOOST_TEST(ss.str() == hex);
+
+    // the genesis block's previous hash
+    constexpr ash::Hash256 null;
+    BOOST_TEST(null.isNull());
+    BOOST_TEST(null.hex().empty());
+    BOOST_TEST((ash::Hash256::FromHex("") == null));
+    BOOST_TEST((null < hash));
+
+    BOOST_TEST(!ash::Hash256::FromHex("e41ad9").has_value());
+    BOOST_TEST(!ash::Hash256::FromHex(
+        "037D390CD4EF796E5D75407FA72CC4708AA8A1BA3C36ED88DB6FD3A441B68503").has_value());
+    BOOST_CHECK_THROW(nl::json("not a hash").get<ash::Hash256>(), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(addressTest)
+{
+    constexpr auto text = "1LahaosvBaCG4EbDamyvuRmcrqc5P2iv7t"sv;
+    const auto address = "1LahaosvBaCG4EbDamyvuRmcrqc5P2iv7t"_address;
+    static_assert(sizeof(ash::Address) == ash::Address::SIZE);
+    static_assert(std::is_trivially_copyable_v<ash::Address>);
+
+    BOOST_TEST(address.version() == ash::Address::PUBKEY_VERSION);
+    BOOST_TEST((address == ash::Address{ address.hash160() }));
+    BOOST_TEST((address == ash::crypto::GetAddressFromPrivateKey(
+        "1b3f78b45456dcfc3a2421da1d9961abd944b7e8a7c2ccc809a7ea92e200eeb1h")));
+    BOOST_TEST((address != "1Cus7TLessdAvkzN2BhK3WD3Ymru48X3z8"_address));
+
+    BOOST_TEST(address.base58() == text);
+    BOOST_TEST(fmt::format("{}", address) == text);
+    BOOST_TEST(nl::json(address).get<std::string>() == text);
+    BOOST_TEST((nl::json(text).get<ash::Address>() == address));
+
+    std::stringstream ss;
+    ss << address;
+    BOOST_TEST(ss.str() == text);
+
+    // a hash that starts with zero bytes still gets a single "1"
+    const ash::Address small{ ash::Address::Hash160{} };
+    BOOST_TEST(small.base58().substr(0, 2) != "11");
+    BOOST_TEST((ash::Address::FromBase58(small.base58()) == small));
+
+    const ash::Address null;
+    BOOST_TEST(null.isNull());
+    BOOST_TEST(null.base58().empty());
+    BOOST_TEST((ash::Address::FromBase58("") == null));
+
+    BOOST_TEST(!ash::Address::FromBase58("1LahaosvBaCG4EbDamyvuRmcrqc5P2iv7u").has_value());
+    BOOST_TEST(!ash::Address::FromBase58("11LahaosvBaCG4EbDamyvuRmcrqc5P2iv7t").has_value());
+    BOOST_TEST(!ash::Address::FromBase58("2LahaosvBaCG4EbDamyvuRmcrqc5P2iv7t").has_value());
+    BOOST_TEST(!ash::Address::FromBase58("1LahaosvBaCG4EbDamyvuRmcrqc5P2iv70").has_value());
+    BOOST_TEST(!ash::Address::FromBase58("1zzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzz").has_value());
+    BOOST_TEST(!address.isLegacy());
+
+    // text a chain paid to before addresses were checked is kept as it was
+    constexpr auto legacyText = "the wallet of a miner from before addresses were checked"sv;
+    const auto legacy = nl::json(legacyText).get<ash::Address>();
+    BOOST_TEST(legacy.isLegacy());
+    BOOST_TEST(!legacy.isNull());
+    BOOST_TEST(legacy.base58() == legacyText);
+    BOOST_TEST(fmt::format("{}", legacy) == legacyText);
+    BOOST_TEST(nl::json(legacy).get<std::string>() == legacyText);
+    BOOST_TEST((ash::Address::FromText(legacyText) == legacy));
+    BOOST_TEST((ash::Address::FromText("not an address") != legacy));
+    BOOST_TEST((ash::Address::FromText(text) == address));
+    BOOST_TEST(!ash::Address::FromBase58(legacyText).has_value());
+}
+
+// 96 byte messages padded into two SHA-256 blocks like a v2 header
+std::array<std::uint8_t, 128> MakePaddedMessage(std::uint8_t seed)
+{
+    std::array<std::uint8_t, 128> retval{};
+    for (auto idx = 0u; idx < 96u; idx++)
+    {
+        retval[idx] = static_cast<std::uint8_t>(seed + idx * 7);
+    }
+
+    retval[96] = 0x80;
+    retval[126] = 0x03; // 768 bits
+    return retval;
+}
+
+std::string_view MessageView(const std::array<std::uint8_t, 128>& message)
+{
+    return { reinterpret_cast<const char*>(message.data()), 96 };
+}
+
+BOOST_AUTO_TEST_CASE(sha256KernelTest)
+{
+    using namespace ash::crypto;
+
+    for (const auto kernel : GetAvailableSha256Kernels())
+    {
+        BOOST_TEST_CONTEXT("kernel " << kernel->name)
+        {
+            // an uneven count leaves some lanes unused
+            constexpr std::size_t count = 11;
+            std::vector<std::array<std::uint8_t, 128>> messages;
+            std::vector<Sha256State> states(count, SHA256_INITIAL_STATE);
+            std::vector<const std::uint8_t*> blocks;
+
+            for (auto idx = 0u; idx < count; idx++)
+            {
+                messages.push_back(MakePaddedMessage(static_cast<std::uint8_t>(idx)));
+            }
+
+            for (auto offset : { 0u, 64u })
+            {
+                blocks.clear();
+                for (const auto& message : messages)
+                {
+                    blocks.push_back(message.data() + offset);
+                }
+
+                kernel->compress(states.data(), blocks.data(), count);
+            }
+
+            for (auto idx = 0u; idx < count; idx++)
+            {
+                BOOST_TEST(Sha256StateToDigest(states[idx]) == SHA256Digest(MessageView(messages[idx])));
+            }
+
+            // nonces that carry into the upper 32 bits
+            auto message = MakePaddedMessage(42);
+            auto midstate = SHA256_INITIAL_STATE;
+            const std::uint8_t* first = message.data();
+            kernel->compress(&midstate, &first, 1);
+
+            constexpr std::uint64_t start = 0xfffffff0;
+            std::array<Digest, 37> digests;
+            kernel->hashNonces(midstate, message.data() + 64, 24, start, digests.size(), digests.data());
+
+            for (auto idx = 0u; idx < digests.size(); idx++)
+            {
+                const auto nonce = start + idx;
+                for (auto byte = 0u; byte < 8u; byte++)
+                {
+                    message[88 + byte] = static_cast<std::uint8_t>(nonce >> (byte * 8));
+                }
+
+                BOOST_TEST(digests[idx] == SHA256Digest(MessageView(message)));
+            }
+        }
+    }
+}
+
+ash::Transactions CreateMerkleTransactions(std::size_t count)
+{
+    ash::Transactions txs;
+    for (auto idx = 0u; idx < count; idx++)
+    {
+        txs.push_back(ash::CreateCoinbaseTransaction(idx + 1, "1LahaosvBaCG4EbDamyvuRmcrqc5P2iv7t"_address));
+    }
+
+    return txs;
+}
+
+BOOST_AUTO_TEST_CASE(merkleRootTest)
+{
+    BOOST_TEST((ash::CalculateMerkleRoot({}) == ash::crypto::Digest{}));
+
+    const auto txs = CreateMerkleTransactions(3);
+    BOOST_TEST((ash::CalculateMerkleRoot({ txs[0] }) == txs[0].hash()));
+
+    // the third leaf has no sibling so it moves up as it is
+    auto concat =
+        [](const ash::crypto::Digest& left, const ash::crypto::Digest& right)
+        {
+            std::string retval(left.begin(), left.end());
+            retval.append(right.begin(), right.end());
+            return retval;
+        };
+
+    const auto left = ash::crypto::SHA256Digest(concat(txs[0].hash(), txs[1].hash()));
+    const auto root = ash::crypto::SHA256Digest(concat(left, txs[2].hash()));
+    BOOST_TEST((ash::CalculateMerkleRoot(txs) == root));
+}
+
+BOOST_AUTO_TEST_CASE(merkleTreeUpdateTest)
+{
+    auto txs = CreateMerkleTransactions(17);
+
+    ash::MerkleTree tree;
+    for (auto idx = 0u; idx < txs.size(); idx++)
+    {
+        tree.append(txs[idx].hash());
+
+        const ash::Transactions prefix(txs.begin(), txs.begin() + idx + 1);
+        BOOST_TEST(tree.size() == prefix.size());
+        BOOST_TEST((tree.root() == ash::CalculateMerkleRoot(prefix)));
+    }
+
+    for (auto idx : { 0u, 7u, 16u })
+    {
+        txs[idx].setExtraNonce(idx + 100);
+        tree.update(idx, txs[idx].hash());
+        BOOST_TEST((tree.root() == ash::CalculateMerkleRoot(txs)));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(transactionHashTest)
+{
+    auto tx = ash::CreateCoinbaseTransaction(5, "1LahaosvBaCG4EbDamyvuRmcrqc5P2iv7t"_address);
+    const auto original = tx.hash();
+    BOOST_TEST((original == ash::CalculateTransactionHash(tx)));
+
+    // the hash follows changes made through a reference that was
+    // taken before it was last asked for
+    auto& txouts = tx.txOuts();
+    BOOST_TEST((tx.hash() == original));
+    txouts.front() = ash::TxOut{ "1Cus7TLessdAvkzN2BhK3WD3Ymru48X3z8"_address, 1.0 };
+    BOOST_TEST((tx.hash() != original));
+    BOOST_TEST((tx.hash() == ash::CalculateTransactionHash(tx)));
+
+    const auto copy = nl::json(tx).get<ash::Transaction>();
+    BOOST_TEST((copy.hash() == tx.hash()));
+}
+
+BOOST_AUTO_TEST_CASE(hashWriterCompatTest)
+{
+    // the text must be what the old std::stringstream produced
+    const std::vector<double> amounts{ 57.0, 0.003, 10.5, 1.0 / 3.0, 1234567.0, 1e-7, 0.0, -2.25 };
+    for (const auto amount : amounts)
+    {
+        std::stringstream ss;
+        ss << std::uint64_t{ 18446744073709551615u } << std::int64_t{ -1609459200000 }
+            << "1LahaosvBaCG4EbDamyvuRmcrqc5P2iv7t" << amount << std::uint32_t{ 7 };
+
+        ash::crypto::HashWriter writer{ ash::crypto::HashWriter::Mode::COMPAT };
+        writer << std::uint64_t{ 18446744073709551615u } << std::int64_t{ -1609459200000 }
+            << "1LahaosvBaCG4EbDamyvuRmcrqc5P2iv7t" << amount << std::uint32_t{ 7 };
+
+        BOOST_TEST((writer.digest() == ash::crypto::SHA256Digest(ss.str())));
+    }
+
+    const auto tx = ash::CreateCoinbaseTransaction(12, "1LahaosvBaCG4EbDamyvuRmcrqc5P2iv7t"_address);
+    BOOST_TEST(tx.id().hex() == ash::crypto::SHA256("1200" "1LahaosvBaCG4EbDamyvuRmcrqc5P2iv7t" "57" "12"));
+}
+
+BOOST_AUTO_TEST_CASE(hashWriterBinaryTest)
+{
+    // binary mode hashes the same bytes the codec writes
+    ash::codec::Buffer buffer;
+    ash::codec::Writer codec{ buffer };
+    codec.u64(42);
+    codec.string("block data");
+    codec.f64(0.003);
+    codec.u32(7);
+
+    ash::crypto::HashWriter writer{ ash::crypto::HashWriter::Mode::BINARY };
+    writer << std::uint64_t{ 42 } << "block data" << 0.003 << std::uint32_t{ 7 };
+
+    const std::string_view bytes{ reinterpret_cast<const char*>(buffer.data()), buffer.size() };
+    BOOST_TEST((writer.digest() == ash::crypto::SHA256Digest(bytes)));
+}
+
+BOOST_AUTO_TEST_CASE(signDigestTest)
+{
+    constexpr auto privateKey = "1b3f78b45456dcfc3a2421da1d9961abd944b7e8a7c2ccc809a7ea92e200eeb1h"sv;
+
+    const auto publicKey = ash::crypto::GetPublicKey(privateKey);
+    BOOST_TEST((ash::crypto::GetAddressFromPublicKey(publicKey)
+        == ash::crypto::GetAddressFromPrivateKey(privateKey)));
+    BOOST_TEST(!ash::crypto::GetAddressFromPublicKey("publickey").has_value());
+
+    const auto digest = ash::crypto::SHA256Digest("ash");
+    const auto signature = ash::crypto::SignDigest(privateKey, digest);
+    BOOST_TEST(signature.size() == 128u);
+    BOOST_TEST(ash::crypto::VerifyDigest(publicKey, digest, signature));
+
+    BOOST_TEST(!ash::crypto::VerifyDigest(publicKey, ash::crypto::SHA256Digest("ash!"), signature));
+    BOOST_TEST(!ash::crypto::VerifyDigest(
+        ash::crypto::GetPublicKey("362116d38976078659ae158f6c21bcda40f75d4a8aa7f0a4ffbe56a48cacb93h"),
+        digest, signature));
+
+    auto tampered = signature;
+    tampered[10] = tampered[10] == '0' ? '1' : '0';
+    BOOST_TEST(!ash::crypto::VerifyDigest(publicKey, digest, tampered));
+    BOOST_TEST(!ash::crypto::VerifyDigest(publicKey, digest, signature.substr(2)));
+    BOOST_TEST(!ash::crypto::VerifyDigest(publicKey, digest, "signature"));
+    BOOST_TEST(!ash::crypto::VerifyDigest(publicKey.substr(2), digest, signature));
+}
+
+BOOST_AUTO_TEST_CASE(signatureCacheTest)
+{
+    const auto sighash = ash::crypto::SHA256Digest("tx");
+    const auto first = ash::SignatureCache::MakeKey(sighash, 0, "1LahaosvBaCG4EbDamyvuRmcrqc5P2iv7t"_address, "sig");
+    const auto second = ash::SignatureCache::MakeKey(sighash, 1, "1LahaosvBaCG4EbDamyvuRmcrqc5P2iv7t"_address, "sig");
+    const auto third = ash::SignatureCache::MakeKey(sighash, 0, "1Cus7TLessdAvkzN2BhK3WD3Ymru48X3z8"_address, "sig");
+    BOOST_TEST((first != second));
+    BOOST_TEST((first != third));
+
+    // the oldest entry goes first
+    ash::SignatureCache cache{ 2 };
+    cache.insert(first);
+    cache.insert(second);
+    cache.insert(first);
+    BOOST_TEST(cache.size() == 2u);
+
+    cache.insert(third);
+    BOOST_TEST(cache.size() == 2u);
+    BOOST_TEST(!cache.contains(first));
+    BOOST_TEST(cache.contains(second));
+    BOOST_TEST(cache.contains(third));
+
+    cache.setCapacity(0);
+    BOOST_TEST(cache.size() == 0u);
+    cache.insert(first);
+    BOOST_TEST(!cache.contains(first));
 }
 
 BOOST_AUTO_TEST_SUITE_END() // crypto
\ No newline at end of file
@@ -0,0 +1,411 @@
+#include <limits>
+#include <optional>
+#include <numeric>
+#include <thread>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/data/test_case.hpp>
+
+#include "../src/Block.h"
+#include "../src/BlockHeader.h"
+#include "../src/ChainTip.h"
+#include "../src/HashRate.h"
+#include "../src/Miner.h"
+#include "../src/MiningScheduler.h"
+#include "../src/Transactions.h"
+
+namespace data = boost::unit_test::data;
+
+using namespace ash::literals;
+
+const auto TestAddress = "1LahaosvBaCG4EbDamyvuRmcrqc5P2iv7t"_address;
+constexpr auto TestPrevHash = "e41ad9e82072e708d4e58512dbc7e7dad72daf1dfbf9ab5c547fbd82f5a49824"_hash;
+
+ash::Block CreateTestBlock(std::uint64_t index)
+{
+    ash::Transactions txs;
+    txs.push_back(ash::CreateCoinbaseTransaction(index, TestAddress));
+    ash::Block block{ index, TestPrevHash, std::move(txs) };
+    block.setData(fmt::format("test block #{}", index));
+    return block;
+}
+
+BOOST_AUTO_TEST_SUITE(miner)
+
+const std::uint32_t threadCounts[] = { 1, 2, 4 };
+
+BOOST_DATA_TEST_CASE(MultiThreadMineTest, data::make(threadCounts), threads)
+{
+    auto block = CreateTestBlock(1);
+
+    ash::Miner miner{ 2 };
+    miner.setThreadCount(threads);
+    BOOST_TEST(miner.threadCount() == threads);
+
+    auto result = miner.mineBlock(block, [](std::uint64_t) { return true; });
+    BOOST_TEST(result == ash::Miner::SUCCESS);
+    BOOST_TEST(block.difficulty() == 2);
+    BOOST_TEST(block.hash().hex().substr(0, 2) == "00");
+    BOOST_TEST(ash::ValidHash(block));
+}
+
+BOOST_DATA_TEST_CASE(MultiThreadAbortTest, data::make(threadCounts), threads)
+{
+    auto block = CreateTestBlock(1);
+
+    // a difficulty this high will not be solved before the callback
+    // tells the miner to stop
+    ash::Miner miner{ 32 };
+    miner.setThreadCount(threads);
+
+    auto result = miner.mineBlock(block, [](std::uint64_t) { return false; });
+    BOOST_TEST(result == ash::Miner::ABORT);
+    BOOST_TEST(block.nonce() == 0);
+}
+
+BOOST_DATA_TEST_CASE(StaleTipTest, data::make(threadCounts), threads)
+{
+    auto block = CreateTestBlock(7);
+
+    ash::ChainTip tip;
+    ash::Miner miner{ 64 };
+    miner.setThreadCount(threads);
+    miner.setChainTip(&tip);
+
+    // a block that is already behind the tip is never mined
+    tip.publish(7);
+    BOOST_TEST(miner.mineBlock(block) == ash::Miner::STALE);
+
+    // a tip behind the block doesn't stop anything until it catches up
+    tip.publish(6);
+    std::thread publisher{
+        [&tip]()
+        {
+            std::this_thread::sleep_for(50ms);
+            tip.publish(5);
+            std::this_thread::sleep_for(50ms);
+            tip.publish(8);
+        }};
+
+    const auto start = std::chrono::steady_clock::now();
+    BOOST_TEST(miner.mineBlock(block) == ash::Miner::STALE);
+    publisher.join();
+
+    BOOST_TEST((std::chrono::steady_clock::now() - start >= 100ms));
+
+    const auto stats = miner.staleStats();
+    BOOST_TEST(stats.count == 2u);
+    BOOST_TEST((stats.max >= stats.last));
+    BOOST_TEST((stats.last < 1s));
+}
+
+BOOST_AUTO_TEST_CASE(QueuedTipTest)
+{
+    auto block = CreateTestBlock(7);
+
+    ash::ChainTip tip;
+    ash::Miner miner{ 64 };
+    miner.setChainTip(&tip);
+    tip.publish(6);
+
+    // a peer's chain that reaches the block stops it before the
+    // chain is adopted, and the local tip stays where it is
+    tip.queue(7);
+    BOOST_TEST(tip.height() == 6u);
+    BOOST_TEST(tip.queued() == 7u);
+    BOOST_TEST(miner.mineBlock(block) == ash::Miner::STALE);
+
+    // adopting or dropping the chain publishes the local tip
+    tip.publish(6);
+    BOOST_TEST(tip.queued() == 0u);
+}
+
+BOOST_AUTO_TEST_CASE(ReplacedParentTest)
+{
+    auto block = CreateTestBlock(7);
+    constexpr auto otherHash = "00000a0b77b3bbc2e2ff2c2b1a1af6cd17c7e5a9d5d83b0ee7d0a2c34d2ea9d1"_hash;
+
+    ash::ChainTip tip;
+    ash::Miner miner{ 64 };
+    miner.setChainTip(&tip);
+
+    // a chain of the same height with another last block
+    tip.publish(6, otherHash);
+    BOOST_TEST(!tip.extends(7, TestPrevHash));
+    BOOST_TEST(miner.mineBlock(block) == ash::Miner::STALE);
+
+    // the block's parent is the tip until a peer's chain replaces it
+    tip.publish(6, TestPrevHash);
+    BOOST_TEST(tip.extends(7, TestPrevHash));
+    std::thread publisher{
+        [&tip, otherHash]()
+        {
+            std::this_thread::sleep_for(50ms);
+            tip.publish(6, otherHash);
+        }};
+
+    BOOST_TEST(miner.mineBlock(block) == ash::Miner::STALE);
+    publisher.join();
+}
+
+BOOST_AUTO_TEST_CASE(ThreadHashCountTest)
+{
+    ash::Miner miner{ 2 };
+    miner.setThreadCount(2);
+
+    std::uint64_t expected = 0;
+    for (auto index = 1u; index < 4u; index++)
+    {
+        auto block = CreateTestBlock(index);
+        BOOST_TEST(miner.mineBlock(block) == ash::Miner::SUCCESS);
+        expected += miner.hashCount();
+    }
+
+    // the thread counters keep running across blocks
+    const auto counts = miner.threadHashCounts();
+    BOOST_TEST(counts.size() == 2u);
+    BOOST_TEST(std::accumulate(counts.begin(), counts.end(), std::uint64_t{ 0 }) == expected);
+}
+
+BOOST_AUTO_TEST_CASE(HashRateMeterTest)
+{
+    using namespace std::chrono;
+
+    ash::HashRateMeter meter;
+    const auto start = ash::HashRateMeter::Clock::now();
+
+    meter.sample({ 0, 0 }, start);
+    BOOST_TEST(meter.rates().second == 0.0);
+
+    // the first interval primes every window
+    meter.sample({ 600, 400 }, start + 1s);
+    auto rates = meter.rates();
+    BOOST_TEST(rates.second == 1000.0);
+    BOOST_TEST(rates.minute == 1000.0);
+    BOOST_TEST(rates.quarter == 1000.0);
+    BOOST_TEST(rates.threads.size() == 2u);
+    BOOST_TEST(rates.threads[0] == 600.0);
+
+    // the shorter windows follow a change in rate faster
+    meter.sample({ 2600, 2400 }, start + 2s);
+    rates = meter.rates();
+    BOOST_TEST(rates.second > rates.minute);
+    BOOST_TEST(rates.minute > rates.quarter);
+    BOOST_TEST(rates.quarter > 1000.0);
+    BOOST_TEST(rates.second < 4000.0);
+    BOOST_TEST(rates.threads[1] == 2000.0);
+
+    BOOST_TEST(ash::FormatHashRate(1234567.0) == "1.23 MH/s");
+    BOOST_TEST(ash::FormatHashRate(12.0) == "12.00 H/s");
+}
+
+BOOST_AUTO_TEST_CASE(CpuSetTest)
+{
+    using Cpus = std::vector<std::uint32_t>;
+
+    BOOST_TEST(ash::ParseCpuSet("") == Cpus{});
+    BOOST_TEST(ash::ParseCpuSet("3") == Cpus{ 3 });
+    BOOST_TEST(ash::ParseCpuSet("0-3,6") == (Cpus{ 0, 1, 2, 3, 6 }));
+    BOOST_TEST(ash::ParseCpuSet("6,1-2") == (Cpus{ 6, 1, 2 }));
+
+    BOOST_CHECK_THROW(ash::ParseCpuSet("a"), std::invalid_argument);
+    BOOST_CHECK_THROW(ash::ParseCpuSet("1,,2"), std::invalid_argument);
+    BOOST_CHECK_THROW(ash::ParseCpuSet("3-1"), std::invalid_argument);
+    BOOST_CHECK_THROW(ash::ParseCpuSet("1-"), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(SchedulerThrottleTest)
+{
+    ash::MiningScheduler scheduler;
+
+    // no budget, never throttled
+    scheduler.recordLatency(10s);
+    {
+        const auto busy = scheduler.busy();
+        BOOST_TEST(!scheduler.throttled());
+    }
+
+    scheduler.setLatencyBudget(50ms);
+    scheduler.recordLatency(10ms);
+    BOOST_TEST(!scheduler.throttled());
+
+    {
+        const auto busy = scheduler.busy();
+        BOOST_TEST(scheduler.throttled());
+    }
+
+    BOOST_TEST(!scheduler.throttled());
+    scheduler.recordLatency(60ms);
+    BOOST_TEST(scheduler.throttled());
+    BOOST_TEST(scheduler.overBudgetCount() == 1u);
+}
+
+BOOST_AUTO_TEST_CASE(ThrottledMinerTest)
+{
+    auto block = CreateTestBlock(1);
+
+    ash::MiningScheduler scheduler;
+    scheduler.setCpus({ 0 });
+    scheduler.setLatencyBudget(1ms);
+
+    ash::Miner miner{ 1 };
+    miner.setThreadCount(2);
+    miner.setScheduler(&scheduler);
+
+    // a busy node holds the miner back
+    std::optional<ash::MiningScheduler::BusyScope> busy{ std::in_place, scheduler };
+    std::thread releaser{ [&busy]() { std::this_thread::sleep_for(20ms); busy.reset(); } };
+
+    const auto start = std::chrono::steady_clock::now();
+    BOOST_TEST(miner.mineBlock(block) == ash::Miner::SUCCESS);
+    BOOST_TEST((std::chrono::steady_clock::now() - start >= 20ms));
+    BOOST_TEST(ash::ValidHash(block));
+
+    releaser.join();
+}
+
+BOOST_AUTO_TEST_CASE(AllCoresThreadCountTest)
+{
+    ash::Miner miner;
+    miner.setThreadCount(0);
+    BOOST_TEST(miner.threadCount() > 0);
+}
+
+struct HeaderV2Fixture
+{
+    HeaderV2Fixture() { ash::SetHeaderV2Height(5); }
+    ~HeaderV2Fixture() { ash::SetHeaderV2Height(std::numeric_limits<std::uint64_t>::max()); }
+};
+
+BOOST_FIXTURE_TEST_CASE(HeaderVersionTest, HeaderV2Fixture)
+{
+    BOOST_TEST(ash::BlockHeaderVersion(4) == ash::BLOCK_HEADER_V1);
+    BOOST_TEST(ash::BlockHeaderVersion(5) == ash::BLOCK_HEADER_V2);
+    BOOST_TEST(ash::BlockHeaderVersion(6) == ash::BLOCK_HEADER_V2);
+}
+
+BOOST_FIXTURE_TEST_CASE(HeaderMidstateTest, HeaderV2Fixture)
+{
+    auto block = CreateTestBlock(5);
+
+    ash::BlockHeaderHasher hasher{ block, block.difficulty(), block.time() };
+    for (auto nonce = 0u; nonce < 16u; nonce++)
+    {
+        block.setMinedData(nonce, block.difficulty(), block.time(), {});
+        const auto expected = ash::CalculateBlockHeaderHash(ash::MakeBlockHeader(block));
+        BOOST_TEST(ash::Hash256{ hasher.digest(nonce) } == expected);
+        BOOST_TEST(ash::CalculateBlockHash(block) == expected);
+    }
+
+    const auto later = block.time() + std::chrono::milliseconds{ 1500 };
+    hasher.setTime(later);
+    block.setMinedData(3, block.difficulty(), later, {});
+    BOOST_TEST(ash::Hash256{ hasher.digest(3) } == ash::CalculateBlockHash(block));
+}
+
+BOOST_FIXTURE_TEST_CASE(HeaderBatchDigestTest, HeaderV2Fixture)
+{
+    std::vector<ash::Block> blocks;
+    for (auto index = 3u; index < 8u; index++)
+    {
+        blocks.push_back(CreateTestBlock(index));
+    }
+
+    for (auto& block : blocks)
+    {
+        ash::BlockHeaderHasher hasher{ block, block.difficulty(), block.time() };
+
+        std::array<ash::crypto::Digest, 19> digests;
+        hasher.digests(100, digests.size(), digests.data());
+        for (auto idx = 0u; idx < digests.size(); idx++)
+        {
+            BOOST_TEST(digests[idx] == hasher.digest(100 + idx));
+        }
+    }
+
+    const auto digests = ash::CalculateBlockDigests(blocks.data(), blocks.size());
+    BOOST_REQUIRE(digests.size() == blocks.size());
+    for (auto idx = 0u; idx < blocks.size(); idx++)
+    {
+        BOOST_TEST(digests[idx] == ash::CalculateBlockDigest(blocks[idx]));
+    }
+}
+
+BOOST_DATA_TEST_CASE_F(HeaderV2Fixture, MinerRefreshTest, data::make(threadCounts), threads)
+{
+    auto block = CreateTestBlock(5);
+
+    ash::Miner miner{ 3 };
+    miner.setThreadCount(threads);
+
+    // the first refresh adds a transaction, later ones find nothing new
+    std::uint32_t refreshes = 0;
+    miner.setRefreshFunc(
+        [&refreshes](ash::Block& block) -> std::optional<ash::BlockCommitment>
+        {
+            if (refreshes++ > 0)
+            {
+                return std::nullopt;
+            }
+
+            auto& txs = block.transactions();
+            txs.push_back(ash::CreateCoinbaseTransaction(block.index(), "1Cus7TLessdAvkzN2BhK3WD3Ymru48X3z8"_address));
+            return ash::CalculateBlockCommitment(block);
+        });
+
+    BOOST_TEST(miner.mineBlock(block) == ash::Miner::SUCCESS);
+    BOOST_TEST(refreshes > 0u);
+    BOOST_TEST(block.transactions().size() == 2u);
+    BOOST_TEST(ash::ValidHash(block));
+}
+
+BOOST_FIXTURE_TEST_CASE(HeaderCommitmentTest, HeaderV2Fixture)
+{
+    auto block = CreateTestBlock(5);
+    ash::BlockHeaderHasher hasher{ block, block.difficulty(), block.time() };
+
+    auto& coinbase = block.transactions().front();
+    coinbase.setExtraNonce(7);
+    coinbase.calcuateId(block.index());
+
+    hasher.setCommitment(ash::CalculateBlockCommitment(block));
+    block.setMinedData(11, block.difficulty(), block.time(), {});
+    BOOST_TEST(ash::Hash256{ hasher.digest(11) } == ash::CalculateBlockHash(block));
+}
+
+BOOST_AUTO_TEST_CASE(HeaderV1HasherTest)
+{
+    auto block = CreateTestBlock(3);
+    const auto extra = ash::crypto::SHA256(nl::json(block.transactions()).dump());
+
+    ash::BlockHeaderHasher hasher{ block, 4, block.time() };
+    for (std::uint64_t nonce : { 0ull, 1ull, 9ull, 10ull, 123456789ull, 0xffffffffffffffffull })
+    {
+        const auto expected = ash::CalculateBlockHash(block.index(), nonce, 4,
+            block.time(), block.data(), block.previousHash(), extra);
+
+        BOOST_TEST(ash::Hash256{ hasher.digest(nonce) } == expected);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(HeaderV2MineTest, HeaderV2Fixture)
+{
+    auto v1block = CreateTestBlock(4);
+    auto v2block = CreateTestBlock(5);
+
+    ash::Miner miner{ 2 };
+    miner.setThreadCount(2);
+
+    BOOST_TEST(miner.mineBlock(v1block) == ash::Miner::SUCCESS);
+    BOOST_TEST(miner.mineBlock(v2block) == ash::Miner::SUCCESS);
+
+    BOOST_TEST(ash::ValidHash(v1block));
+    BOOST_TEST(ash::ValidHash(v2block));
+
+    // the same block hashed with the other header format gets another
+    // hash. Whether that one happens to meet the difficulty is chance
+    ash::SetHeaderV2Height(6);
+    BOOST_TEST(ash::CalculateBlockHash(v2block) != v2block.hash());
+}
+
+BOOST_AUTO_TEST_SUITE_END() // miner
@@ -0,0 +1,144 @@
+#include <fstream>
+#include <streambuf>
+
+#include <boost/test/unit_test.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <test-config.h>
+
+#include "../src/Block.h"
+#include "../src/BlockHeader.h"
+#include "../src/Blockchain.h"
+#include "../src/ChainTip.h"
+#include "../src/WorkManager.h"
+
+namespace nl = nlohmann;
+
+using namespace ash::literals;
+
+const auto WorkAddress = "1LahaosvBaCG4EbDamyvuRmcrqc5P2iv7t"_address;
+constexpr std::uint64_t WorkNonceRange = 1u << 16;
+
+ash::Blockchain LoadWorkBlockchain(std::string_view chainfile)
+{
+    const std::string filename = fmt::format("{}/tests/data/{}", ASH_SRC_DIRECTORY, chainfile);
+    std::ifstream t(filename);
+    const std::string rawjson((std::istreambuf_iterator<char>(t)), std::istreambuf_iterator<char>());
+
+    nl::json json = nl::json::parse(rawjson, nullptr, false);
+    BOOST_REQUIRE(!json.is_discarded());
+    return json["blocks"].get<ash::Blockchain>();
+}
+
+// brute forces the job the way an external miner would
+std::optional<std::uint64_t> SolveWork(const nl::json& work)
+{
+    const auto block = work["block"].get<ash::Block>();
+    const auto difficulty = work["difficulty"].get<std::uint64_t>();
+
+    ash::BlockHeaderHasher hasher{ block, difficulty, block.time() };
+    for (auto nonce = work["noncestart"].get<std::uint64_t>();
+            nonce < work["nonceend"].get<std::uint64_t>(); nonce++)
+    {
+        if (ash::crypto::HasLeadingZeroNibbles(hasher.digest(nonce), difficulty))
+        {
+            return nonce;
+        }
+    }
+
+    return std::nullopt;
+}
+
+BOOST_AUTO_TEST_SUITE(work)
+
+BOOST_AUTO_TEST_CASE(GetWorkTest)
+{
+    auto chain = LoadWorkBlockchain("blockchain1.json");
+    ash::ChainTip tip;
+    tip.publish(chain.back().index());
+
+    ash::WorkManager manager{ WorkAddress, "test", WorkNonceRange };
+    const auto first = manager.getWork(chain, tip);
+    const auto second = manager.getWork(chain, tip);
+
+    // one template, two slices of its nonce space
+    BOOST_TEST(first["index"].get<std::uint64_t>() == chain.size());
+    BOOST_TEST(first["block"] == second["block"]);
+    BOOST_TEST(first["jobid"].get<std::uint64_t>() != second["jobid"].get<std::uint64_t>());
+    BOOST_TEST(first["nonceend"].get<std::uint64_t>() - first["noncestart"].get<std::uint64_t>() == WorkNonceRange);
+    BOOST_TEST(second["noncestart"].get<std::uint64_t>() == first["nonceend"].get<std::uint64_t>());
+
+    const auto difficulty = first["difficulty"].get<std::size_t>();
+    const auto target = first["target"].get<std::string>();
+    BOOST_TEST(target.size() == 64u);
+    BOOST_TEST(target.find_first_not_of('0') == difficulty);
+}
+
+BOOST_AUTO_TEST_CASE(SubmitWorkTest)
+{
+    auto chain = LoadWorkBlockchain("blockchain1.json");
+    ash::ChainTip tip;
+    tip.publish(chain.back().index());
+
+    ash::WorkManager manager{ WorkAddress, "test", WorkNonceRange };
+    const auto work = manager.getWork(chain, tip);
+    const auto jobId = work["jobid"].get<std::uint64_t>();
+
+    const auto nonce = SolveWork(work);
+    BOOST_REQUIRE(nonce.has_value());
+
+    auto [unknown, unknownBlock] = manager.submitWork(chain, tip, jobId + 100, *nonce);
+    BOOST_TEST((unknown == ash::WorkResult::UNKNOWN_JOB));
+
+    auto [outside, outsideBlock] = manager.submitWork(chain, tip, jobId, work["nonceend"].get<std::uint64_t>());
+    BOOST_TEST((outside == ash::WorkResult::NONCE_OUT_OF_RANGE));
+
+    auto [accepted, block] = manager.submitWork(chain, tip, jobId, *nonce);
+    BOOST_TEST((accepted == ash::WorkResult::ACCEPTED));
+    BOOST_REQUIRE(block.has_value());
+    BOOST_TEST(block->nonce() == *nonce);
+    BOOST_TEST(ash::ValidHash(*block));
+    BOOST_TEST(chain.size() == 2u);
+    BOOST_TEST(chain.back().hash() == block->hash());
+
+    // the height has been solved
+    auto [again, againBlock] = manager.submitWork(chain, tip, jobId, *nonce);
+    BOOST_TEST((again == ash::WorkResult::STALE_JOB));
+}
+
+BOOST_AUTO_TEST_CASE(StaleWorkTest)
+{
+    auto chain = LoadWorkBlockchain("blockchain1.json");
+    ash::ChainTip tip;
+    tip.publish(chain.back().index());
+
+    auto [txresult, tx] = ash::CreateTransaction(chain,
+        "1b3f78b45456dcfc3a2421da1d9961abd944b7e8a7c2ccc809a7ea92e200eeb1h",
+        "1Cus7TLessdAvkzN2BhK3WD3Ymru48X3z8"_address, 10.0);
+    BOOST_REQUIRE((txresult == ash::TxResult::SUCCESS));
+    chain.queueTransaction(std::move(tx));
+
+    ash::WorkManager manager{ WorkAddress, "test", WorkNonceRange };
+    const auto work = manager.getWork(chain, tip);
+    BOOST_TEST(work["block"]["transactions"].size() == 2u);
+    BOOST_TEST(chain.transactionQueueSize() == 0u);
+
+    const auto nonce = SolveWork(work);
+    BOOST_REQUIRE(nonce.has_value());
+
+    // a peer's chain reached the same height
+    tip.publish(chain.size());
+
+    auto [stale, staleBlock] = manager.submitWork(chain, tip, work["jobid"].get<std::uint64_t>(), *nonce);
+    BOOST_TEST((stale == ash::WorkResult::STALE_JOB));
+    BOOST_TEST(chain.size() == 1u);
+
+    // the next template picks the requeued transaction back up
+    const auto next = manager.getWork(chain, tip);
+    BOOST_TEST(next["jobid"].get<std::uint64_t>() > work["jobid"].get<std::uint64_t>());
+    BOOST_TEST(next["noncestart"].get<std::uint64_t>() == 0u);
+    BOOST_TEST(next["block"]["transactions"].size() == 2u);
+}
+
+BOOST_AUTO_TEST_SUITE_END() // work